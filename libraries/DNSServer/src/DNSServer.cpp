@@ -122,7 +122,8 @@ void DNSServer::replyWithIP()
   _dnsHeader->QDCount = _dnsHeader->QDCount; 
   //_dnsHeader->RA = 1;  
 
-  _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+  // query, then a 16 byte answer
+  _udp.beginPacket(_udp.remoteIP(), _udp.remotePort(), _currentPacketSize + 16);
   _udp.write(_buffer, _currentPacketSize);
 
   _udp.write((uint8_t)192); //  answer name is a pointer
@@ -157,7 +158,7 @@ void DNSServer::replyWithCustomCode()
   _dnsHeader->RCode = (unsigned char)_errorReplyCode;
   _dnsHeader->QDCount = 0;
 
-  _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+  _udp.beginPacket(_udp.remoteIP(), _udp.remotePort(), sizeof(DNSHeader));
   _udp.write(_buffer, sizeof(DNSHeader));
   _udp.endPacket();
 }
@@ -42,12 +42,24 @@ public:
         return std::unique_ptr<WiFiClient>(new WiFiClient());
     }
 
+    virtual void setReuse(WiFiClient& client, bool reuse)
+    {
+        (void)client;
+        (void)reuse;
+    }
+
     virtual bool verify(WiFiClient& client, const char* host)
     {
         (void)client;
         (void)host;
         return true;
     }
+
+    // connections with the same key may stand in for each other
+    virtual String poolKey(const String& host, uint16_t port)
+    {
+        return String(F("http://")) + host + ':' + String(port);
+    }
 };
 
 class TLSTraits : public TransportTraits
@@ -63,16 +75,33 @@ public:
         return std::unique_ptr<WiFiClient>(new WiFiClientSecure());
     }
 
+    void setReuse(WiFiClient& client, bool reuse) override
+    {
+        // a connection to reuse is worth resuming once the server drops it
+        static_cast<WiFiClientSecure&>(client).setSessionReuse(reuse);
+    }
+
     bool verify(WiFiClient& client, const char* host) override
     {
         auto wcs = static_cast<WiFiClientSecure&>(client);
         return wcs.verify(_fingerprint.c_str(), host);
     }
 
+    String poolKey(const String& host, uint16_t port) override
+    {
+        // only a connection verified against the same fingerprint will do
+        return String(F("https://")) + host + ':' + String(port) + '#' + _fingerprint;
+    }
+
 protected:
     String _fingerprint;
 };
 
+HTTPConnectionPool::HTTPConnectionPool(size_t maxConnections, uint32_t idleTimeout) :
+    ConnectionPool(maxConnections, idleTimeout)
+{
+}
+
 /**
  * constructor
  */
@@ -98,6 +127,7 @@ void HTTPClient::clear()
     _returnCode = 0;
     _size = -1;
     _headers = "";
+    _body.begin(0, false, 0);
 }
 
 
@@ -226,7 +256,10 @@ void HTTPClient::end(void)
                 _tcp->read();
             }
         }
-        if(_reuse && _canReuse) {
+        if(_reuse && _canReuse && _pool) {
+            DEBUG_HTTPCLIENT("[HTTP-Client][end] tcp back to the pool\n");
+            _pool->put(_tcpKey, std::move(_tcp));
+        } else if(_reuse && _canReuse) {
             DEBUG_HTTPCLIENT("[HTTP-Client][end] tcp keep open for reuse\n");
         } else {
             DEBUG_HTTPCLIENT("[HTTP-Client][end] tcp stop\n");
@@ -251,7 +284,7 @@ bool HTTPClient::connected()
 
 /**
  * try to reuse the connection to the server
- * keep-alive
+ * keep-alive; over https a new connection resumes the TLS session
  * @param reuse bool
  */
 void HTTPClient::setReuse(bool reuse)
@@ -259,6 +292,19 @@ void HTTPClient::setReuse(bool reuse)
     _reuse = reuse;
 }
 
+/**
+ * take connections from pool and give them back to it on end(),
+ * so other clients and other servers do not close them
+ * @param pool HTTPConnectionPool *, nullptr to stop using it
+ */
+void HTTPClient::setConnectionPool(HTTPConnectionPool* pool)
+{
+    _pool = pool;
+    if(_pool) {
+        _reuse = true;
+    }
+}
+
 /**
  * set User Agent
  * @param userAgent const char *
@@ -552,6 +598,149 @@ int HTTPClient::sendRequest(const char * type, Stream * stream, size_t size)
     return returnError(handleHeaderResponse());
 }
 
+/**
+ * queue a request for sendQueue()
+ * the request is built now, from the current URL and headers
+ * @param type const char *         "GET", "POST", ....
+ * @param payload const uint8_t *   data for the message body, copied
+ * @param size size_t               size for the message body
+ * @param handler ResponseHandler   gets the response
+ * @return false if the request can not be queued
+ */
+bool HTTPClient::queueRequest(const char * type, const uint8_t * payload, size_t size, ResponseHandler handler)
+{
+    if(!_transportTraits) {
+        DEBUG_HTTPCLIENT("[HTTP-Client][queueRequest] HTTPClient::begin was not called or returned error\n");
+        return false;
+    }
+
+    String key = _transportTraits->poolKey(_host, _port);
+    if(_queue.size() && key != _queueKey) {
+        DEBUG_HTTPCLIENT("[HTTP-Client][queueRequest] requests already queued for another server\n");
+        return false;
+    }
+
+    // pipelining needs the connection kept open, as with a pool
+    _reuse = true;
+
+    QueuedRequest request;
+    request.size = 0;
+    if(payload && size > 0) {
+        request.payload.reset(new uint8_t[size]);
+        memcpy(request.payload.get(), payload, size);
+        request.size = size;
+    }
+    // the length goes into this request only, never into _headers, where
+    // it would stay for the requests queued after it
+    request.head = requestHeader(type, RequestPipeline::withContentLength(_headers, request.size));
+    request.noBody = (strcmp(type, "HEAD") == 0);
+    request.handler = handler;
+
+    _queueKey = key;
+    _queue.push_back(std::move(request));
+    return true;
+}
+
+bool HTTPClient::queueRequest(const char * type, const String& payload, ResponseHandler handler)
+{
+    return queueRequest(type, (const uint8_t *) payload.c_str(), payload.length(), handler);
+}
+
+/**
+ * send the queued requests, HTTPC_PIPELINE_DEPTH ahead of their responses
+ * over a keep-alive connection, and hand each response to its handler.
+ * When the server closes the connection after a response, the requests
+ * after it are sent again over a new one (see RequestPipeline). On error
+ * the handlers of the requests left get the error code.
+ * @return number of responses handled, < 0 = error
+ */
+int HTTPClient::sendQueue()
+{
+    // requests queued by the handlers wait for the next sendQueue()
+    std::vector<QueuedRequest> queue;
+    queue.swap(_queue);
+    if(queue.empty()) {
+        return 0;
+    }
+
+    RequestPipeline pipeline;
+    pipeline.begin(queue.size(), HTTPC_PIPELINE_DEPTH);
+    int ret = 0;
+
+    _pipelining = true;
+    while(!pipeline.done()) {
+        if(pipeline.idle() && !connect()) {
+            ret = HTTPC_ERROR_CONNECTION_REFUSED;
+            break;
+        }
+
+        // keep the pipeline full
+        for(int next; (next = pipeline.next()) >= 0; pipeline.sent()) {
+            QueuedRequest& request = queue[next];
+            DEBUG_HTTPCLIENT("[HTTP-Client][sendQueue] sending request %d\n-----\n%s-----\n", next, request.head.c_str());
+            if(_tcp->write((const uint8_t *) request.head.c_str(), request.head.length()) != request.head.length()) {
+                ret = HTTPC_ERROR_SEND_HEADER_FAILED;
+                break;
+            }
+            if(request.size && _tcp->write(request.payload.get(), request.size) != request.size) {
+                ret = HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+                break;
+            }
+        }
+        if(ret) {
+            break;
+        }
+
+        QueuedRequest& request = queue[pipeline.answering()];
+        int code = handleHeaderResponse();
+        if(code < 0) {
+            ret = code;
+            break;
+        }
+        if(request.noBody || code == HTTP_CODE_NO_CONTENT || code == HTTP_CODE_NOT_MODIFIED) {
+            _body.begin(0, false, 0);
+        }
+        if(request.handler) {
+            request.handler(code, *this);
+        }
+
+        // skip what the handler left of the body, the next response follows
+        uint8_t buff[64];
+        int len;
+        while((len = read(buff, sizeof(buff))) > 0) {
+        }
+        if(len < 0) {
+            ret = len;
+            break;
+        }
+
+        bool closes = _headerParser.close();
+        if(closes) {
+            DEBUG_HTTPCLIENT("[HTTP-Client][sendQueue] server closes, %u requests to send again\n", pipeline.outstanding() - 1);
+            _tcp->stop();
+        }
+        pipeline.answered(closes);
+    }
+    _pipelining = false;
+
+    if(ret < 0) {
+        DEBUG_HTTPCLIENT("[HTTP-Client][sendQueue] error %d, %u requests not answered\n", ret, queue.size() - pipeline.answering());
+        returnError(ret);
+        _returnCode = ret;
+        _size = -1;
+        _body.begin(0, false, 0);
+        for(size_t i = pipeline.answering(); i < queue.size(); ++i) {
+            if(queue[i].handler) {
+                queue[i].handler(ret, *this);
+            }
+        }
+        return ret;
+    }
+
+    end();
+    return queue.size();
+}
+
 /**
  * size of message body / payload
  * @return -1 if no info or > 0 when Content-Length is set by server
@@ -606,73 +795,96 @@ int HTTPClient::writeToStream(Stream * stream)
         return returnError(HTTPC_ERROR_NOT_CONNECTED);
     }
 
-    // get length of document (is -1 when Server sends no Content-Length header)
-    int len = _size;
-    int ret = 0;
-
-    if(_transferEncoding == HTTPC_TE_IDENTITY) {
-        ret = writeToStreamDataBlock(stream, len);
-
-        // have we an error?
-        if(ret < 0) {
-            return returnError(ret);
-        }
-    } else if(_transferEncoding == HTTPC_TE_CHUNKED) {
-        int size = 0;
-        while(1) {
-            if(!connected()) {
-                return returnError(HTTPC_ERROR_CONNECTION_LOST);
-            }
-            String chunkHeader = _tcp->readStringUntil('\n');
+    int buff_size = HTTP_TCP_BUFFER_SIZE;
 
-            if(chunkHeader.length() <= 0) {
-                return returnError(HTTPC_ERROR_READ_TIMEOUT);
-            }
+    // if possible create smaller buffer then HTTP_TCP_BUFFER_SIZE
+    if(_transferEncoding == HTTPC_TE_IDENTITY && (_size > 0) && (_size < HTTP_TCP_BUFFER_SIZE)) {
+        buff_size = _size;
+    }
 
-            chunkHeader.trim(); // remove \r
+    // create buffer for read
+    uint8_t * buff = (uint8_t *) malloc(buff_size);
+    if(!buff) {
+        DEBUG_HTTPCLIENT("[HTTP-Client][writeToStream] too less ram! need %d\n", buff_size);
+        return returnError(HTTPC_ERROR_TOO_LESS_RAM);
+    }
 
-            // read size of chunk
-            len = (uint32_t) strtol((const char *) chunkHeader.c_str(), NULL, 16);
-            size += len;
-            DEBUG_HTTPCLIENT("[HTTP-Client] read chunk len: %d\n", len);
+    int ret = readBody(buff, buff_size, [this, stream](const uint8_t* data, size_t len) {
+        return writeToStreamDataBlock(stream, data, len);
+    });
 
-            // data left?
-            if(len > 0) {
-                int r = writeToStreamDataBlock(stream, len);
-                if(r < 0) {
-                    // error in writeToStreamDataBlock
-                    return returnError(r);
-                }
-                ret += r;
-            } else {
+    free(buff);
+    return ret;
+}
 
-                // if no length Header use global chunk size
-                if(_size <= 0) {
-                    _size = size;
-                }
+/**
+ * read the next piece of the body
+ * ends the request (keeping the connection if it may be reused) once the
+ * body is complete
+ * @param buf uint8_t *
+ * @param size size_t
+ * @return number of bytes read, 0 at the end of the body, < 0 = error
+ */
+int HTTPClient::read(uint8_t* buf, size_t size)
+{
+    if(!_body.done()) {
+        // BodyReader needs room for at least one byte
+        if(!size) {
+            return 0;
+        }
+        if(!_tcp) {
+            return returnError(HTTPC_ERROR_NOT_CONNECTED);
+        }
 
-                // check if we have write all data out
-                if(ret != _size) {
-                    return returnError(HTTPC_ERROR_STREAM_WRITE);
-                }
-                break;
-            }
+        int len = _body.read(*_tcp, buf, size);
+        if(len > 0) {
+            return len;
+        }
 
-            // read trailing \r\n at the end of the chunk
-            char buf[2];
-            auto trailing_seq_len = _tcp->readBytes((uint8_t*)buf, 2);
-            if (trailing_seq_len != 2 || buf[0] != '\r' || buf[1] != '\n') {
-                return returnError(HTTPC_ERROR_READ_TIMEOUT);
-            }
+        switch(len) {
+        case 0:
+            break;
+        case BODY_ERROR_CONNECTION_LOST:
+            return returnError(HTTPC_ERROR_CONNECTION_LOST);
+        case BODY_ERROR_READ_TIMEOUT:
+            return returnError(HTTPC_ERROR_READ_TIMEOUT);
+        default:
+            return returnError(HTTPC_ERROR_ENCODING);
+        }
+    }
 
-            delay(0);
+    // a Content-Length body is done with its last byte, an empty one
+    // before the first read
+    if(_body.ended()) {
+        if(_transferEncoding == HTTPC_TE_CHUNKED && _size <= 0) {
+            _size = _body.total();
+        }
+        if(!_pipelining) {
+            end();
         }
-    } else {
-        return returnError(HTTPC_ERROR_ENCODING);
     }
+    return 0;
+}
 
-    end();
-    return ret;
+/**
+ * read the rest of the body, piece by piece
+ * @param buf uint8_t *
+ * @param size size_t
+ * @param handler BodyHandler
+ * @return size of the body read, < 0 = error
+ */
+int HTTPClient::readBody(uint8_t* buf, size_t size, BodyHandler handler)
+{
+    int total = 0;
+    int len;
+    while((len = read(buf, size)) > 0) {
+        if(!handler(buf, len)) {
+            return returnError(HTTPC_ERROR_STREAM_WRITE);
+        }
+        total += len;
+        delay(0);
+    }
+    return (len < 0) ? len : total;
 }
 
 /**
@@ -825,22 +1037,40 @@ bool HTTPClient::hasHeader(const char* name)
  */
 bool HTTPClient::connect(void)
 {
+    if (!_transportTraits) {
+        DEBUG_HTTPCLIENT("[HTTP-Client] connect: HTTPClient::begin was not called or returned error\n");
+        return false;
+    }
+
+    String key = _transportTraits->poolKey(_host, _port);
 
     if(connected()) {
-        DEBUG_HTTPCLIENT("[HTTP-Client] connect. already connected, try reuse!\n");
-        while(_tcp->available() > 0) {
-            _tcp->read();
+        if(_tcpKey == key) {
+            DEBUG_HTTPCLIENT("[HTTP-Client] connect. already connected, try reuse!\n");
+            while(_tcp->available() > 0) {
+                _tcp->read();
+            }
+            return true;
         }
-        return true;
+        // begin() moved on to another server
+        DEBUG_HTTPCLIENT("[HTTP-Client] connect. connected to another server, tcp stop\n");
+        _tcp->stop();
     }
 
-    if (!_transportTraits) {
-        DEBUG_HTTPCLIENT("[HTTP-Client] connect: HTTPClient::begin was not called or returned error\n");
-        return false;
+    if(_pool) {
+        _tcp = _pool->take(key);
+        if(_tcp) {
+            DEBUG_HTTPCLIENT("[HTTP-Client] connect. reusing pooled connection to %s:%u\n", _host.c_str(), _port);
+            _tcpKey = key;
+            _tcp->setTimeout(_tcpTimeout);
+            return true;
+        }
     }
 
     _tcp = _transportTraits->create();
+    _tcpKey = key;
     _tcp->setTimeout(_tcpTimeout);
+    _transportTraits->setReuse(*_tcp, _reuse);
 
     if(!_tcp->connect(_host.c_str(), _port)) {
         DEBUG_HTTPCLIENT("[HTTP-Client] failed connect to %s:%u\n", _host.c_str(), _port);
@@ -863,16 +1093,13 @@ bool HTTPClient::connect(void)
 }
 
 /**
- * sends HTTP request header
+ * builds the HTTP request header
  * @param type (GET, POST, ...)
- * @return status
+ * @param headers header lines added to those the client sets itself
+ * @return header
  */
-bool HTTPClient::sendHeader(const char * type)
+String HTTPClient::requestHeader(const char * type, const String& headers)
 {
-    if(!connected()) {
-        return false;
-    }
-
     String header = String(type) + " " + (_uri.length() ? _uri : F("/")) + F(" HTTP/1.");
 
     if(_useHTTP10) {
@@ -908,7 +1135,22 @@ bool HTTPClient::sendHeader(const char * type)
         header += "\r\n";
     }
 
-    header += _headers + "\r\n";
+    header += headers + "\r\n";
+    return header;
+}
+
+/**
+ * sends HTTP request header
+ * @param type (GET, POST, ...)
+ * @return status
+ */
+bool HTTPClient::sendHeader(const char * type)
+{
+    if(!connected()) {
+        return false;
+    }
+
+    String header = requestHeader(type, _headers);
 
     DEBUG_HTTPCLIENT("[HTTP-Client] sending request header\n-----\n%s-----\n", header.c_str());
 
@@ -926,68 +1168,45 @@ int HTTPClient::handleHeaderResponse()
         return HTTPC_ERROR_NOT_CONNECTED;
     }
 
-    String transferEncoding;
     _returnCode = -1;
     _size = -1;
     _transferEncoding = HTTPC_TE_IDENTITY;
+    _headerParser.begin(_currentHeaders, _headerKeysCount);
     unsigned long lastDataTime = millis();
 
+    // the head is parsed in place and only what belongs to it is consumed,
+    // so the body stays in the client
+    uint8_t buff[128];
+
     while(connected()) {
         size_t len = _tcp->available();
         if(len > 0) {
-            String headerLine = _tcp->readStringUntil('\n');
-            headerLine.trim(); // remove \r
+            len = _tcp->peekBytes(buff, min(len, sizeof(buff)));
+            size_t used = _headerParser.parse(buff, len);
+            _tcp->read(buff, used);
 
             lastDataTime = millis();
 
-            DEBUG_HTTPCLIENT("[HTTP-Client][handleHeaderResponse] RX: '%s'\n", headerLine.c_str());
-
-            if(headerLine.startsWith("HTTP/1.")) {
-                _returnCode = headerLine.substring(9, headerLine.indexOf(' ', 9)).toInt();
-            } else if(headerLine.indexOf(':')) {
-                String headerName = headerLine.substring(0, headerLine.indexOf(':'));
-                String headerValue = headerLine.substring(headerLine.indexOf(':') + 1);
-                headerValue.trim();
-
-                if(headerName.equalsIgnoreCase("Content-Length")) {
-                    _size = headerValue.toInt();
-                }
-
-                if(headerName.equalsIgnoreCase("Connection")) {
-                    _canReuse = headerValue.equalsIgnoreCase("keep-alive");
-                }
+            if(_headerParser.done()) {
+                _returnCode = _headerParser.code();
+                _size = _headerParser.contentLength();
+                _canReuse = _headerParser.keepAlive();
 
-                if(headerName.equalsIgnoreCase("Transfer-Encoding")) {
-                    transferEncoding = headerValue;
-                }
-
-                for(size_t i = 0; i < _headerKeysCount; i++) {
-                    if(_currentHeaders[i].key.equalsIgnoreCase(headerName)) {
-                        _currentHeaders[i].value = headerValue;
-                        break;
-                    }
-                }
-            }
-
-            if(headerLine == "") {
                 DEBUG_HTTPCLIENT("[HTTP-Client][handleHeaderResponse] code: %d\n", _returnCode);
 
                 if(_size > 0) {
                     DEBUG_HTTPCLIENT("[HTTP-Client][handleHeaderResponse] size: %d\n", _size);
                 }
 
-                if(transferEncoding.length() > 0) {
-                    DEBUG_HTTPCLIENT("[HTTP-Client][handleHeaderResponse] Transfer-Encoding: %s\n", transferEncoding.c_str());
-                    if(transferEncoding.equalsIgnoreCase("chunked")) {
-                        _transferEncoding = HTTPC_TE_CHUNKED;
-                    } else {
-                        return HTTPC_ERROR_ENCODING;
-                    }
-                } else {
-                    _transferEncoding = HTTPC_TE_IDENTITY;
+                if(_headerParser.unknownEncoding()) {
+                    DEBUG_HTTPCLIENT("[HTTP-Client][handleHeaderResponse] Transfer-Encoding not supported\n");
+                    return HTTPC_ERROR_ENCODING;
                 }
+                _transferEncoding = _headerParser.chunked() ? HTTPC_TE_CHUNKED : HTTPC_TE_IDENTITY;
+
+                _body.begin(_size, _transferEncoding == HTTPC_TE_CHUNKED, _tcpTimeout);
 
-                if(_returnCode) {
+                if(_headerParser.isHTTP()) {
                     return _returnCode;
                 } else {
                     DEBUG_HTTPCLIENT("[HTTP-Client][handleHeaderResponse] Remote host is not an HTTP Server!");
@@ -1009,113 +1228,49 @@ int HTTPClient::handleHeaderResponse()
 /**
  * write one Data Block to Stream
  * @param stream Stream *
- * @param size int
- * @return < 0 = error >= 0 = size written
+ * @param data const uint8_t *
+ * @param len size_t
+ * @return all of it written
  */
-int HTTPClient::writeToStreamDataBlock(Stream * stream, int size)
+bool HTTPClient::writeToStreamDataBlock(Stream * stream, const uint8_t * data, size_t len)
 {
-    int buff_size = HTTP_TCP_BUFFER_SIZE;
-    int len = size;
-    int bytesWritten = 0;
-
-    // if possible create smaller buffer then HTTP_TCP_BUFFER_SIZE
-    if((len > 0) && (len < HTTP_TCP_BUFFER_SIZE)) {
-        buff_size = len;
-    }
-
-    // create buffer for read
-    uint8_t * buff = (uint8_t *) malloc(buff_size);
-
-    if(buff) {
-        // read all data from server
-        while(connected() && (len > 0 || len == -1)) {
+    // write it to Stream
+    size_t bytesWrite = stream->write(data, len);
 
-            // get available data size
-            size_t sizeAvailable = _tcp->available();
-
-            if(sizeAvailable) {
-
-                int readBytes = sizeAvailable;
-
-                // read only the asked bytes
-                if(len > 0 && readBytes > len) {
-                    readBytes = len;
-                }
-
-                // not read more the buffer can handle
-                if(readBytes > buff_size) {
-                    readBytes = buff_size;
-                }
-
-                // read data
-                int bytesRead = _tcp->readBytes(buff, readBytes);
-
-                // write it to Stream
-                int bytesWrite = stream->write(buff, bytesRead);
-                bytesWritten += bytesWrite;
-
-                // are all Bytes a writen to stream ?
-                if(bytesWrite != bytesRead) {
-                    DEBUG_HTTPCLIENT("[HTTP-Client][writeToStream] short write asked for %d but got %d retry...\n", bytesRead, bytesWrite);
-
-                    // check for write error
-                    if(stream->getWriteError()) {
-                        DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] stream write error %d\n", stream->getWriteError());
-
-                        //reset write error for retry
-                        stream->clearWriteError();
-                    }
-
-                    // some time for the stream
-                    delay(1);
-
-                    int leftBytes = (readBytes - bytesWrite);
-
-                    // retry to send the missed bytes
-                    bytesWrite = stream->write((buff + bytesWrite), leftBytes);
-                    bytesWritten += bytesWrite;
-
-                    if(bytesWrite != leftBytes) {
-                        // failed again
-                        DEBUG_HTTPCLIENT("[HTTP-Client][writeToStream] short write asked for %d but got %d failed.\n", leftBytes, bytesWrite);
-                        free(buff);
-                        return HTTPC_ERROR_STREAM_WRITE;
-                    }
-                }
-
-                // check for write error
-                if(stream->getWriteError()) {
-                    DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] stream write error %d\n", stream->getWriteError());
-                    free(buff);
-                    return HTTPC_ERROR_STREAM_WRITE;
-                }
+    // are all Bytes a writen to stream ?
+    if(bytesWrite != len) {
+        DEBUG_HTTPCLIENT("[HTTP-Client][writeToStream] short write asked for %d but got %d retry...\n", len, bytesWrite);
 
-                // count bytes to read left
-                if(len > 0) {
-                    len -= readBytes;
-                }
+        // check for write error
+        if(stream->getWriteError()) {
+            DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] stream write error %d\n", stream->getWriteError());
 
-                delay(0);
-            } else {
-                delay(1);
-            }
+            //reset write error for retry
+            stream->clearWriteError();
         }
 
-        free(buff);
+        // some time for the stream
+        delay(1);
 
-        DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] connection closed or file end (written: %d).\n", bytesWritten);
+        size_t leftBytes = len - bytesWrite;
 
-        if((size > 0) && (size != bytesWritten)) {
-            DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] bytesWritten %d and size %d mismatch!.\n", bytesWritten, size);
-            return HTTPC_ERROR_STREAM_WRITE;
+        // retry to send the missed bytes
+        bytesWrite = stream->write(data + bytesWrite, leftBytes);
+
+        if(bytesWrite != leftBytes) {
+            // failed again
+            DEBUG_HTTPCLIENT("[HTTP-Client][writeToStream] short write asked for %d but got %d failed.\n", leftBytes, bytesWrite);
+            return false;
         }
+    }
 
-    } else {
-        DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] too less ram! need %d\n", HTTP_TCP_BUFFER_SIZE);
-        return HTTPC_ERROR_TOO_LESS_RAM;
+    // check for write error
+    if(stream->getWriteError()) {
+        DEBUG_HTTPCLIENT("[HTTP-Client][writeToStreamDataBlock] stream write error %d\n", stream->getWriteError());
+        return false;
     }
 
-    return bytesWritten;
+    return true;
 }
 
 /**
@@ -26,8 +26,14 @@
 #define ESP8266HTTPClient_H_
 
 #include <memory>
+#include <vector>
+#include <functional>
 #include <Arduino.h>
 #include <WiFiClient.h>
+#include "detail/BodyReader.h"
+#include "detail/ConnectionPool.h"
+#include "detail/HeaderParser.h"
+#include "detail/RequestPipeline.h"
 
 #ifdef DEBUG_ESP_HTTP_CLIENT
 #ifdef DEBUG_ESP_PORT
@@ -57,6 +63,19 @@
 /// size for the stream handling
 #define HTTP_TCP_BUFFER_SIZE (1460)
 
+/// connection pool defaults
+#ifndef HTTPC_POOL_MAX_CONNECTIONS
+#define HTTPC_POOL_MAX_CONNECTIONS (3)
+#endif
+#ifndef HTTPC_POOL_IDLE_TIMEOUT
+#define HTTPC_POOL_IDLE_TIMEOUT (10000)
+#endif
+
+/// requests sendQueue() sends ahead of their responses
+#ifndef HTTPC_PIPELINE_DEPTH
+#define HTTPC_PIPELINE_DEPTH (4)
+#endif
+
 /// HTTP codes see RFC7231
 typedef enum {
     HTTP_CODE_CONTINUE = 100,
@@ -127,9 +146,47 @@ typedef enum {
 class TransportTraits;
 typedef std::unique_ptr<TransportTraits> TransportTraitsPtr;
 
+/**
+ * Keep-alive connections left open by HTTPClient::end(), for any
+ * HTTPClient using the pool to pick up again. Connections are kept by
+ * scheme, host and port (and the fingerprint they were verified with), for
+ * at most idleTimeout ms; the least recently used one is closed to stay
+ * within maxConnections.
+ */
+class HTTPConnectionPool : public ConnectionPool<WiFiClient>
+{
+public:
+    HTTPConnectionPool(size_t maxConnections = HTTPC_POOL_MAX_CONNECTIONS, uint32_t idleTimeout = HTTPC_POOL_IDLE_TIMEOUT);
+
+    /// set the number of idle connections kept, 0 disables pooling
+    using ConnectionPool::setMaxConnections;
+    /// set how long an idle connection is kept, in ms
+    using ConnectionPool::setIdleTimeout;
+    /// close all idle connections
+    using ConnectionPool::clear;
+    /// number of idle connections held
+    using ConnectionPool::size;
+
+    /// connections asked for, and how many of them were reused
+    using ConnectionPool::requests;
+    using ConnectionPool::reused;
+    /// connections closed because they sat idle too long or made room
+    using ConnectionPool::expired;
+    using ConnectionPool::evicted;
+
+protected:
+    friend class HTTPClient;
+};
+
 class HTTPClient
 {
 public:
+    /// gets each piece of the body, returns false to stop reading
+    typedef std::function<bool(const uint8_t* data, size_t len)> BodyHandler;
+    /// gets the response to a queued request (or the error that kept it
+    /// from coming), the body can be read from http as usual
+    typedef std::function<void(int code, HTTPClient& http)> ResponseHandler;
+
     HTTPClient();
     ~HTTPClient();
 
@@ -145,6 +202,7 @@ public:
     bool connected(void);
 
     void setReuse(bool reuse); /// keep-alive
+    void setConnectionPool(HTTPConnectionPool* pool); /// share keep-alive connections, implies setReuse(true)
     void setUserAgent(const String& userAgent);
     void setAuthorization(const char * user, const char * password);
     void setAuthorization(const char * auth);
@@ -164,6 +222,17 @@ public:
     int sendRequest(const char * type, uint8_t * payload = NULL, size_t size = 0);
     int sendRequest(const char * type, Stream * stream, size_t size = 0);
 
+    /// pipelining: queue requests to the server of the current begin(), then
+    /// send them all over one keep-alive connection, without waiting for each
+    /// response in turn. Queuing turns on setReuse(true). Responses go to
+    /// their handlers in order, the rest of a body a handler leaves unread
+    /// is skipped.
+    bool queueRequest(const char * type, const uint8_t * payload = NULL, size_t size = 0, ResponseHandler handler = nullptr);
+    bool queueRequest(const char * type, const String& payload, ResponseHandler handler = nullptr);
+    /// returns the number of responses handled, < 0 on error
+    int sendQueue();
+    size_t queued() const { return _queue.size(); }
+
     void addHeader(const String& name, const String& value, bool first = false, bool replace = true);
 
     /// Response handling
@@ -182,25 +251,40 @@ public:
     int writeToStream(Stream* stream);
     String getString(void);
 
+    /// pull the body, chunked transfer encoding removed, into buf:
+    /// returns the number of bytes read, 0 once it is complete (or if size
+    /// is 0, which reads nothing), < 0 on error
+    int read(uint8_t* buf, size_t size);
+    /// pass the rest of the body to handler, through buf
+    int readBody(uint8_t* buf, size_t size, BodyHandler handler);
+
     static String errorToString(int error);
 
 protected:
-    struct RequestArgument {
-        String key;
-        String value;
+    typedef HTTPHeaderField RequestArgument;
+
+    struct QueuedRequest {
+        String head;
+        std::unique_ptr<uint8_t[]> payload;
+        size_t size;
+        bool noBody;    // HEAD, the response has no body
+        ResponseHandler handler;
     };
 
     bool beginInternal(String url, const char* expectedProtocol);
     void clear();
     int returnError(int error);
     bool connect(void);
+    String requestHeader(const char * type, const String& headers);
     bool sendHeader(const char * type);
     int handleHeaderResponse();
-    int writeToStreamDataBlock(Stream * stream, int len);
+    bool writeToStreamDataBlock(Stream * stream, const uint8_t * data, size_t len);
 
 
     TransportTraitsPtr _transportTraits;
     std::unique_ptr<WiFiClient> _tcp;
+    HTTPConnectionPool* _pool = nullptr;
+    String _tcpKey;
 
     /// request handling
     String _host;
@@ -223,6 +307,13 @@ protected:
     int _size = -1;
     bool _canReuse = false;
     transferEncoding_t _transferEncoding = HTTPC_TE_IDENTITY;
+    HeaderParser _headerParser;
+    BodyReader _body;
+
+    /// pipelined requests
+    std::vector<QueuedRequest> _queue;
+    String _queueKey;
+    bool _pipelining = false;
 };
 
 
@@ -0,0 +1,213 @@
+/*
+  BodyReader.cpp - incremental decoder for HTTP response bodies.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Arduino.h>
+#include "BodyReader.h"
+
+BodyReader::BodyReader()
+{
+    begin(0, false, 0);
+}
+
+void BodyReader::begin(int length, bool chunked, uint32_t timeout)
+{
+    _chunked = chunked;
+    _untilClose = !chunked && length < 0;
+    _remaining = (chunked || length < 0) ? 0 : length;
+    _chunkSize = 0;
+    _digits = 0;
+    _lineLen = 0;
+    _total = 0;
+    _timeout = timeout;
+    _error = 0;
+    _ended = false;
+    if (chunked) {
+        _state = STATE_SIZE;
+    } else if (_untilClose || _remaining) {
+        _state = STATE_DATA;
+    } else {
+        _state = STATE_DONE;
+    }
+}
+
+bool BodyReader::ended()
+{
+    if (!done() || _ended) {
+        return false;
+    }
+    _ended = true;
+    return true;
+}
+
+int BodyReader::read(Client& client, uint8_t* buf, size_t size)
+{
+    while (_state != STATE_DONE) {
+        if (_state == STATE_FAILED) {
+            return _error;
+        }
+
+        if (_state == STATE_DATA) {
+            int err = _wait(client);
+            if (err == BODY_ERROR_CONNECTION_LOST && _untilClose) {
+                // the end of the connection is the end of the body
+                _state = STATE_DONE;
+                break;
+            }
+            if (err < 0) {
+                return _fail(err);
+            }
+            size_t len = client.available();
+            if (len > size) {
+                len = size;
+            }
+            if (!_untilClose && len > _remaining) {
+                len = _remaining;
+            }
+            int got = client.read(buf, len);
+            if (got <= 0) {
+                continue;
+            }
+            _total += got;
+            if (!_untilClose) {
+                _remaining -= got;
+                if (!_remaining) {
+                    _state = _chunked ? STATE_DATA_CR : STATE_DONE;
+                }
+            }
+            return got;
+        }
+
+        // chunk framing, a byte at a time
+        int err = _wait(client);
+        if (err < 0) {
+            return _fail(err);
+        }
+        int c = client.read();
+        if (c < 0) {
+            continue;
+        }
+        if (!_parse((uint8_t) c)) {
+            return _fail(BODY_ERROR_ENCODING);
+        }
+    }
+    return 0;
+}
+
+bool BodyReader::_parse(uint8_t c)
+{
+    switch (_state) {
+    case STATE_SIZE: {
+        int digit = -1;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        }
+        if (digit >= 0) {
+            if (_chunkSize > (SIZE_MAX >> 4)) {
+                return false;
+            }
+            _chunkSize = (_chunkSize << 4) | digit;
+            ++_digits;
+            return true;
+        }
+        if (!_digits) {
+            return false;
+        }
+        if (c == ';' || c == ' ' || c == '\t') {
+            _state = STATE_EXT;
+            return true;
+        }
+        if (c == '\r') {
+            _state = STATE_SIZE_LF;
+            return true;
+        }
+        if (c != '\n') {
+            return false;
+        }
+        break;
+    }
+    case STATE_EXT:
+        if (c == '\r') {
+            _state = STATE_SIZE_LF;
+        }
+        if (c != '\n') {
+            return true;
+        }
+        break;
+    case STATE_SIZE_LF:
+        if (c != '\n') {
+            return false;
+        }
+        break;
+    case STATE_DATA_CR:
+        _state = STATE_DATA_LF;
+        return c == '\r';
+    case STATE_DATA_LF:
+        _state = STATE_SIZE;
+        _chunkSize = 0;
+        _digits = 0;
+        return c == '\n';
+    case STATE_TRAILER:
+        if (c == '\n') {
+            if (!_lineLen) {
+                _state = STATE_DONE;
+            }
+            _lineLen = 0;
+        } else if (c != '\r') {
+            ++_lineLen;
+        }
+        return true;
+    default:
+        return false;
+    }
+
+    // end of the chunk size line
+    if (_chunkSize) {
+        _remaining = _chunkSize;
+        _state = STATE_DATA;
+    } else {
+        _lineLen = 0;
+        _state = STATE_TRAILER;
+    }
+    return true;
+}
+
+int BodyReader::_wait(Client& client)
+{
+    uint32_t start = millis();
+    while (client.available() <= 0) {
+        if (!client.connected()) {
+            return BODY_ERROR_CONNECTION_LOST;
+        }
+        if (millis() - start >= _timeout) {
+            return BODY_ERROR_READ_TIMEOUT;
+        }
+        delay(1);
+    }
+    return 0;
+}
+
+int BodyReader::_fail(int error)
+{
+    _state = STATE_FAILED;
+    _error = error;
+    return error;
+}
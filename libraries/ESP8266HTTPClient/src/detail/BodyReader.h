@@ -0,0 +1,85 @@
+/*
+  BodyReader.h - incremental decoder for HTTP response bodies.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef BODYREADER_H
+#define BODYREADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Client.h"
+
+#define BODY_ERROR_CONNECTION_LOST (-1)
+#define BODY_ERROR_READ_TIMEOUT    (-2)
+#define BODY_ERROR_ENCODING        (-3)
+
+// Keeps track of where a response body stands, so it can be pulled from
+// the client in pieces of the caller's choosing. Body data goes straight
+// from the client into the caller's buffer; only the chunk framing of a
+// chunked body is read byte by byte, and it is never stored.
+class BodyReader {
+public:
+    BodyReader();
+
+    // Start a body of length bytes, -1 if it ends with the connection. A
+    // chunked body brings its own length. Each wait for data gives up after
+    // timeout ms.
+    void begin(int length, bool chunked, uint32_t timeout);
+
+    // Read up to size (> 0) bytes of body into buf. Returns how many were
+    // read, 0 once the body is complete, or a BODY_ERROR_*, after which the
+    // reader stays failed.
+    int read(Client& client, uint8_t* buf, size_t size);
+
+    bool done() const { return _state == STATE_DONE; }
+    // True the first time it is asked once the body is complete, whether
+    // or not a read() saw the end, so the request is ended exactly once.
+    bool ended();
+    // body bytes handed out so far
+    size_t total() const { return _total; }
+
+protected:
+    enum State {
+        STATE_SIZE,       // chunk size digits
+        STATE_EXT,        // chunk extensions, ignored
+        STATE_SIZE_LF,
+        STATE_DATA,
+        STATE_DATA_CR,    // CRLF closing the chunk data
+        STATE_DATA_LF,
+        STATE_TRAILER,    // trailer fields up to an empty line, ignored
+        STATE_DONE,
+        STATE_FAILED
+    };
+
+    int _wait(Client& client);
+    bool _parse(uint8_t c);
+    int _fail(int error);
+
+    State _state;
+    bool _chunked;
+    bool _untilClose;
+    size_t _remaining;
+    size_t _chunkSize;
+    size_t _digits;
+    size_t _lineLen;
+    size_t _total;
+    uint32_t _timeout;
+    int _error;
+    bool _ended;
+};
+
+#endif //BODYREADER_H
@@ -0,0 +1,150 @@
+/*
+  ConnectionPool.h - idle keep-alive connections, by key.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include <Arduino.h>
+
+// Keeps connections of type ClientT with no request in flight, for at most
+// idleTimeout ms each. Entries are in order of use; the least recently used
+// one is closed to stay within maxConnections. A template rather than a
+// pool of Client, as Client has no virtual destructor to free them by.
+template<typename ClientT>
+class ConnectionPool {
+public:
+    ConnectionPool(size_t maxConnections, uint32_t idleTimeout) :
+        _maxConnections(maxConnections),
+        _idleTimeout(idleTimeout)
+    {
+    }
+
+    ~ConnectionPool()
+    {
+        clear();
+    }
+
+    // 0 disables pooling
+    void setMaxConnections(size_t maxConnections)
+    {
+        _maxConnections = maxConnections;
+        while (_entries.size() > _maxConnections) {
+            remove(0);
+            ++_evicted;
+        }
+    }
+
+    void setIdleTimeout(uint32_t idleTimeout)
+    {
+        _idleTimeout = idleTimeout;
+    }
+
+    void clear()
+    {
+        while (!_entries.empty()) {
+            remove(_entries.size() - 1);
+        }
+    }
+
+    size_t size()
+    {
+        expire();
+        return _entries.size();
+    }
+
+    uint32_t requests() const { return _requests; }
+    uint32_t reused() const { return _reused; }
+    uint32_t expired() const { return _expired; }
+    uint32_t evicted() const { return _evicted; }
+
+protected:
+    struct Entry {
+        String key;
+        std::unique_ptr<ClientT> client;
+        uint32_t lastUsed;
+    };
+
+    // An idle connection for key, most recently used first, or nullptr if
+    // there is none.
+    std::unique_ptr<ClientT> take(const String& key)
+    {
+        ++_requests;
+        expire();
+        for (size_t i = _entries.size(); i-- > 0;) {
+            if (_entries[i].key == key) {
+                std::unique_ptr<ClientT> client = std::move(_entries[i].client);
+                _entries.erase(_entries.begin() + i);
+                ++_reused;
+                return client;
+            }
+        }
+        return nullptr;
+    }
+
+    void put(const String& key, std::unique_ptr<ClientT> client)
+    {
+        if (!_maxConnections) {
+            client->stop();
+            return;
+        }
+        expire();
+        while (_entries.size() >= _maxConnections) {
+            remove(0);
+            ++_evicted;
+        }
+        Entry entry;
+        entry.key = key;
+        entry.client = std::move(client);
+        entry.lastUsed = millis();
+        _entries.push_back(std::move(entry));
+    }
+
+    // Close connections idle for too long, closed by the server, or with
+    // data no request asked for.
+    void expire()
+    {
+        uint32_t now = millis();
+        for (size_t i = _entries.size(); i-- > 0;) {
+            ClientT& client = *_entries[i].client;
+            if (now - _entries[i].lastUsed >= _idleTimeout || !client.connected() || client.available()) {
+                remove(i);
+                ++_expired;
+            }
+        }
+    }
+
+    void remove(size_t i)
+    {
+        _entries[i].client->stop();
+        _entries.erase(_entries.begin() + i);
+    }
+
+    std::vector<Entry> _entries;
+    size_t _maxConnections;
+    uint32_t _idleTimeout;
+    uint32_t _requests = 0;
+    uint32_t _reused = 0;
+    uint32_t _expired = 0;
+    uint32_t _evicted = 0;
+};
+
+#endif//CONNECTIONPOOL_H
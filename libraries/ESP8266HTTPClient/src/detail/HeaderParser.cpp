@@ -0,0 +1,245 @@
+/*
+  HeaderParser.cpp - incremental parser for HTTP response heads.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Arduino.h>
+#include "HeaderParser.h"
+
+static const char statusPrefix[] = "HTTP/1.";
+
+HeaderParser::HeaderParser()
+{
+    begin(nullptr, 0);
+}
+
+void HeaderParser::begin(HTTPHeaderField* fields, size_t count)
+{
+    _state = STATE_STATUS_PREFIX;
+    _fields = fields;
+    _count = count;
+    for (size_t i = 0; i < _count; ++i) {
+        _fields[i].value = "";
+    }
+    _nameLen = 0;
+    _nameTooLong = false;
+    _known = KNOWN_NONE;
+    _collect = -1;
+    _spaces = 0;
+    _tokenLen = 0;
+    _tokenTooLong = false;
+    _pendingLen = 0;
+    _prefixPos = 0;
+    _isHTTP = false;
+    _code = 0;
+    _contentLength = -1;
+    _keepAlive = false;
+    _close = false;
+    _chunked = false;
+    _unknownEncoding = false;
+}
+
+size_t HeaderParser::parse(const uint8_t* data, size_t len)
+{
+    size_t i = 0;
+    while (i < len && _state != STATE_DONE) {
+        if (_state == STATE_END_LF && data[i] != '\n') {
+            // a bare CR on the empty line, what follows is body
+            _state = STATE_DONE;
+            break;
+        }
+        _step((char) data[i++]);
+    }
+    return i;
+}
+
+void HeaderParser::_step(char c)
+{
+    switch (_state) {
+    case STATE_STATUS_PREFIX:
+        if (c == statusPrefix[_prefixPos]) {
+            if (++_prefixPos == sizeof(statusPrefix) - 1) {
+                _state = STATE_STATUS_VERSION;
+            }
+            return;
+        }
+        // not a status line, its fields are read all the same
+        _state = STATE_STATUS_REST;
+        _step(c);
+        return;
+
+    case STATE_STATUS_VERSION:
+        if (c == ' ') {
+            _state = STATE_STATUS_CODE;
+        } else if (c == '\n') {
+            _state = STATE_LINE_START;
+        }
+        return;
+
+    case STATE_STATUS_CODE:
+        if (c >= '0' && c <= '9' && _code < 1000) {
+            _code = _code * 10 + (c - '0');
+            return;
+        }
+        _isHTTP = _code > 0;
+        _state = STATE_STATUS_REST;
+        _step(c);
+        return;
+
+    case STATE_STATUS_REST:
+        if (c == '\n') {
+            _state = STATE_LINE_START;
+        }
+        return;
+
+    case STATE_LINE_START:
+        if (c == '\r') {
+            _state = STATE_END_LF;
+            return;
+        }
+        if (c == '\n') {
+            _state = STATE_DONE;
+            return;
+        }
+        _nameLen = 0;
+        _nameTooLong = false;
+        _state = STATE_NAME;
+        _step(c);
+        return;
+
+    case STATE_NAME:
+        if (c == ':') {
+            _name[_nameLen] = 0;
+            _startValue();
+            _state = STATE_VALUE_START;
+        } else if (c == '\n') {
+            // no colon, nothing to take from this line
+            _state = STATE_LINE_START;
+        } else if (_nameLen < HTTP_HEADER_NAME_LEN) {
+            _name[_nameLen++] = c;
+        } else {
+            _nameTooLong = true;
+        }
+        return;
+
+    case STATE_VALUE_START:
+        if (c == ' ' || c == '\t' || c == '\r') {
+            return;
+        }
+        _state = STATE_VALUE;
+        _step(c);
+        return;
+
+    case STATE_VALUE:
+        if (c == '\n') {
+            _endValue();
+            _state = STATE_LINE_START;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            // trailing whitespace is dropped, so wait and see
+            ++_spaces;
+        } else {
+            for (; _spaces; --_spaces) {
+                _valueChar(' ');
+            }
+            _valueChar(c);
+        }
+        return;
+
+    case STATE_END_LF:
+        _state = STATE_DONE;
+        return;
+
+    case STATE_DONE:
+        return;
+    }
+}
+
+void HeaderParser::_startValue()
+{
+    _known = KNOWN_NONE;
+    _collect = -1;
+    _spaces = 0;
+    _tokenLen = 0;
+    _tokenTooLong = false;
+    _pendingLen = 0;
+    if (_nameTooLong) {
+        return;
+    }
+    if (strcasecmp_P(_name, PSTR("Content-Length")) == 0) {
+        _known = KNOWN_CONTENT_LENGTH;
+    } else if (strcasecmp_P(_name, PSTR("Connection")) == 0) {
+        _known = KNOWN_CONNECTION;
+    } else if (strcasecmp_P(_name, PSTR("Transfer-Encoding")) == 0) {
+        _known = KNOWN_TRANSFER_ENCODING;
+    }
+    for (size_t i = 0; i < _count; ++i) {
+        if (strcasecmp(_fields[i].key.c_str(), _name) == 0) {
+            _collect = i;
+            // the last one of repeated fields wins
+            _fields[i].value = "";
+            break;
+        }
+    }
+}
+
+void HeaderParser::_valueChar(char c)
+{
+    if (_known != KNOWN_NONE) {
+        if (_tokenLen < sizeof(_token) - 1) {
+            _token[_tokenLen++] = c;
+        } else {
+            _tokenTooLong = true;
+        }
+    }
+    if (_collect >= 0) {
+        if (_pendingLen == sizeof(_pending) - 1) {
+            _flushCollected();
+        }
+        _pending[_pendingLen++] = c;
+    }
+}
+
+void HeaderParser::_flushCollected()
+{
+    _pending[_pendingLen] = 0;
+    _fields[_collect].value.concat(_pending);
+    _pendingLen = 0;
+}
+
+void HeaderParser::_endValue()
+{
+    _token[_tokenLen] = 0;
+    switch (_known) {
+    case KNOWN_CONTENT_LENGTH:
+        _contentLength = _tokenTooLong ? -1 : atoi(_token);
+        break;
+    case KNOWN_CONNECTION:
+        _keepAlive = !_tokenTooLong && strcasecmp_P(_token, PSTR("keep-alive")) == 0;
+        _close = !_tokenTooLong && strcasecmp_P(_token, PSTR("close")) == 0;
+        break;
+    case KNOWN_TRANSFER_ENCODING:
+        _chunked = !_tokenTooLong && strcasecmp_P(_token, PSTR("chunked")) == 0;
+        _unknownEncoding = !_chunked && _tokenLen > 0;
+        break;
+    case KNOWN_NONE:
+        break;
+    }
+    if (_collect >= 0 && _pendingLen) {
+        _flushCollected();
+    }
+    _known = KNOWN_NONE;
+    _collect = -1;
+}
@@ -0,0 +1,123 @@
+/*
+  HeaderParser.h - incremental parser for HTTP response heads.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef HEADERPARSER_H
+#define HEADERPARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "WString.h"
+
+// Longest header name that can be collected
+#define HTTP_HEADER_NAME_LEN 64
+
+struct HTTPHeaderField {
+    String key;
+    String value;
+};
+
+// Parses the status line and header fields of a response as its bytes come
+// in, in pieces of any size. Names are matched in a fixed buffer; a value is
+// only stored if its field was asked for, and the fields the client itself
+// needs (Content-Length, Connection, Transfer-Encoding) are decoded on the
+// fly, so fields nobody asked for cost no allocation at all.
+class HeaderParser {
+public:
+    HeaderParser();
+
+    // Start a response. The values of fields[] are cleared, then set from
+    // the fields whose name matches a key, ignoring case.
+    void begin(HTTPHeaderField* fields, size_t count);
+
+    // Parse up to len bytes. Returns the number of bytes that belong to the
+    // head; parsing stops after the empty line that ends it, so the rest of
+    // data is body.
+    size_t parse(const uint8_t* data, size_t len);
+
+    bool done() const { return _state == STATE_DONE; }
+    // false if the response does not start with an HTTP/1.x status line
+    bool isHTTP() const { return _isHTTP; }
+
+    int code() const { return _code; }
+    // -1 without Content-Length
+    int contentLength() const { return _contentLength; }
+    bool keepAlive() const { return _keepAlive; }
+    // the server said it closes the connection after this response
+    bool close() const { return _close; }
+    bool chunked() const { return _chunked; }
+    // a Transfer-Encoding other than chunked was given
+    bool unknownEncoding() const { return _unknownEncoding; }
+
+protected:
+    enum State {
+        STATE_STATUS_PREFIX,
+        STATE_STATUS_VERSION,
+        STATE_STATUS_CODE,
+        STATE_STATUS_REST,
+        STATE_LINE_START,
+        STATE_NAME,
+        STATE_VALUE_START,
+        STATE_VALUE,
+        STATE_END_LF,
+        STATE_DONE
+    };
+
+    enum Known {
+        KNOWN_NONE,
+        KNOWN_CONTENT_LENGTH,
+        KNOWN_CONNECTION,
+        KNOWN_TRANSFER_ENCODING
+    };
+
+    void _step(char c);
+    void _startValue();
+    void _valueChar(char c);
+    void _endValue();
+    void _flushCollected();
+
+    State _state;
+    HTTPHeaderField* _fields;
+    size_t _count;
+
+    char _name[HTTP_HEADER_NAME_LEN + 1];
+    size_t _nameLen;
+    bool _nameTooLong;
+
+    Known _known;
+    int _collect;
+    // whitespace inside a value, held back until more of it follows
+    size_t _spaces;
+    // start of the value of a known field, enough to recognize its tokens
+    char _token[12];
+    size_t _tokenLen;
+    bool _tokenTooLong;
+    // collected value bytes not yet appended to the String
+    char _pending[32];
+    size_t _pendingLen;
+
+    size_t _prefixPos;
+    bool _isHTTP;
+    int _code;
+    int _contentLength;
+    bool _keepAlive;
+    bool _close;
+    bool _chunked;
+    bool _unknownEncoding;
+};
+
+#endif //HEADERPARSER_H
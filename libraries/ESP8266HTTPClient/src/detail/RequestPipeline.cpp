@@ -0,0 +1,76 @@
+/*
+  RequestPipeline.cpp - order of pipelined HTTP requests and responses.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Arduino.h>
+#include "RequestPipeline.h"
+
+RequestPipeline::RequestPipeline()
+{
+    begin(0, 1);
+}
+
+void RequestPipeline::begin(size_t count, size_t depth)
+{
+    _count = count;
+    _depth = depth ? depth : 1;
+    _sent = 0;
+    _answered = 0;
+}
+
+int RequestPipeline::next() const
+{
+    if (_sent >= _count || _sent - _answered >= _depth) {
+        return -1;
+    }
+    return (int) _sent;
+}
+
+void RequestPipeline::answered(bool closes)
+{
+    if (_answered < _sent) {
+        ++_answered;
+    }
+    if (closes) {
+        _sent = _answered;
+    }
+}
+
+String RequestPipeline::withContentLength(const String& headers, size_t length)
+{
+    static const char name[] = "Content-Length:";
+    String out;
+    out.reserve(headers.length() + 24);
+    const char* p = headers.c_str();
+    while (*p) {
+        const char* end = strchr(p, '\n');
+        end = end ? end + 1 : p + strlen(p);
+        if (strncasecmp(p, name, sizeof(name) - 1) != 0) {
+            while (p < end) {
+                out += *p++;
+            }
+        }
+        p = end;
+    }
+    if (length) {
+        out += name;
+        out += ' ';
+        out += String((unsigned long) length);
+        out += "\r\n";
+    }
+    return out;
+}
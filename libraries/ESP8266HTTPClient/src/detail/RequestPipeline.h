@@ -0,0 +1,65 @@
+/*
+  RequestPipeline.h - order of pipelined HTTP requests and responses.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef REQUESTPIPELINE_H
+#define REQUESTPIPELINE_H
+
+#include <stddef.h>
+#include "WString.h"
+
+// Which of count queued requests goes out next and which one the next
+// response answers. Up to depth requests are sent ahead of their
+// responses. When the server closes the connection after a response, the
+// requests sent after it are lost with the connection, and are sent again
+// over the next one.
+class RequestPipeline {
+public:
+    RequestPipeline();
+
+    void begin(size_t count, size_t depth);
+
+    bool done() const { return _answered == _count; }
+    // nothing is outstanding, so a new connection may be used
+    bool idle() const { return _sent == _answered; }
+
+    // Index of the request to send next, or -1 if depth requests are
+    // waiting for their responses or all have been sent
+    int next() const;
+    void sent() { ++_sent; }
+
+    // Index of the request the next response answers
+    size_t answering() const { return _answered; }
+    // Its response was read; closes if the server closes the connection
+    // after it
+    void answered(bool closes);
+
+    size_t outstanding() const { return _sent - _answered; }
+
+    // The header lines of a request with a body of length bytes: headers,
+    // without any Content-Length line it has, and then Content-Length
+    // unless length is 0
+    static String withContentLength(const String& headers, size_t length);
+
+protected:
+    size_t _count;
+    size_t _depth;
+    size_t _sent;
+    size_t _answered;
+};
+
+#endif //REQUESTPIPELINE_H
@@ -28,6 +28,7 @@
 #include "ESP8266WebServer.h"
 #include "FS.h"
 #include "detail/RequestHandlersImpl.h"
+#include "detail/conditional.h"
 
 //#define DEBUG_ESP_HTTP_SERVER
 #ifdef DEBUG_ESP_PORT
@@ -40,6 +41,14 @@ static const char AUTHORIZATION_HEADER[] PROGMEM = "Authorization";
 static const char qop_auth[] PROGMEM = "qop=auth";
 static const char WWW_Authenticate[] PROGMEM = "WWW-Authenticate";
 static const char Content_Length[] PROGMEM = "Content-Length";
+static const char IF_NONE_MATCH_HEADER[] PROGMEM = "If-None-Match";
+static const char RANGE_HEADER[] PROGMEM = "Range";
+static const char IF_RANGE_HEADER[] PROGMEM = "If-Range";
+
+// headers the server needs itself, collected after those requested so
+// header(i) keeps the indexes it had (Authorization stays first)
+static PGM_P const builtinHeaders[] = { IF_NONE_MATCH_HEADER, RANGE_HEADER, IF_RANGE_HEADER };
+static const size_t builtinHeadersCount = sizeof(builtinHeaders) / sizeof(builtinHeaders[0]);
 
 
 ESP8266WebServer::ESP8266WebServer(IPAddress addr, int port)
@@ -57,6 +66,8 @@ ESP8266WebServer::ESP8266WebServer(IPAddress addr, int port)
 , _currentHeaders(nullptr)
 , _contentLength(0)
 , _chunked(false)
+, _chunkedWriter([this](const char* data, size_t len) { return _segmentWrite(data, len); })
+, _responseSegments(0)
 {
 }
 
@@ -75,6 +86,8 @@ ESP8266WebServer::ESP8266WebServer(int port)
 , _currentHeaders(nullptr)
 , _contentLength(0)
 , _chunked(false)
+, _chunkedWriter([this](const char* data, size_t len) { return _segmentWrite(data, len); })
+, _responseSegments(0)
 {
 }
 
@@ -268,6 +281,10 @@ void ESP8266WebServer::serveStatic(const char* uri, FS& fs, const char* path, co
     _addRequestHandler(new StaticRequestHandler(fs, path, uri, cache_header));
 }
 
+void ESP8266WebServer::serveStatic(const char* uri, const AssetBundle& bundle, const char* cache_header) {
+    _addRequestHandler(new AssetBundleRequestHandler(bundle, uri, cache_header));
+}
+
 void ESP8266WebServer::handleClient() {
   if (_currentStatus == HC_NONE) {
     WiFiClient client = _server.available();
@@ -345,61 +362,64 @@ void ESP8266WebServer::stop() {
 }
 
 void ESP8266WebServer::sendHeader(const String& name, const String& value, bool first) {
-  String headerLine = name;
-  headerLine += F(": ");
-  headerLine += value;
-  headerLine += "\r\n";
-
-  if (first) {
-    _responseHeaders = headerLine + _responseHeaders;
-  }
-  else {
-    _responseHeaders += headerLine;
-  }
+  _responseHeaders.add(name, value, first);
 }
 
 void ESP8266WebServer::setContentLength(const size_t contentLength) {
     _contentLength = contentLength;
 }
 
-void ESP8266WebServer::_prepareHeader(String& response, int code, const char* content_type, size_t contentLength) {
-    response = String(F("HTTP/1.")) + String(_currentVersion) + ' ';
-    response += String(code);
-    response += ' ';
-    response += _responseCodeToString(code);
-    response += "\r\n";
-
+void ESP8266WebServer::_prepareHeader(int code, const char* content_type, size_t contentLength) {
     using namespace mime;
+    _responseSegments = 0;
     if (!content_type)
         content_type = mimeTable[html].mimeType;
 
-    sendHeader(String(F("Content-Type")), String(FPSTR(content_type)), true);
-    if (_contentLength == CONTENT_LENGTH_NOT_SET) {
-        sendHeader(String(FPSTR(Content_Length)), String(contentLength));
-    } else if (_contentLength != CONTENT_LENGTH_UNKNOWN) {
-        sendHeader(String(FPSTR(Content_Length)), String(_contentLength));
-    } else if(_contentLength == CONTENT_LENGTH_UNKNOWN && _currentVersion){ //HTTP/1.1 or above client
-      //let's do chunked
-      _chunked = true;
-      sendHeader(String(F("Accept-Ranges")),String(F("none")));
-      sendHeader(String(F("Transfer-Encoding")),String(F("chunked")));
+    if (code == 304) {
+        // no body, and no Content-Type or Content-Length that a cache could
+        // take for those of the stored representation (RFC 7230 3.3.2)
+    } else {
+      _responseHeaders.add_P(PSTR("Content-Type"), content_type, true);
+      if (_contentLength == CONTENT_LENGTH_NOT_SET) {
+          _responseHeaders.add_P(Content_Length, contentLength);
+      } else if (_contentLength != CONTENT_LENGTH_UNKNOWN) {
+          _responseHeaders.add_P(Content_Length, _contentLength);
+      } else if(_contentLength == CONTENT_LENGTH_UNKNOWN && _currentVersion){ //HTTP/1.1 or above client
+        //let's do chunked
+        _chunked = true;
+        _chunkedWriter.begin(HTTP_DOWNLOAD_UNIT_SIZE);
+        _responseHeaders.add_P(PSTR("Accept-Ranges"), PSTR("none"));
+        _responseHeaders.add_P(PSTR("Transfer-Encoding"), PSTR("chunked"));
+      }
     }
-    sendHeader(String(F("Connection")), String(F("close")));
+    _responseHeaders.add_P(PSTR("Connection"), PSTR("close"));
+    _responseHeaders.finish(_currentVersion, code, (PGM_P) _responseCodeToString(code));
+}
 
-    response += _responseHeaders;
-    response += "\r\n";
-    _responseHeaders = "";
+// The head goes out together with as much of the body as fits in the header
+// buffer, so short responses leave in a single segment.
+void ESP8266WebServer::_sendResponse(const char* content, size_t contentLength) {
+    size_t taken = _chunked ? 0 : _responseHeaders.fill(content, contentLength);
+    _segmentWrite(_responseHeaders.data(), _responseHeaders.length());
+    _responseHeaders.clear();
+    if (contentLength > taken)
+      sendContent(content + taken, contentLength - taken);
+}
+
+void ESP8266WebServer::_sendResponse_P(PGM_P content, size_t contentLength) {
+    size_t taken = _chunked ? 0 : _responseHeaders.fill_P(content, contentLength);
+    _segmentWrite(_responseHeaders.data(), _responseHeaders.length());
+    _responseHeaders.clear();
+    if (contentLength > taken)
+      sendContent_P(content + taken, contentLength - taken);
 }
 
 void ESP8266WebServer::send(int code, const char* content_type, const String& content) {
-    String header;
     // Can we asume the following?
     //if(code == 200 && content.length() == 0 && _contentLength == CONTENT_LENGTH_NOT_SET)
     //  _contentLength = CONTENT_LENGTH_UNKNOWN;
-    _prepareHeader(header, code, content_type, content.length());
-    _currentClientWrite(header.c_str(), header.length());
-    if(content.length())
-      sendContent(content);
+    _prepareHeader(code, content_type, content.length());
+    _sendResponse(content.c_str(), content.length());
 }
 
 void ESP8266WebServer::send_P(int code, PGM_P content_type, PGM_P content) {
@@ -409,21 +429,13 @@ void ESP8266WebServer::send_P(int code, PGM_P content_type, PGM_P content) {
         contentLength = strlen_P(content);
     }
 
-    String header;
-    char type[64];
-    memccpy_P((void*)type, (PGM_VOID_P)content_type, 0, sizeof(type));
-    _prepareHeader(header, code, (const char* )type, contentLength);
-    _currentClientWrite(header.c_str(), header.length());
-    sendContent_P(content);
+    _prepareHeader(code, content_type, contentLength);
+    _sendResponse_P(content, contentLength);
 }
 
 void ESP8266WebServer::send_P(int code, PGM_P content_type, PGM_P content, size_t contentLength) {
-    String header;
-    char type[64];
-    memccpy_P((void*)type, (PGM_VOID_P)content_type, 0, sizeof(type));
-    _prepareHeader(header, code, (const char* )type, contentLength);
-    sendContent(header);
-    sendContent_P(content, contentLength);
+    _prepareHeader(code, content_type, contentLength);
+    _sendResponse_P(content, contentLength);
 }
 
 void ESP8266WebServer::send(int code, char* content_type, const String& content) {
@@ -435,23 +447,20 @@ void ESP8266WebServer::send(int code, const String& content_type, const String&
 }
 
 void ESP8266WebServer::sendContent(const String& content) {
-  const char * footer = "\r\n";
-  size_t len = content.length();
-  if(_chunked) {
-    char * chunkSize = (char *)malloc(11);
-    if(chunkSize){
-      sprintf(chunkSize, "%x%s", len, footer);
-      _currentClientWrite(chunkSize, strlen(chunkSize));
-      free(chunkSize);
-    }
+  sendContent(content.c_str(), content.length());
+}
+
+void ESP8266WebServer::sendContent(const char* content, size_t len) {
+  if (!_chunked) {
+    _segmentWrite(content, len);
+    return;
   }
-  _currentClientWrite(content.c_str(), len);
-  if(_chunked){
-    _currentClient.write(footer, 2);
-    if (len == 0) {
-      _chunked = false;
-    }
+  if (len == 0) {
+    _chunkedWriter.end();
+    _chunked = false;
+    return;
   }
+  _chunkedWriter.write(content, len);
 }
 
 void ESP8266WebServer::sendContent_P(PGM_P content) {
@@ -459,35 +468,101 @@ void ESP8266WebServer::sendContent_P(PGM_P content) {
 }
 
 void ESP8266WebServer::sendContent_P(PGM_P content, size_t size) {
-  const char * footer = "\r\n";
-  if(_chunked) {
-    char * chunkSize = (char *)malloc(11);
-    if(chunkSize){
-      sprintf(chunkSize, "%x%s", size, footer);
-      _currentClientWrite(chunkSize, strlen(chunkSize));
-      free(chunkSize);
-    }
+  if (!_chunked) {
+    _segmentWrite_P(content, size);
+    return;
   }
-  _currentClientWrite_P(content, size);
-  if(_chunked){
-    _currentClient.write(footer, 2);
-    if (size == 0) {
-      _chunked = false;
-    }
+  if (size == 0) {
+    _chunkedWriter.end();
+    _chunked = false;
+    return;
   }
+  _chunkedWriter.write_P(content, size);
 }
 
 
-void ESP8266WebServer::_streamFileCore(const size_t fileSize, const String & fileName, const String & contentType)
+uint32_t ESP8266WebServer::_contentHash(Stream& file, size_t size)
+{
+  uint32_t hash = conditional::CONTENT_HASH_INIT;
+  uint8_t buf[128];
+  while (size) {
+    // never more than is left, readBytes() would wait out its timeout
+    size_t got = file.readBytes((char*) buf, (size < sizeof(buf)) ? size : sizeof(buf));
+    if (!got)
+      break;
+    hash = conditional::contentHash(hash, buf, got);
+    size -= got;
+  }
+  return hash;
+}
+
+bool ESP8266WebServer::_streamFileCore(const size_t fileSize, const String & fileName, uint32_t contentHash, const String & contentType, size_t& start, size_t& length)
 {
   using namespace mime;
-  setContentLength(fileSize);
+  start = 0;
+  length = fileSize;
+
+  String etag = conditional::fileETag(fileSize, contentHash);
+  sendHeader(F("ETag"), etag);
+  if (conditional::etagMatches(header(FPSTR(IF_NONE_MATCH_HEADER)), etag)) {
+    send(304);
+    return false;
+  }
+
+  sendHeader(F("Accept-Ranges"), F("bytes"));
   if (fileName.endsWith(String(FPSTR(mimeTable[gz].endsWith))) &&
       contentType != String(FPSTR(mimeTable[gz].mimeType)) &&
       contentType != String(FPSTR(mimeTable[none].mimeType))) {
     sendHeader(F("Content-Encoding"), F("gzip"));
   }
+
+  // If-Range needs a strong validator, and the file's tag is weak: with
+  // If-Range the whole file is sent, so a changed file is never spliced
+  // onto a cached copy of the old one on a hash collision
+  String range = header(FPSTR(RANGE_HEADER));
+  if (range.length() && !hasHeader(FPSTR(IF_RANGE_HEADER))) {
+    size_t end;
+    switch (conditional::parseRange(range, fileSize, start, end)) {
+    case conditional::RANGE_OK:
+      length = end - start + 1;
+      sendHeader(F("Content-Range"), String(F("bytes ")) + start + '-' + end + '/' + fileSize);
+      setContentLength(length);
+      send(206, contentType, "");
+      return true;
+    case conditional::RANGE_UNSATISFIABLE:
+      sendHeader(F("Content-Range"), String(F("bytes */")) + fileSize);
+      send(416, contentType, "");
+      return false;
+    case conditional::RANGE_NONE:
+      break;
+    }
+  }
+
+  setContentLength(fileSize);
   send(200, contentType, "");
+  return true;
+}
+
+size_t ESP8266WebServer::_streamFileRange(Stream& file, size_t length)
+{
+  size_t bufSize = (length < HTTP_DOWNLOAD_UNIT_SIZE) ? length : HTTP_DOWNLOAD_UNIT_SIZE;
+  std::unique_ptr<char[]> buf(new char[bufSize]);
+  if (!buf)
+    return 0;
+  size_t sent = 0;
+  while (sent < length) {
+    size_t want = length - sent;
+    if (want > bufSize)
+      want = bufSize;
+    size_t got = file.readBytes(buf.get(), want);
+    if (!got)
+      break;
+    size_t written = _segmentWrite(buf.get(), got);
+    sent += written;
+    if (written != got)
+      break;
+  }
+  return sent;
 }
 
 
@@ -533,13 +608,16 @@ String ESP8266WebServer::header(String name) {
 }
 
 void ESP8266WebServer::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
-  _headerKeysCount = headerKeysCount + 1;
+  _headerKeysCount = headerKeysCount + 1 + builtinHeadersCount;
   if (_currentHeaders)
      delete[]_currentHeaders;
   _currentHeaders = new RequestArgument[_headerKeysCount];
   _currentHeaders[0].key = FPSTR(AUTHORIZATION_HEADER);
-  for (int i = 1; i < _headerKeysCount; i++){
-    _currentHeaders[i].key = headerKeys[i-1];
+  for (size_t i = 0; i < headerKeysCount; i++){
+    _currentHeaders[i+1].key = headerKeys[i];
+  }
+  for (size_t i = 0; i < builtinHeadersCount; i++){
+    _currentHeaders[headerKeysCount+1+i].key = FPSTR(builtinHeaders[i]);
   }
 }
 
@@ -616,7 +694,7 @@ void ESP8266WebServer::_finalizeResponse() {
   }
 }
 
-String ESP8266WebServer::_responseCodeToString(int code) {
+const __FlashStringHelper* ESP8266WebServer::_responseCodeToString(int code) {
   switch (code) {
     case 100: return F("Continue");
     case 101: return F("Switching Protocols");
@@ -61,6 +61,9 @@ typedef struct {
 } HTTPUpload;
 
 #include "detail/RequestHandler.h"
+#include "detail/AssetBundle.h"
+#include "detail/ResponseHeaders.h"
+#include "detail/ChunkedWriter.h"
 
 namespace fs {
 class FS;
@@ -89,6 +92,7 @@ public:
   void on(const String &uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
   void addHandler(RequestHandler* handler);
   void serveStatic(const char* uri, fs::FS& fs, const char* path, const char* cache_header = NULL );
+  void serveStatic(const char* uri, const AssetBundle& bundle, const char* cache_header = NULL ); // serve a bundle made by tools/webassets.py
   void onNotFound(THandlerFunction fn);  //called when handler is not assigned
   void onFileUpload(THandlerFunction fn); //handle file uploads
 
@@ -124,34 +128,52 @@ public:
   void setContentLength(const size_t contentLength);
   void sendHeader(const String& name, const String& value, bool first = false);
   void sendContent(const String& content);
+  void sendContent(const char* content, size_t size);
   void sendContent_P(PGM_P content);
   void sendContent_P(PGM_P content, size_t size);
+  // Number of writes handed to the client for the current response
+  size_t responseSegments() const { return _responseSegments; }
 
   static String urlDecode(const String& text);
 
+  // Answers If-None-Match with 304 and a single byte Range with 206. The
+  // ETag is a hash of the content, so the file is read once for it.
   template<typename T> 
   size_t streamFile(T &file, const String& contentType) {
-    _streamFileCore(file.size(), file.name(), contentType);
-    return _currentClient.write(file);
+    size_t start, length;
+    uint32_t hash = _contentHash(file, file.size());
+    if (!file.seek(0))
+      return 0;
+    if (!_streamFileCore(file.size(), file.name(), hash, contentType, start, length))
+      return 0;
+    if (start == 0 && length == (size_t) file.size())
+      return _currentClient.write(file);
+    if (!file.seek(start))
+      return 0;
+    return _streamFileRange(file, length);
   }
   
 protected:
   virtual size_t _currentClientWrite(const char* b, size_t l) { return _currentClient.write( b, l ); }
   virtual size_t _currentClientWrite_P(PGM_P b, size_t l) { return _currentClient.write_P( b, l ); }
+  size_t _segmentWrite(const char* b, size_t l) { ++_responseSegments; return _currentClientWrite(b, l); }
+  size_t _segmentWrite_P(PGM_P b, size_t l) { ++_responseSegments; return _currentClientWrite_P(b, l); }
   void _addRequestHandler(RequestHandler* handler);
   void _handleRequest();
   void _finalizeResponse();
   bool _parseRequest(WiFiClient& client);
   void _parseArguments(String data);
-  static String _responseCodeToString(int code);
+  static const __FlashStringHelper* _responseCodeToString(int code);
   bool _parseForm(WiFiClient& client, String boundary, uint32_t len);
   bool _parseFormUploadAborted();
-  void _uploadWriteByte(uint8_t b);
-  uint8_t _uploadReadByte(WiFiClient& client);
-  void _prepareHeader(String& response, int code, const char* content_type, size_t contentLength);
+  void _prepareHeader(int code, const char* content_type, size_t contentLength);
+  void _sendResponse(const char* content, size_t contentLength);
+  void _sendResponse_P(PGM_P content, size_t contentLength);
   bool _collectHeader(const char* headerName, const char* headerValue);
  
-  void _streamFileCore(const size_t fileSize, const String & fileName, const String & contentType);
+  uint32_t _contentHash(Stream& file, size_t size);
+  bool _streamFileCore(const size_t fileSize, const String & fileName, uint32_t contentHash, const String & contentType, size_t& start, size_t& length);
+  size_t _streamFileRange(Stream& file, size_t length);
 
   String _getRandomHexString();
   // for extracting Auth parameters
@@ -184,10 +206,12 @@ protected:
   int              _headerKeysCount;
   RequestArgument* _currentHeaders;
   size_t           _contentLength;
-  String           _responseHeaders;
+  ResponseHeaders  _responseHeaders;
 
   String           _hostHeader;
   bool             _chunked;
+  ChunkedWriter    _chunkedWriter;
+  size_t           _responseSegments;
 
   String           _snonce;  // Store noance and opaque for future comparison
   String           _sopaque;
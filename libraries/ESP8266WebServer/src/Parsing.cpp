@@ -24,6 +24,7 @@
 #include "WiFiClient.h"
 #include "ESP8266WebServer.h"
 #include "detail/mimetable.h"
+#include "detail/MultipartReader.h"
 
 //#define DEBUG_ESP_HTTP_SERVER
 #ifdef DEBUG_ESP_PORT
@@ -345,26 +346,6 @@ void ESP8266WebServer::_parseArguments(String data) {
 
 }
 
-void ESP8266WebServer::_uploadWriteByte(uint8_t b){
-  if (_currentUpload->currentSize == HTTP_UPLOAD_BUFLEN){
-    if(_currentHandler && _currentHandler->canUpload(_currentUri))
-      _currentHandler->upload(*this, _currentUri, *_currentUpload);
-    _currentUpload->totalSize += _currentUpload->currentSize;
-    _currentUpload->currentSize = 0;
-  }
-  _currentUpload->buf[_currentUpload->currentSize++] = b;
-}
-
-uint8_t ESP8266WebServer::_uploadReadByte(WiFiClient& client){
-  int res = client.read();
-  if(res == -1){
-    while(!client.available() && client.connected())
-      yield();
-    res = client.read();
-  }
-  return (uint8_t)res;
-}
-
 bool ESP8266WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t len){
   (void) len;
 #ifdef DEBUG_ESP_HTTP_SERVER
@@ -373,14 +354,20 @@ bool ESP8266WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t
   DEBUG_OUTPUT.print(" Length: ");
   DEBUG_OUTPUT.println(len);
 #endif
+  MultipartReader reader(client, boundary);
+  reader.setTimeout(HTTP_MAX_POST_WAIT);
+  if (!reader.valid()) {
+    return false;
+  }
+
   String line;
   int retry = 0;
   do {
-    line = client.readStringUntil('\r');
+    line = reader.readStringUntil('\r');
     ++retry;
   } while (line.length() == 0 && retry < 3);
 
-  client.readStringUntil('\n');
+  reader.readStringUntil('\n');
   //start reading the form
   if (line == ("--"+boundary)){
     RequestArgument* postArgs = new RequestArgument[32];
@@ -392,8 +379,8 @@ bool ESP8266WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t
       String argFilename;
       bool argIsFile = false;
 
-      line = client.readStringUntil('\r');
-      client.readStringUntil('\n');
+      line = reader.readStringUntil('\r');
+      reader.readStringUntil('\n');
       if (line.length() > 19 && line.substring(0, 19).equalsIgnoreCase(F("Content-Disposition"))){
         int nameStart = line.indexOf('=');
         if (nameStart != -1){
@@ -419,13 +406,13 @@ bool ESP8266WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t
 #endif
           using namespace mime;
           argType = FPSTR(mimeTable[txt].mimeType);
-          line = client.readStringUntil('\r');
-          client.readStringUntil('\n');
+          line = reader.readStringUntil('\r');
+          reader.readStringUntil('\n');
           if (line.length() > 12 && line.substring(0, 12).equalsIgnoreCase(FPSTR(Content_Type))){
             argType = line.substring(line.indexOf(':')+2);
             //skip next line
-            client.readStringUntil('\r');
-            client.readStringUntil('\n');
+            reader.readStringUntil('\r');
+            reader.readStringUntil('\n');
           }
 #ifdef DEBUG_ESP_HTTP_SERVER
           DEBUG_OUTPUT.print("PostArg Type: ");
@@ -433,8 +420,8 @@ bool ESP8266WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t
 #endif
           if (!argIsFile){
             while(1){
-              line = client.readStringUntil('\r');
-              client.readStringUntil('\n');
+              line = reader.readStringUntil('\r');
+              reader.readStringUntil('\n');
               if (line.startsWith("--"+boundary)) break;
               if (argValue.length() > 0) argValue += "\n";
               argValue += line;
@@ -472,80 +459,39 @@ bool ESP8266WebServer::_parseForm(WiFiClient& client, String boundary, uint32_t
             if(_currentHandler && _currentHandler->canUpload(_currentUri))
               _currentHandler->upload(*this, _currentUri, *_currentUpload);
             _currentUpload->status = UPLOAD_FILE_WRITE;
-            uint8_t argByte = _uploadReadByte(client);
-readfile:
-            while(argByte != 0x0D){
-              if (!client.connected()) return _parseFormUploadAborted();
-              _uploadWriteByte(argByte);
-              argByte = _uploadReadByte(client);
-            }
-
-            argByte = _uploadReadByte(client);
-            if (!client.connected()) return _parseFormUploadAborted();
-            if (argByte == 0x0A){
-              argByte = _uploadReadByte(client);
-              if (!client.connected()) return _parseFormUploadAborted();
-              if ((char)argByte != '-'){
-                //continue reading the file
-                _uploadWriteByte(0x0D);
-                _uploadWriteByte(0x0A);
-                goto readfile;
-              } else {
-                argByte = _uploadReadByte(client);
-                if (!client.connected()) return _parseFormUploadAborted();
-                if ((char)argByte != '-'){
-                  //continue reading the file
-                  _uploadWriteByte(0x0D);
-                  _uploadWriteByte(0x0A);
-                  _uploadWriteByte((uint8_t)('-'));
-                  goto readfile;
-                }
-              }
-
-              uint8_t endBuf[boundary.length()];
-              client.readBytes(endBuf, boundary.length());
-
-              if (strstr((const char*)endBuf, boundary.c_str()) != NULL){
-                if(_currentHandler && _currentHandler->canUpload(_currentUri))
-                  _currentHandler->upload(*this, _currentUri, *_currentUpload);
-                _currentUpload->totalSize += _currentUpload->currentSize;
-                _currentUpload->status = UPLOAD_FILE_END;
-                if(_currentHandler && _currentHandler->canUpload(_currentUri))
-                  _currentHandler->upload(*this, _currentUri, *_currentUpload);
+            size_t tail;
+            bool found = reader.readPart(_currentUpload->buf, HTTP_UPLOAD_BUFLEN, tail, [this](size_t ready) {
+              _currentUpload->currentSize = ready;
+              if(_currentHandler && _currentHandler->canUpload(_currentUri))
+                _currentHandler->upload(*this, _currentUri, *_currentUpload);
+              _currentUpload->totalSize += _currentUpload->currentSize;
+              _currentUpload->currentSize = 0;
+            });
+            if (!found) return _parseFormUploadAborted();
+
+            _currentUpload->currentSize = tail;
+            if(_currentHandler && _currentHandler->canUpload(_currentUri))
+              _currentHandler->upload(*this, _currentUri, *_currentUpload);
+            _currentUpload->totalSize += _currentUpload->currentSize;
+            _currentUpload->status = UPLOAD_FILE_END;
+            if(_currentHandler && _currentHandler->canUpload(_currentUri))
+              _currentHandler->upload(*this, _currentUri, *_currentUpload);
 #ifdef DEBUG_ESP_HTTP_SERVER
-                DEBUG_OUTPUT.print("End File: ");
-                DEBUG_OUTPUT.print(_currentUpload->filename);
-                DEBUG_OUTPUT.print(" Type: ");
-                DEBUG_OUTPUT.print(_currentUpload->type);
-                DEBUG_OUTPUT.print(" Size: ");
-                DEBUG_OUTPUT.println(_currentUpload->totalSize);
+            DEBUG_OUTPUT.print("End File: ");
+            DEBUG_OUTPUT.print(_currentUpload->filename);
+            DEBUG_OUTPUT.print(" Type: ");
+            DEBUG_OUTPUT.print(_currentUpload->type);
+            DEBUG_OUTPUT.print(" Size: ");
+            DEBUG_OUTPUT.println(_currentUpload->totalSize);
 #endif
-                line = client.readStringUntil(0x0D);
-                client.readStringUntil(0x0A);
-                if (line == "--"){
+            line = reader.readStringUntil(0x0D);
+            reader.readStringUntil(0x0A);
+            if (line == "--"){
 #ifdef DEBUG_ESP_HTTP_SERVER
-                  DEBUG_OUTPUT.println("Done Parsing POST");
+              DEBUG_OUTPUT.println("Done Parsing POST");
 #endif
-                  break;
-                }
-                continue;
-              } else {
-                _uploadWriteByte(0x0D);
-                _uploadWriteByte(0x0A);
-                _uploadWriteByte((uint8_t)('-'));
-                _uploadWriteByte((uint8_t)('-'));
-                uint32_t i = 0;
-                while(i < boundary.length()){
-                  _uploadWriteByte(endBuf[i++]);
-                }
-                argByte = _uploadReadByte(client);
-                goto readfile;
-              }
-            } else {
-              _uploadWriteByte(0x0D);
-              goto readfile;
+              break;
             }
-            break;
           }
         }
       }
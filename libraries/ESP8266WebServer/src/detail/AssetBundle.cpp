@@ -0,0 +1,41 @@
+/*
+  AssetBundle.cpp - static web assets packed into flash.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "AssetBundle.h"
+#include "pgmspace.h"
+
+bool AssetBundle::find(const char* path, AssetEntry& entry) const
+{
+  size_t lo = 0;
+  size_t hi = count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    const char* midPath = (const char*) pgm_read_ptr(&entries[mid].path);
+    int cmp = strcmp_P(path, midPath);
+    if (cmp == 0) {
+      memcpy_P(&entry, &entries[mid], sizeof(entry));
+      return true;
+    }
+    if (cmp < 0) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return false;
+}
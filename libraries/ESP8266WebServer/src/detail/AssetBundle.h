@@ -0,0 +1,52 @@
+/*
+  AssetBundle.h - static web assets packed into flash.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef ASSETBUNDLE_H
+#define ASSETBUNDLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bundles are generated by tools/webassets.py. All strings, the index and the
+// data image live in PROGMEM; the index is sorted by path (strcmp order) so a
+// request is resolved with a single binary search.
+
+#define ASSET_FLAG_GZIP 0x01
+
+struct AssetEntry
+{
+  const char* path;      // request path, e.g. "/js/app.js"
+  const char* mimeType;  // Content-Type to send
+  const char* etag;      // quoted entity tag
+  uint32_t offset;       // start of the (possibly compressed) body in data
+  uint32_t length;       // number of bytes to send
+  uint32_t flags;        // ASSET_FLAG_*
+};
+
+struct AssetBundle
+{
+  const uint8_t* data;
+  const AssetEntry* entries;
+  size_t count;
+
+  // Look up path in the index and copy the matching entry into entry.
+  // Returns false if the bundle has no such path.
+  bool find(const char* path, AssetEntry& entry) const;
+};
+
+#endif //ASSETBUNDLE_H
@@ -0,0 +1,141 @@
+/*
+  ChunkedWriter.cpp - buffered chunked transfer-encoding for responses.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Arduino.h>
+#include "ChunkedWriter.h"
+
+// Room in front of the data for the size line ("ffff\r\n")
+static const size_t CHUNK_HEAD_LEN = 6;
+// The CRLF closing a chunk, followed by the last chunk "0\r\n\r\n"
+static const size_t CHUNK_TAIL_LEN = 2 + 5;
+// Used when begin() could not allocate a buffer
+static const size_t CHUNK_LOCAL_BUFLEN = 64;
+
+ChunkedWriter::ChunkedWriter(Output output)
+: _output(output)
+, _buf(nullptr)
+, _size(0)
+, _fill(0)
+, _active(false)
+{
+}
+
+ChunkedWriter::~ChunkedWriter()
+{
+    free(_buf);
+}
+
+size_t ChunkedWriter::_payloadSize(size_t size)
+{
+    return size - CHUNK_HEAD_LEN - CHUNK_TAIL_LEN;
+}
+
+void ChunkedWriter::begin(size_t segmentSize)
+{
+    // the size line has room for four hex digits
+    if (segmentSize > 0xffff)
+        segmentSize = 0xffff;
+    if (segmentSize < CHUNK_LOCAL_BUFLEN)
+        segmentSize = CHUNK_LOCAL_BUFLEN;
+    free(_buf);
+    _buf = (char*) malloc(segmentSize);
+    _size = _buf ? segmentSize : 0;
+    _fill = 0;
+    _active = true;
+}
+
+size_t ChunkedWriter::write(const char* data, size_t len)
+{
+    return _write(data, len, false);
+}
+
+size_t ChunkedWriter::write_P(PGM_P data, size_t len)
+{
+    return _write(data, len, true);
+}
+
+size_t ChunkedWriter::_write(const char* data, size_t len, bool progmem)
+{
+    char local[CHUNK_LOCAL_BUFLEN];
+    char* buf = _buf ? _buf : local;
+    size_t room = _payloadSize(_buf ? _size : sizeof(local));
+    size_t written = 0;
+    while (written < len) {
+        size_t n = len - written;
+        if (n > room - _fill)
+            n = room - _fill;
+        if (progmem)
+            memcpy_P(buf + CHUNK_HEAD_LEN + _fill, data + written, n);
+        else
+            memcpy(buf + CHUNK_HEAD_LEN + _fill, data + written, n);
+        _fill += n;
+        if (_fill == room && !_flush(buf, false))
+            return written;
+        written += n;
+    }
+    // the stack buffer does not outlive this call
+    if (!_buf && !_flush(buf, false))
+        return 0;
+    return written;
+}
+
+bool ChunkedWriter::_flush(char* buf, bool last)
+{
+    static const char hex[] = "0123456789abcdef";
+    size_t start = CHUNK_HEAD_LEN;
+    size_t pos = CHUNK_HEAD_LEN + _fill;
+    if (_fill) {
+        buf[--start] = '\n';
+        buf[--start] = '\r';
+        for (size_t n = _fill; ; n >>= 4) {
+            buf[--start] = hex[n & 0xf];
+            if (n < 0x10)
+                break;
+        }
+        buf[pos++] = '\r';
+        buf[pos++] = '\n';
+    }
+    if (last) {
+        memcpy(buf + pos, "0\r\n\r\n", 5);
+        pos += 5;
+    }
+    _fill = 0;
+    if (pos == start)
+        return true;
+    return _output(buf + start, pos - start) == pos - start;
+}
+
+bool ChunkedWriter::flush()
+{
+    if (!_buf)
+        return true;
+    return _flush(_buf, false);
+}
+
+bool ChunkedWriter::end()
+{
+    if (!_active)
+        return true;
+    char local[CHUNK_HEAD_LEN + CHUNK_TAIL_LEN];
+    bool ok = _flush(_buf ? _buf : local, true);
+    free(_buf);
+    _buf = nullptr;
+    _size = 0;
+    _active = false;
+    return ok;
+}
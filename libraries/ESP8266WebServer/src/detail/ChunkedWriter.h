@@ -0,0 +1,66 @@
+/*
+  ChunkedWriter.h - buffered chunked transfer-encoding for responses.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef CHUNKEDWRITER_H
+#define CHUNKEDWRITER_H
+
+#include <stddef.h>
+#include <functional>
+#include "pgmspace.h"
+
+// Encodes a response body as HTTP/1.1 chunks. Small writes are collected
+// in a buffer and leave as one chunk once the buffer holds a full segment,
+// so a page built from many short sendContent() calls goes out in full
+// sized segments instead of three tiny ones per call. The chunk size line
+// and the trailing CRLF are framed around the data in place and sent in
+// the same write, as is the terminating chunk.
+class ChunkedWriter {
+public:
+    typedef std::function<size_t(const char* data, size_t len)> Output;
+
+    ChunkedWriter(Output output);
+    ~ChunkedWriter();
+    ChunkedWriter(const ChunkedWriter&) = delete;
+    ChunkedWriter& operator=(const ChunkedWriter&) = delete;
+
+    // Start a body whose writes will be at most segmentSize bytes, framing
+    // included. If the buffer cannot be allocated every write() becomes a
+    // chunk of its own.
+    void begin(size_t segmentSize);
+    size_t write(const char* data, size_t len);
+    size_t write_P(PGM_P data, size_t len);
+    // Send what is buffered as a chunk
+    bool flush();
+    // Send what is buffered and the terminating chunk, release the buffer
+    bool end();
+
+    bool active() const { return _active; }
+
+protected:
+    size_t _write(const char* data, size_t len, bool progmem);
+    bool _flush(char* buf, bool last);
+    static size_t _payloadSize(size_t size);
+
+    Output _output;
+    char* _buf;
+    size_t _size;
+    size_t _fill;
+    bool _active;
+};
+
+#endif //CHUNKEDWRITER_H
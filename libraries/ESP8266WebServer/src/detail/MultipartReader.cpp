@@ -0,0 +1,176 @@
+/*
+  MultipartReader.cpp - buffered reader for multipart/form-data bodies.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Arduino.h>
+#include "MultipartReader.h"
+
+MultipartReader::MultipartReader(Client& client, const String& boundary)
+: _client(client)
+, _delimLen(0)
+, _pending(nullptr)
+, _pendingLen(0)
+, _pendingPos(0)
+{
+    _timeout = 5000;
+    size_t boundaryLen = boundary.length();
+    if (boundaryLen == 0 || boundaryLen > MULTIPART_MAX_BOUNDARY_LEN) {
+        return;
+    }
+    memcpy(_delim, "\r\n--", 4);
+    memcpy(_delim + 4, boundary.c_str(), boundaryLen);
+    _delimLen = boundaryLen + 4;
+
+    // Horspool bad character table: how far the window may shift when the
+    // byte under its last position is c
+    memset(_skip, _delimLen, sizeof(_skip));
+    for (size_t i = 0; i < _delimLen - 1; i++) {
+        _skip[_delim[i]] = _delimLen - 1 - i;
+    }
+}
+
+MultipartReader::~MultipartReader()
+{
+    free(_pending);
+}
+
+int MultipartReader::available()
+{
+    return (_pendingLen - _pendingPos) + _client.available();
+}
+
+int MultipartReader::read()
+{
+    if (_pendingPos < _pendingLen) {
+        uint8_t c = _pending[_pendingPos++];
+        if (_pendingPos == _pendingLen) {
+            free(_pending);
+            _pending = nullptr;
+            _pendingLen = _pendingPos = 0;
+        }
+        return c;
+    }
+    return _client.read();
+}
+
+int MultipartReader::peek()
+{
+    if (_pendingPos < _pendingLen) {
+        return _pending[_pendingPos];
+    }
+    return _client.peek();
+}
+
+size_t MultipartReader::_fill(uint8_t* dst, size_t size)
+{
+    if (_pendingPos < _pendingLen) {
+        size_t count = _pendingLen - _pendingPos;
+        if (count > size) {
+            count = size;
+        }
+        memcpy(dst, _pending + _pendingPos, count);
+        _pendingPos += count;
+        if (_pendingPos == _pendingLen) {
+            free(_pending);
+            _pending = nullptr;
+            _pendingLen = _pendingPos = 0;
+        }
+        return count;
+    }
+
+    int avail = _client.available();
+    if (avail <= 0) {
+        return 0;
+    }
+    if ((size_t) avail < size) {
+        size = avail;
+    }
+    int res = _client.read(dst, size);
+    return (res > 0) ? res : 0;
+}
+
+size_t MultipartReader::_search(const uint8_t* data, size_t from, size_t len) const
+{
+    size_t last = _delimLen - 1;
+    size_t pos = from;
+    while (pos + _delimLen <= len) {
+        uint8_t c = data[pos + last];
+        if (c == _delim[last] && memcmp(data + pos, _delim, last) == 0) {
+            return pos;
+        }
+        pos += _skip[c];
+    }
+    return len;
+}
+
+bool MultipartReader::readPart(uint8_t* buf, size_t size, size_t& tail, TFlushFunction flush)
+{
+    tail = 0;
+    if (!valid() || size <= _delimLen) {
+        return false;
+    }
+
+    // bytes before `scanned` are known not to start a delimiter
+    size_t len = 0;
+    size_t scanned = 0;
+    while (true) {
+        size_t got = _fill(buf + len, size - len);
+        if (!got) {
+            if (!_client.connected()) {
+                return false;
+            }
+            yield();
+            continue;
+        }
+        len += got;
+
+        size_t pos = _search(buf, scanned, len);
+        if (pos < len) {
+            size_t end = pos + _delimLen;
+            if (end < len) {
+                // hand back whatever was read past the delimiter
+                size_t extra = len - end;
+                uint8_t* pending = (uint8_t*) malloc(extra + (_pendingLen - _pendingPos));
+                if (!pending) {
+                    return false;
+                }
+                memcpy(pending, buf + end, extra);
+                if (_pendingPos < _pendingLen) {
+                    memcpy(pending + extra, _pending + _pendingPos, _pendingLen - _pendingPos);
+                }
+                extra += _pendingLen - _pendingPos;
+                free(_pending);
+                _pending = pending;
+                _pendingLen = extra;
+                _pendingPos = 0;
+            }
+            tail = pos;
+            return true;
+        }
+        scanned = (len >= _delimLen) ? len - _delimLen + 1 : 0;
+
+        if (len == size) {
+            // keep what could still be the start of a delimiter
+            size_t keep = _delimLen - 1;
+            size_t ready = len - keep;
+            flush(ready);
+            memmove(buf, buf + ready, keep);
+            len = keep;
+            scanned -= ready;
+        }
+    }
+}
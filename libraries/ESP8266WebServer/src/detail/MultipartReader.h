@@ -0,0 +1,73 @@
+/*
+  MultipartReader.h - buffered reader for multipart/form-data bodies.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef MULTIPARTREADER_H
+#define MULTIPARTREADER_H
+
+#include <functional>
+#include "Client.h"
+#include "WString.h"
+
+// RFC 2046 limits boundaries to 70 characters
+#define MULTIPART_MAX_BOUNDARY_LEN 70
+
+// Wraps the client a multipart body is read from.
+// Part headers and form fields are read through the Stream interface, one
+// byte at a time as before. Part bodies are read with readPart(), which pulls
+// data from the client in bulk and locates the closing delimiter with a
+// Boyer-Moore-Horspool search, so uploads are handed over in large spans.
+class MultipartReader : public Stream {
+public:
+    typedef std::function<void(size_t)> TFlushFunction;
+
+    MultipartReader(Client& client, const String& boundary);
+    virtual ~MultipartReader();
+
+    // false if the boundary is empty or too long to be valid
+    bool valid() const { return _delimLen > 4; }
+
+    // Read the body of the current part into buf, up to the next
+    // "\r\n--boundary" delimiter. Each time buf fills up, flush(len) is called
+    // with the number of leading bytes of buf that belong to the body; these
+    // may be consumed before flush returns. On success, tail is set to the
+    // number of body bytes remaining in buf and the stream is positioned just
+    // after the delimiter. Returns false if the client disconnects first.
+    bool readPart(uint8_t* buf, size_t size, size_t& tail, TFlushFunction flush);
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override { }
+    size_t write(uint8_t) override { return 0; }
+
+protected:
+    size_t _fill(uint8_t* dst, size_t size);
+    size_t _search(const uint8_t* data, size_t from, size_t len) const;
+
+    Client& _client;
+    uint8_t _delim[MULTIPART_MAX_BOUNDARY_LEN + 4];
+    size_t _delimLen;
+    uint8_t _skip[256];
+
+    // bytes read past the end of the last part body, served before _client
+    uint8_t* _pending;
+    size_t _pendingLen;
+    size_t _pendingPos;
+};
+
+#endif //MULTIPARTREADER_H
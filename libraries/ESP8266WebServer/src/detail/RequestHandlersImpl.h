@@ -3,6 +3,8 @@
 
 #include "RequestHandler.h"
 #include "mimetable.h"
+#include "conditional.h"
+#include "AssetBundle.h"
 #include "WString.h"
 
 using namespace mime;
@@ -144,5 +146,63 @@ protected:
     size_t _baseUriLength;
 };
 
+class AssetBundleRequestHandler : public RequestHandler {
+public:
+    AssetBundleRequestHandler(const AssetBundle& bundle, const char* uri, const char* cache_header)
+    : _bundle(bundle)
+    , _uri(uri)
+    , _cache_header(cache_header)
+    {
+        // bundle paths keep their leading slash
+        _baseUriLength = _uri.endsWith("/") ? _uri.length() - 1 : _uri.length();
+        DEBUGV("AssetBundleRequestHandler: uri=%s entries=%d, cache_header=%s\r\n", uri, _bundle.count, cache_header);
+    }
+
+    bool canHandle(HTTPMethod requestMethod, String requestUri) override  {
+        if (requestMethod != HTTP_GET)
+            return false;
+
+        if (!requestUri.startsWith(_uri))
+            return false;
+
+        return true;
+    }
+
+    bool handle(ESP8266WebServer& server, HTTPMethod requestMethod, String requestUri) override {
+        if (!canHandle(requestMethod, requestUri))
+            return false;
+
+        AssetEntry entry;
+        if (!_bundle.find(requestUri.c_str() + _baseUriLength, entry))
+            return false;
+
+        DEBUGV("AssetBundleRequestHandler::handle: request=%s offset=%u length=%u\r\n", requestUri.c_str(), entry.offset, entry.length);
+
+        String etag = FPSTR(entry.etag);
+        if (_cache_header.length() != 0)
+            server.sendHeader("Cache-Control", _cache_header);
+        server.sendHeader("ETag", etag);
+        // caches must not hand the encoded body to clients that did not
+        // ask for it; the 304 carries the same header as the 200
+        if (entry.flags & ASSET_FLAG_GZIP)
+            server.sendHeader("Vary", "Accept-Encoding");
+
+        if (conditional::etagMatches(server.header(F("If-None-Match")), etag)) {
+            server.send(304);
+            return true;
+        }
+
+        if (entry.flags & ASSET_FLAG_GZIP)
+            server.sendHeader("Content-Encoding", "gzip");
+        server.send_P(200, entry.mimeType, (PGM_P) (_bundle.data + entry.offset), entry.length);
+        return true;
+    }
+
+protected:
+    AssetBundle _bundle;
+    String _uri;
+    String _cache_header;
+    size_t _baseUriLength;
+};
 
 #endif //REQUESTHANDLERSIMPL_H
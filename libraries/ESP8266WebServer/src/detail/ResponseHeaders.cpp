@@ -0,0 +1,169 @@
+/*
+  ResponseHeaders.cpp - response status line and header buffer.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <algorithm>
+#include <Arduino.h>
+#include "ResponseHeaders.h"
+
+ResponseHeaders::ResponseHeaders()
+: _buf(_inline)
+, _capacity(sizeof(_inline))
+, _len(0)
+{
+}
+
+ResponseHeaders::~ResponseHeaders()
+{
+    if (_buf != _inline)
+        free(_buf);
+}
+
+bool ResponseHeaders::_reserve(size_t len)
+{
+    if (_len + len <= _capacity)
+        return true;
+
+    size_t capacity = _capacity * 2;
+    while (capacity < _len + len)
+        capacity *= 2;
+    char* buf = (char*) malloc(capacity);
+    if (!buf)
+        return false;
+    memcpy(buf, _buf, _len);
+    if (_buf != _inline)
+        free(_buf);
+    _buf = buf;
+    _capacity = capacity;
+    return true;
+}
+
+bool ResponseHeaders::_append(const char* data, size_t len)
+{
+    if (!_reserve(len))
+        return false;
+    memcpy(_buf + _len, data, len);
+    _len += len;
+    return true;
+}
+
+bool ResponseHeaders::_append_P(PGM_P data, size_t len)
+{
+    if (!_reserve(len))
+        return false;
+    memcpy_P(_buf + _len, data, len);
+    _len += len;
+    return true;
+}
+
+bool ResponseHeaders::_appendNumber(uint32_t value)
+{
+    char digits[11];
+    size_t pos = sizeof(digits);
+    do {
+        digits[--pos] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    return _append(digits + pos, sizeof(digits) - pos);
+}
+
+void ResponseHeaders::_moveToFront(size_t from, size_t to)
+{
+    std::rotate(_buf, _buf + from, _buf + to);
+}
+
+bool ResponseHeaders::add(const String& name, const String& value, bool first)
+{
+    size_t start = _len;
+    if (!_append(name.c_str(), name.length()) ||
+        !_append(": ", 2) ||
+        !_append(value.c_str(), value.length()) ||
+        !_append("\r\n", 2)) {
+        _len = start;
+        return false;
+    }
+    if (first)
+        _moveToFront(start, _len);
+    return true;
+}
+
+bool ResponseHeaders::add_P(PGM_P name, PGM_P value, bool first)
+{
+    size_t start = _len;
+    if (!_append_P(name, strlen_P(name)) ||
+        !_append(": ", 2) ||
+        !_append_P(value, strlen_P(value)) ||
+        !_append("\r\n", 2)) {
+        _len = start;
+        return false;
+    }
+    if (first)
+        _moveToFront(start, _len);
+    return true;
+}
+
+bool ResponseHeaders::add_P(PGM_P name, uint32_t value, bool first)
+{
+    size_t start = _len;
+    if (!_append_P(name, strlen_P(name)) ||
+        !_append(": ", 2) ||
+        !_appendNumber(value) ||
+        !_append("\r\n", 2)) {
+        _len = start;
+        return false;
+    }
+    if (first)
+        _moveToFront(start, _len);
+    return true;
+}
+
+bool ResponseHeaders::finish(uint8_t version, int code, PGM_P reason)
+{
+    size_t start = _len;
+    if (!_append("HTTP/1.", 7) ||
+        !_appendNumber(version) ||
+        !_append(" ", 1) ||
+        !_appendNumber(code) ||
+        !_append(" ", 1) ||
+        !_append_P(reason, strlen_P(reason)) ||
+        !_append("\r\n", 2)) {
+        _len = start;
+        return false;
+    }
+    _moveToFront(start, _len);
+    return _append("\r\n", 2);
+}
+
+size_t ResponseHeaders::fill(const char* data, size_t len)
+{
+    size_t room = _capacity - _len;
+    if (len > room)
+        len = room;
+    memcpy(_buf + _len, data, len);
+    _len += len;
+    return len;
+}
+
+size_t ResponseHeaders::fill_P(PGM_P data, size_t len)
+{
+    size_t room = _capacity - _len;
+    if (len > room)
+        len = room;
+    memcpy_P(_buf + _len, data, len);
+    _len += len;
+    return len;
+}
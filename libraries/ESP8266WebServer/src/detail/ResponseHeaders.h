@@ -0,0 +1,77 @@
+/*
+  ResponseHeaders.h - response status line and header buffer.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef RESPONSEHEADERS_H
+#define RESPONSEHEADERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "pgmspace.h"
+#include "WString.h"
+
+#ifndef HTTP_HEADER_BUFLEN
+#define HTTP_HEADER_BUFLEN 512
+#endif
+
+// Collects the headers of a response in a buffer that is reused from one
+// response to the next. Names and values may be given as PGM_P; they are
+// copied with the _P functions, so RAM pointers work as well.
+// The buffer lives inside the object; only headers that do not fit in
+// HTTP_HEADER_BUFLEN bytes make it move to (and stay on) the heap.
+class ResponseHeaders {
+public:
+    ResponseHeaders();
+    ~ResponseHeaders();
+    ResponseHeaders(const ResponseHeaders&) = delete;
+    ResponseHeaders& operator=(const ResponseHeaders&) = delete;
+
+    // Forget all headers and body bytes, keeping the buffer
+    void clear() { _len = 0; }
+
+    // Add "name: value\r\n". A header added with first = true goes before
+    // all headers added so far.
+    bool add(const String& name, const String& value, bool first = false);
+    bool add_P(PGM_P name, PGM_P value, bool first = false);
+    bool add_P(PGM_P name, uint32_t value, bool first = false);
+
+    // Put the status line in front of the headers and terminate them with
+    // an empty line. After this the buffer holds a complete response head.
+    bool finish(uint8_t version, int code, PGM_P reason);
+
+    // Append as much of the body as fits without growing the buffer, so it
+    // leaves in the same write as the head. Returns the number of bytes taken.
+    size_t fill(const char* data, size_t len);
+    size_t fill_P(PGM_P data, size_t len);
+
+    const char* data() const { return _buf; }
+    size_t length() const { return _len; }
+
+protected:
+    bool _reserve(size_t len);
+    bool _append(const char* data, size_t len);
+    bool _append_P(PGM_P data, size_t len);
+    bool _appendNumber(uint32_t value);
+    void _moveToFront(size_t from, size_t to);
+
+    char _inline[HTTP_HEADER_BUFLEN];
+    char* _buf;
+    size_t _capacity;
+    size_t _len;
+};
+
+#endif //RESPONSEHEADERS_H
@@ -0,0 +1,138 @@
+/*
+  conditional.cpp - conditional and range request helpers.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <Arduino.h>
+#include "conditional.h"
+
+namespace conditional
+{
+
+static const char* skipWeak(const char* tag)
+{
+  if (tag[0] == 'W' && tag[1] == '/')
+    return tag + 2;
+  return tag;
+}
+
+bool etagMatches(const String& ifNoneMatch, const String& etag)
+{
+  if (!etag.length() || !ifNoneMatch.length())
+    return false;
+
+  const char* tag = skipWeak(etag.c_str());
+  size_t tagLen = strlen(tag);
+  const char* p = ifNoneMatch.c_str();
+  while (*p) {
+    while (*p == ' ' || *p == '\t' || *p == ',')
+      ++p;
+    if (*p == '*')
+      return true;
+    const char* start = skipWeak(p);
+    const char* end = start;
+    if (*end == '"') {
+      end = strchr(end + 1, '"');
+      if (!end)
+        return false;
+      ++end;
+    } else {
+      while (*end && *end != ',' && *end != ' ' && *end != '\t')
+        ++end;
+    }
+    if ((size_t)(end - start) == tagLen && memcmp(start, tag, tagLen) == 0)
+      return true;
+    p = end;
+  }
+  return false;
+}
+
+uint32_t contentHash(uint32_t hash, const uint8_t* data, size_t len)
+{
+  while (len--) {
+    hash ^= *data++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+String fileETag(size_t size, uint32_t hash)
+{
+  char buf[26];
+  sprintf(buf, "W/\"%x-%08x\"", (unsigned) size, (unsigned) hash);
+  return String(buf);
+}
+
+static bool parseNumber(const char*& p, size_t& value)
+{
+  if (*p < '0' || *p > '9')
+    return false;
+  value = 0;
+  while (*p >= '0' && *p <= '9') {
+    size_t next = value * 10 + (*p - '0');
+    if (next < value)
+      return false;
+    value = next;
+    ++p;
+  }
+  return true;
+}
+
+RangeResult parseRange(const String& range, size_t size, size_t& start, size_t& end)
+{
+  const char* p = range.c_str();
+  while (*p == ' ')
+    ++p;
+  if (strncasecmp(p, "bytes", 5) != 0)
+    return RANGE_NONE;
+  p += 5;
+  while (*p == ' ')
+    ++p;
+  if (*p++ != '=')
+    return RANGE_NONE;
+  while (*p == ' ')
+    ++p;
+  if (strchr(p, ','))
+    return RANGE_NONE;
+
+  size_t first, last;
+  bool hasFirst = parseNumber(p, first);
+  if (*p++ != '-')
+    return RANGE_NONE;
+  bool hasLast = parseNumber(p, last);
+  while (*p == ' ')
+    ++p;
+  if (*p || (!hasFirst && !hasLast))
+    return RANGE_NONE;
+
+  if (!hasFirst) {
+    // suffix range: the last `last` bytes
+    if (last == 0 || size == 0)
+      return RANGE_UNSATISFIABLE;
+    start = (last < size) ? size - last : 0;
+    end = size - 1;
+    return RANGE_OK;
+  }
+  if (hasLast && last < first)
+    return RANGE_NONE;
+  if (first >= size)
+    return RANGE_UNSATISFIABLE;
+  start = first;
+  end = (hasLast && last < size) ? last : size - 1;
+  return RANGE_OK;
+}
+
+}
@@ -0,0 +1,58 @@
+/*
+  conditional.h - conditional and range request helpers.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef CONDITIONAL_H
+#define CONDITIONAL_H
+
+#include "WString.h"
+
+namespace conditional
+{
+
+// True if the value of an If-None-Match request header lists etag
+// (or is "*"). Weak and strong tags compare equal, as RFC 7232 requires for
+// GET and HEAD.
+bool etagMatches(const String& ifNoneMatch, const String& etag);
+
+// FNV-1a hash of a file's content, fed len bytes at a time; start with
+// hash = CONTENT_HASH_INIT
+static const uint32_t CONTENT_HASH_INIT = 2166136261u;
+uint32_t contentHash(uint32_t hash, const uint8_t* data, size_t len);
+
+// Weak entity tag for a file from its size and content hash, since the
+// file system keeps no modification times. A 32 bit hash is not a byte
+// for byte guarantee, so the tag is only good for If-None-Match, never for
+// If-Range.
+String fileETag(size_t size, uint32_t hash);
+
+enum RangeResult
+{
+  RANGE_NONE,           // no usable range, send the whole body
+  RANGE_OK,             // send bytes [start, end]
+  RANGE_UNSATISFIABLE   // reply with 416
+};
+
+// Parse the value of a Range request header for a body of size bytes.
+// Only a single byte range is supported; anything else (including syntax
+// errors) yields RANGE_NONE, which RFC 7233 allows servers to answer with
+// the full representation.
+RangeResult parseRange(const String& range, size_t size, size_t& start, size_t& end);
+
+}
+
+#endif //CONDITIONAL_H
@@ -0,0 +1,97 @@
+/*
+    This sketch wakes from deep sleep, sends one UDP packet and sleeps
+    again, the way a battery powered sensor does. WiFiFastResume keeps the
+    AP and the address from one wake to the next, in RTC user memory.
+
+    It measures how long after the wake the packet is sent, and prints the
+    averages of the wakes that resumed the connection and of those that
+    made a full one, with a scan and DHCP.
+
+    GPIO16 must be wired to RST for the ESP to wake up.
+
+    This example code is in the public domain.
+*/
+
+#include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include <WiFiFastResume.h>
+
+const char* ssid = "your-ssid";
+const char* password = "your-password";
+
+IPAddress collector(192, 168, 1, 10);
+const uint16_t port = 4210;
+
+const uint32_t sleepTime = 10e6; // us
+
+// WiFiFastResume at the start of RTC user memory, the statistics after it
+WiFiFastResume fastResume(0);
+const uint32_t statsOffset = WiFiFastResume::blocks;
+
+const uint32_t statsMagic = 0x57465253;
+
+struct Stats {
+  uint32_t magic;
+  uint32_t count[2];     // full, resumed
+  uint32_t total[2];     // ms from wake to send
+  uint32_t fastest[2];
+  uint32_t slowest[2];
+} stats;
+
+WiFiUDP udp;
+
+void loadStats() {
+  if (!ESP.rtcUserMemoryRead(statsOffset, (uint32_t*) &stats, sizeof(stats)) || stats.magic != statsMagic) {
+    memset(&stats, 0, sizeof(stats));
+    stats.magic = statsMagic;
+    stats.fastest[0] = stats.fastest[1] = UINT32_MAX;
+  }
+}
+
+void addStat(bool resumed, uint32_t ms) {
+  stats.count[resumed]++;
+  stats.total[resumed] += ms;
+  stats.fastest[resumed] = min(stats.fastest[resumed], ms);
+  stats.slowest[resumed] = max(stats.slowest[resumed], ms);
+  ESP.rtcUserMemoryWrite(statsOffset, (uint32_t*) &stats, sizeof(stats));
+}
+
+void printStat(const char* name, int i) {
+  if (!stats.count[i]) {
+    return;
+  }
+  Serial.printf("%s: %u wakes, %u ms average, %u..%u ms\n", name, stats.count[i],
+                stats.total[i] / stats.count[i], stats.fastest[i], stats.slowest[i]);
+}
+
+void setup() {
+  // nothing to flash, the same configuration is used each time
+  WiFi.persistent(false);
+
+  if (fastResume.begin(ssid, password) == WL_CONNECTED) {
+    udp.beginPacket(collector, port);
+    udp.printf("hello from %08x", ESP.getChipId());
+    udp.endPacket();
+    // millis() starts at the wake
+    uint32_t sent = millis();
+    loadStats();
+    addStat(fastResume.resumed(), sent);
+
+    Serial.begin(115200);
+    Serial.println();
+    Serial.printf("%s, sent %u ms after the wake (connected in %u ms)\n",
+                  fastResume.resumed() ? "resumed" : "full connection", sent, fastResume.connectTime());
+    printStat("full", 0);
+    printStat("resumed", 1);
+  } else {
+    Serial.begin(115200);
+    Serial.println();
+    Serial.println("not connected");
+  }
+
+  // counts the sleep against the DHCP lease, so it is renewed in time
+  fastResume.deepSleep(sleepTime);
+}
+
+void loop() {
+}
@@ -27,6 +27,10 @@
 #include <limits.h>
 #include <string.h>
 
+static uint32_t ssidCRC(const char* ssid) {
+    return rtcCRC32(ssid, strlen(ssid));
+}
+
 ESP8266WiFiMulti::ESP8266WiFiMulti() {
 }
 
@@ -43,6 +47,11 @@ wl_status_t ESP8266WiFiMulti::run(void) {
     wl_status_t status = WiFi.status();
     if(status == WL_DISCONNECTED || status == WL_NO_SSID_AVAIL || status == WL_IDLE_STATUS || status == WL_CONNECT_FAILED) {
 
+        if(!_connecting) {
+            _connecting = true;
+            _connectStart = millis();
+        }
+
         int8_t scanResult = WiFi.scanComplete();
 
         if(scanResult == WIFI_SCAN_RUNNING) {
@@ -78,25 +87,24 @@ wl_status_t ESP8266WiFiMulti::run(void) {
             DEBUG_WIFI_MULTI("[WIFI] %d networks found\n", scanResult);
             for(int8_t i = 0; i < scanResult; ++i) {
 
-                String ssid_scan;
-                int32_t rssi_scan;
-                uint8_t sec_scan;
-                uint8_t* BSSID_scan;
-                int32_t chan_scan;
-                bool hidden_scan;
-
-                WiFi.getNetworkInfo(i, ssid_scan, sec_scan, rssi_scan, BSSID_scan, chan_scan, hidden_scan);
+                // straight from the scan table, no String per network
+                const WiFiScanEntry* scan = WiFi.getNetworkEntry(i);
+                const char* ssid_scan = scan->ssid;
+                int32_t rssi_scan = scan->rssi;
+                uint8_t sec_scan = scan->encryptionType;
+                const uint8_t* BSSID_scan = scan->bssid;
+                int32_t chan_scan = scan->channel;
 
                 bool known = false;
                 for(auto entry : APlist) {
-                    if(ssid_scan == entry.ssid) { // SSID match
+                    if(strcmp(ssid_scan, entry.ssid) == 0) { // SSID match
                         known = true;
                         if(rssi_scan > bestNetworkDb) { // best network
                             if(sec_scan == ENC_TYPE_NONE || entry.passphrase) { // check for passphrase if not open wlan
                                 bestNetworkDb = rssi_scan;
                                 bestChannel = chan_scan;
                                 bestNetwork = entry;
-                                memcpy((void*) &bestBSSID, (void*) BSSID_scan, sizeof(bestBSSID));
+                                memcpy((void*) &bestBSSID, (const void*) BSSID_scan, sizeof(bestBSSID));
                             }
                         }
                         break;
@@ -109,7 +117,7 @@ wl_status_t ESP8266WiFiMulti::run(void) {
                     DEBUG_WIFI_MULTI("      ");
                 }
 
-                DEBUG_WIFI_MULTI(" %d: [%d][%02X:%02X:%02X:%02X:%02X:%02X] %s (%d) %c\n", i, chan_scan, BSSID_scan[0], BSSID_scan[1], BSSID_scan[2], BSSID_scan[3], BSSID_scan[4], BSSID_scan[5], ssid_scan.c_str(), rssi_scan, (sec_scan == ENC_TYPE_NONE) ? ' ' : '*');
+                DEBUG_WIFI_MULTI(" %d: [%d][%02X:%02X:%02X:%02X:%02X:%02X] %s (%d) %c\n", i, chan_scan, BSSID_scan[0], BSSID_scan[1], BSSID_scan[2], BSSID_scan[3], BSSID_scan[4], BSSID_scan[5], ssid_scan, rssi_scan, (sec_scan == ENC_TYPE_NONE) ? ' ' : '*');
                 delay(0);
             }
 
@@ -122,42 +130,12 @@ wl_status_t ESP8266WiFiMulti::run(void) {
             if(bestNetwork.ssid) {
                 DEBUG_WIFI_MULTI("[WIFI] Connecting BSSID: %02X:%02X:%02X:%02X:%02X:%02X SSID: %s Channel: %d (%d)\n", bestBSSID[0], bestBSSID[1], bestBSSID[2], bestBSSID[3], bestBSSID[4], bestBSSID[5], bestNetwork.ssid, bestChannel, bestNetworkDb);
 
-                WiFi.begin(bestNetwork.ssid, bestNetwork.passphrase, bestChannel, bestBSSID);
-                status = WiFi.status();
-
-                static const uint32_t connectTimeout = 5000; //5s timeout
-                
-                auto startTime = millis();
-                // wait for connection, fail, or timeout
-                while(status != WL_CONNECTED && status != WL_NO_SSID_AVAIL && status != WL_CONNECT_FAILED && (millis() - startTime) <= connectTimeout) {
-                    delay(10);
-                    status = WiFi.status();
-                }
-                
-#ifdef DEBUG_ESP_WIFI
-                IPAddress ip;
-                uint8_t * mac;
-                switch(status) {
-                    case WL_CONNECTED:
-                        ip = WiFi.localIP();
-                        mac = WiFi.BSSID();
-                        DEBUG_WIFI_MULTI("[WIFI] Connecting done.\n");
-                        DEBUG_WIFI_MULTI("[WIFI] SSID: %s\n", WiFi.SSID().c_str());
-                        DEBUG_WIFI_MULTI("[WIFI] IP: %d.%d.%d.%d\n", ip[0], ip[1], ip[2], ip[3]);
-                        DEBUG_WIFI_MULTI("[WIFI] MAC: %02X:%02X:%02X:%02X:%02X:%02X\n", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-                        DEBUG_WIFI_MULTI("[WIFI] Channel: %d\n", WiFi.channel());
-                        break;
-                    case WL_NO_SSID_AVAIL:
-                        DEBUG_WIFI_MULTI("[WIFI] Connecting Failed AP not found.\n");
-                        break;
-                    case WL_CONNECT_FAILED:
-                        DEBUG_WIFI_MULTI("[WIFI] Connecting Failed.\n");
-                        break;
-                    default:
-                        DEBUG_WIFI_MULTI("[WIFI] Connecting Failed (%d).\n", status);
-                        break;
+                status = connectAP(bestNetwork, bestChannel, bestBSSID);
+                if(status == WL_CONNECTED) {
+                    ++_scanConnects;
+                    connectDone();
+                    saveLastAP(bestNetwork);
                 }
-#endif
             } else {
                 DEBUG_WIFI_MULTI("[WIFI] no matching wifi found!\n");
             }
@@ -166,6 +144,22 @@ wl_status_t ESP8266WiFiMulti::run(void) {
         }
        
        
+        // no scan to look at, try the last AP connected to before scanning
+        WifiAPEntry* last = lastAPEntry();
+        if(last) {
+            DEBUG_WIFI_MULTI("[WIFI] Connecting last BSSID: %02X:%02X:%02X:%02X:%02X:%02X SSID: %s Channel: %d\n", _lastAP.bssid[0], _lastAP.bssid[1], _lastAP.bssid[2], _lastAP.bssid[3], _lastAP.bssid[4], _lastAP.bssid[5], last->ssid, _lastAP.channel);
+
+            status = connectAP(*last, _lastAP.channel, _lastAP.bssid);
+            if(status == WL_CONNECTED) {
+                ++_fastConnects;
+                connectDone();
+                return status;
+            }
+            DEBUG_WIFI_MULTI("[WIFI] last AP failed, fall back to scan\n");
+            ++_fastFailures;
+            forgetAP();
+        }
+
         // scan failed, or some other condition not handled above. Start another scan.
         DEBUG_WIFI_MULTI("[WIFI] delete old wifi config...\n");
         WiFi.disconnect();
@@ -173,10 +167,110 @@ wl_status_t ESP8266WiFiMulti::run(void) {
         DEBUG_WIFI_MULTI("[WIFI] start scan\n");
         // scan wifi async mode
         WiFi.scanNetworks(true);
+    } else if(status == WL_CONNECTED && _connecting) {
+        // came up after connectAP() stopped waiting
+        connectDone();
+    }
+    return status;
+}
+
+bool ESP8266WiFiMulti::useRTCMemory(uint32_t offset) {
+    LastAP stored;
+    _useRTC = false;
+    _rtc.setOffset(offset);
+
+    if(_rtc.read(stored) && stored.valid) {
+        DEBUG_WIFI_MULTI("[WIFI] last AP restored from RTC memory\n");
+        _lastAP = stored;
+    } else if(!_rtc.write(_lastAP)) {
+        // only fails when the offset is out of range
+        DEBUG_WIFI_MULTI("[WIFI] RTC memory offset %u out of range\n", offset);
+        return false;
+    }
+    _useRTC = true;
+    return true;
+}
+
+void ESP8266WiFiMulti::forgetAP(void) {
+    _lastAP.valid = 0;
+    writeLastAP();
+}
+
+// ##################################################################################
+
+wl_status_t ESP8266WiFiMulti::connectAP(const WifiAPEntry& entry, int32_t channel, const uint8_t* bssid) {
+    WiFi.begin(entry.ssid, entry.passphrase, channel, bssid);
+    wl_status_t status = WiFi.status();
+
+    static const uint32_t connectTimeout = 5000; //5s timeout
+
+    auto startTime = millis();
+    // wait for connection, fail, or timeout
+    while(status != WL_CONNECTED && status != WL_NO_SSID_AVAIL && status != WL_CONNECT_FAILED && (millis() - startTime) <= connectTimeout) {
+        delay(10);
+        status = WiFi.status();
+    }
+
+#ifdef DEBUG_ESP_WIFI
+    IPAddress ip;
+    uint8_t * mac;
+    switch(status) {
+        case WL_CONNECTED:
+            ip = WiFi.localIP();
+            mac = WiFi.BSSID();
+            DEBUG_WIFI_MULTI("[WIFI] Connecting done.\n");
+            DEBUG_WIFI_MULTI("[WIFI] SSID: %s\n", WiFi.SSID().c_str());
+            DEBUG_WIFI_MULTI("[WIFI] IP: %d.%d.%d.%d\n", ip[0], ip[1], ip[2], ip[3]);
+            DEBUG_WIFI_MULTI("[WIFI] MAC: %02X:%02X:%02X:%02X:%02X:%02X\n", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+            DEBUG_WIFI_MULTI("[WIFI] Channel: %d\n", WiFi.channel());
+            break;
+        case WL_NO_SSID_AVAIL:
+            DEBUG_WIFI_MULTI("[WIFI] Connecting Failed AP not found.\n");
+            break;
+        case WL_CONNECT_FAILED:
+            DEBUG_WIFI_MULTI("[WIFI] Connecting Failed.\n");
+            break;
+        default:
+            DEBUG_WIFI_MULTI("[WIFI] Connecting Failed (%d).\n", status);
+            break;
     }
+#endif
     return status;
 }
 
+WifiAPEntry* ESP8266WiFiMulti::lastAPEntry(void) {
+    if(!_lastAP.valid) {
+        return NULL;
+    }
+    for(auto& entry : APlist) {
+        if(ssidCRC(entry.ssid) == _lastAP.ssidCrc) {
+            return &entry;
+        }
+    }
+    return NULL;
+}
+
+void ESP8266WiFiMulti::saveLastAP(const WifiAPEntry& entry) {
+    _lastAP.ssidCrc = ssidCRC(entry.ssid);
+    _lastAP.channel = WiFi.channel();
+    memcpy(_lastAP.bssid, WiFi.BSSID(), sizeof(_lastAP.bssid));
+    _lastAP.valid = 1;
+    writeLastAP();
+}
+
+void ESP8266WiFiMulti::writeLastAP(void) {
+    if(!_useRTC) {
+        return;
+    }
+    _rtc.write(_lastAP);
+}
+
+void ESP8266WiFiMulti::connectDone(void) {
+    _connecting = false;
+    _lastConnectTime = millis() - _connectStart;
+    DEBUG_WIFI_MULTI("[WIFI] connected in %u ms\n", _lastConnectTime);
+}
+
 // ##################################################################################
 
 bool ESP8266WiFiMulti::APlistAdd(const char* ssid, const char *passphrase) {
@@ -28,6 +28,7 @@
 #define WIFICLIENTMULTI_H_
 
 #include "ESP8266WiFi.h"
+#include "include/RTCRecord.h"
 #include <vector>
 
 #ifdef DEBUG_ESP_WIFI
@@ -56,11 +57,53 @@ class ESP8266WiFiMulti {
 
         wl_status_t run(void);
 
+        /// keep the last AP connected to in RTC user memory as well, at
+        /// offset (in 4 byte blocks, as ESP.rtcUserMemoryWrite takes it), so
+        /// it is tried first after a reset or deep sleep too
+        /// false, and RTC memory is not used, if offset is out of range
+        bool useRTCMemory(uint32_t offset);
+        /// forget the last AP, the next connection scans
+        void forgetAP(void);
+
+        /// connections made straight to the last AP, and by scanning
+        uint32_t fastConnects(void) const { return _fastConnects; }
+        uint32_t scanConnects(void) const { return _scanConnects; }
+        /// straight connections that failed, so a scan followed
+        uint32_t fastFailures(void) const { return _fastFailures; }
+        /// ms it took to get connected again, the last time
+        uint32_t lastConnectTime(void) const { return _lastConnectTime; }
+
     private:
+        // the last AP connected to
+        struct LastAP {
+            uint32_t ssidCrc;
+            int32_t channel;
+            uint8_t bssid[6];
+            uint8_t valid;
+            uint8_t reserved;
+        };
+
         WifiAPlist APlist;
         bool APlistAdd(const char* ssid, const char *passphrase = NULL);
         void APlistClean(void);
 
+        wl_status_t connectAP(const WifiAPEntry& entry, int32_t channel, const uint8_t* bssid);
+        WifiAPEntry* lastAPEntry(void);
+        void saveLastAP(const WifiAPEntry& entry);
+        void writeLastAP(void);
+        void connectDone(void);
+
+        LastAP _lastAP = { };
+        bool _useRTC = false;
+        RTCRecord<LastAP> _rtc;
+
+        bool _connecting = false;
+        uint32_t _connectStart = 0;
+        uint32_t _fastConnects = 0;
+        uint32_t _scanConnects = 0;
+        uint32_t _fastFailures = 0;
+        uint32_t _lastConnectTime = 0;
+
 };
 
 #endif /* WIFICLIENTMULTI_H_ */
@@ -44,8 +44,31 @@ extern "C" void esp_yield();
 // ---------------------------------------------------- Private functions ------------------------------------------------
 // -----------------------------------------------------------------------------------------------------------------------
 
+static uint8_t encryptionTypeOf(const bss_info* it) {
+    switch(it->authmode) {
+        case AUTH_OPEN:
+            return ENC_TYPE_NONE;
+        case AUTH_WEP:
+            return ENC_TYPE_WEP;
+        case AUTH_WPA_PSK:
+            return ENC_TYPE_TKIP;
+        case AUTH_WPA2_PSK:
+            return ENC_TYPE_CCMP;
+        case AUTH_WPA_WPA2_PSK:
+            return ENC_TYPE_AUTO;
+        default:
+            return -1;
+    }
+}
 
-
+static void ssidOf(const bss_info* it, char* ssid) {
+    size_t len = it->ssid_len;
+    if(len > 32) {
+        len = 32;
+    }
+    memcpy(ssid, it->ssid, len);
+    ssid[len] = 0;
+}
 
 // -----------------------------------------------------------------------------------------------------------------------
 // ----------------------------------------------------- scan function ---------------------------------------------------
@@ -55,8 +78,7 @@ bool ESP8266WiFiScanClass::_scanAsync = false;
 bool ESP8266WiFiScanClass::_scanStarted = false;
 bool ESP8266WiFiScanClass::_scanComplete = false;
 
-size_t ESP8266WiFiScanClass::_scanCount = 0;
-void* ESP8266WiFiScanClass::_scanResult = 0;
+ScanTable ESP8266WiFiScanClass::_scanTable;
 
 std::function<void(int)> ESP8266WiFiScanClass::_onComplete;
 
@@ -95,7 +117,7 @@ int8_t ESP8266WiFiScanClass::scanNetworks(bool async, bool show_hidden) {
         }
 
         esp_yield();
-        return ESP8266WiFiScanClass::_scanCount;
+        return ESP8266WiFiScanClass::_scanTable.size();
     } else {
         return WIFI_SCAN_FAILED;
     }
@@ -125,7 +147,7 @@ int8_t ESP8266WiFiScanClass::scanComplete() {
     }
 
     if(_scanComplete) {
-        return ESP8266WiFiScanClass::_scanCount;
+        return ESP8266WiFiScanClass::_scanTable.size();
     }
 
     return WIFI_SCAN_FAILED;
@@ -135,14 +157,21 @@ int8_t ESP8266WiFiScanClass::scanComplete() {
  * delete last scan result from RAM
  */
 void ESP8266WiFiScanClass::scanDelete() {
-    if(ESP8266WiFiScanClass::_scanResult) {
-        delete[] reinterpret_cast<bss_info*>(ESP8266WiFiScanClass::_scanResult);
-        ESP8266WiFiScanClass::_scanResult = 0;
-        ESP8266WiFiScanClass::_scanCount = 0;
-    }
+    ESP8266WiFiScanClass::_scanTable.clear();
     _scanComplete = false;
 }
 
+/**
+ * filter the results of the next scans
+ * @param minRSSI int8_t        weakest signal kept
+ * @param ssids const char**    networks kept, NULL for all
+ * @param ssidCount size_t      number of ssids
+ * @param maxResults uint8_t    most networks kept, the strongest, 0 for all
+ */
+void ESP8266WiFiScanClass::setScanFilter(int8_t minRSSI, const char* const* ssids, size_t ssidCount, uint8_t maxResults) {
+    ESP8266WiFiScanClass::_scanTable.setFilter(minRSSI, ssids, ssidCount, maxResults);
+}
+
 
 /**
  * loads all infos from a scanned wifi in to the ptr parameters
@@ -156,17 +185,17 @@ void ESP8266WiFiScanClass::scanDelete() {
  * @return (true if ok)
  */
 bool ESP8266WiFiScanClass::getNetworkInfo(uint8_t i, String &ssid, uint8_t &encType, int32_t &rssi, uint8_t* &bssid, int32_t &channel, bool &isHidden) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
+    const WiFiScanEntry* it = getNetworkEntry(i);
     if(!it) {
         return false;
     }
 
-    ssid = (const char*) it->ssid;
-    encType = encryptionType(i);
+    ssid = it->ssid;
+    encType = it->encryptionType;
     rssi = it->rssi;
-    bssid = it->bssid; // move ptr
+    bssid = const_cast<uint8_t*>(it->bssid); // move ptr
     channel = it->channel;
-    isHidden = (it->is_hidden != 0);
+    isHidden = it->isHidden;
 
     return true;
 }
@@ -178,12 +207,34 @@ bool ESP8266WiFiScanClass::getNetworkInfo(uint8_t i, String &ssid, uint8_t &encT
  * @return       ssid string of the specified item on the networks scanned list
  */
 String ESP8266WiFiScanClass::SSID(uint8_t i) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
+    const WiFiScanEntry* it = getNetworkEntry(i);
     if(!it) {
         return "";
     }
 
-    return String(reinterpret_cast<const char*>(it->ssid));
+    return String(it->ssid);
+}
+
+/**
+ * copy the SSID discovered during the network scan
+ * @param i     specify from which network item want to get the information
+ * @param ssid  buffer for the ssid, 33 bytes hold any
+ * @param size  size of the buffer
+ * @return      length of the ssid, 0 if there is no such item
+ */
+size_t ESP8266WiFiScanClass::SSID(uint8_t i, char* ssid, size_t size) {
+    const WiFiScanEntry* it = getNetworkEntry(i);
+    if(!it || !size) {
+        return 0;
+    }
+
+    size_t len = strlen(it->ssid);
+    if(len >= size) {
+        len = size - 1;
+    }
+    memcpy(ssid, it->ssid, len);
+    ssid[len] = 0;
+    return len;
 }
 
 
@@ -193,25 +244,12 @@ String ESP8266WiFiScanClass::SSID(uint8_t i) {
  * @return  encryption type (enum wl_enc_type) of the specified item on the networks scanned list
  */
 uint8_t ESP8266WiFiScanClass::encryptionType(uint8_t i) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
+    const WiFiScanEntry* it = getNetworkEntry(i);
     if(!it) {
         return -1;
     }
 
-    switch(it->authmode) {
-        case AUTH_OPEN:
-            return ENC_TYPE_NONE;
-        case AUTH_WEP:
-            return ENC_TYPE_WEP;
-        case AUTH_WPA_PSK:
-            return ENC_TYPE_TKIP;
-        case AUTH_WPA2_PSK:
-            return ENC_TYPE_CCMP;
-        case AUTH_WPA_WPA2_PSK:
-            return ENC_TYPE_AUTO;
-        default:
-            return -1;
-    }
+    return it->encryptionType;
 }
 
 /**
@@ -220,7 +258,7 @@ uint8_t ESP8266WiFiScanClass::encryptionType(uint8_t i) {
  * @return  signed value of RSSI of the specified item on the networks scanned list
  */
 int32_t ESP8266WiFiScanClass::RSSI(uint8_t i) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
+    const WiFiScanEntry* it = getNetworkEntry(i);
     if(!it) {
         return 0;
     }
@@ -234,11 +272,11 @@ int32_t ESP8266WiFiScanClass::RSSI(uint8_t i) {
  * @return uint8_t * MAC / BSSID of scanned wifi
  */
 uint8_t * ESP8266WiFiScanClass::BSSID(uint8_t i) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
+    const WiFiScanEntry* it = getNetworkEntry(i);
     if(!it) {
         return 0;
     }
-    return it->bssid;
+    return const_cast<uint8_t*>(it->bssid);
 }
 
 /**
@@ -248,16 +286,30 @@ uint8_t * ESP8266WiFiScanClass::BSSID(uint8_t i) {
  */
 String ESP8266WiFiScanClass::BSSIDstr(uint8_t i) {
     char mac[18] = { 0 };
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
-    if(!it) {
+    if(!BSSIDstr(i, mac, sizeof(mac))) {
         return String("");
     }
-    sprintf(mac, "%02X:%02X:%02X:%02X:%02X:%02X", it->bssid[0], it->bssid[1], it->bssid[2], it->bssid[3], it->bssid[4], it->bssid[5]);
     return String(mac);
 }
 
+/**
+ * write MAC / BSSID of scanned wifi
+ * @param i specify from which network item want to get the information
+ * @param bssid buffer for the BSSID, at least 18 bytes
+ * @param size size of the buffer
+ * @return false if there is no such item or the buffer is too small
+ */
+bool ESP8266WiFiScanClass::BSSIDstr(uint8_t i, char* bssid, size_t size) {
+    const WiFiScanEntry* it = getNetworkEntry(i);
+    if(!it || size < 18) {
+        return false;
+    }
+    sprintf(bssid, "%02X:%02X:%02X:%02X:%02X:%02X", it->bssid[0], it->bssid[1], it->bssid[2], it->bssid[3], it->bssid[4], it->bssid[5]);
+    return true;
+}
+
 int32_t ESP8266WiFiScanClass::channel(uint8_t i) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
+    const WiFiScanEntry* it = getNetworkEntry(i);
     if(!it) {
         return 0;
     }
@@ -270,11 +322,11 @@ int32_t ESP8266WiFiScanClass::channel(uint8_t i) {
  * @return bool (true == hidden)
  */
 bool ESP8266WiFiScanClass::isHidden(uint8_t i) {
-    struct bss_info* it = reinterpret_cast<struct bss_info*>(_getScanInfoByIndex(i));
+    const WiFiScanEntry* it = getNetworkEntry(i);
     if(!it) {
         return false;
     }
-    return (it->is_hidden != 0);
+    return it->isHidden;
 }
 
 /**
@@ -284,29 +336,35 @@ bool ESP8266WiFiScanClass::isHidden(uint8_t i) {
  * @param status STATUS
  */
 void ESP8266WiFiScanClass::_scanDone(void* result, int status) {
+    ScanTable& table = ESP8266WiFiScanClass::_scanTable;
     if(status != OK) {
-        ESP8266WiFiScanClass::_scanCount = 0;
-        ESP8266WiFiScanClass::_scanResult = 0;
+        table.begin(0);
     } else {
-
-        int i = 0;
         bss_info* head = reinterpret_cast<bss_info*>(result);
+        char ssid[33];
 
-        for(bss_info* it = head; it; it = STAILQ_NEXT(it, next), ++i)
-            ;
-        ESP8266WiFiScanClass::_scanCount = i;
-        if(i == 0) {
-            ESP8266WiFiScanClass::_scanResult = 0;
-        } else {
-            bss_info* copied_info = new bss_info[i];
-            i = 0;
-            for(bss_info* it = head; it; it = STAILQ_NEXT(it, next), ++i) {
-                memcpy(copied_info + i, it, sizeof(bss_info));
-            }
-
-            ESP8266WiFiScanClass::_scanResult = copied_info;
+        // filter first, so that the table is sized for what is kept
+        size_t count = 0;
+        for(bss_info* it = head; it; it = STAILQ_NEXT(it, next)) {
+            ssidOf(it, ssid);
+            count += table.accepts(ssid, it->rssi);
         }
 
+        if(table.begin(count)) {
+            for(bss_info* it = head; it; it = STAILQ_NEXT(it, next)) {
+                WiFiScanEntry entry;
+                ssidOf(it, entry.ssid);
+                if(!table.accepts(entry.ssid, it->rssi)) {
+                    continue;
+                }
+                memcpy(entry.bssid, it->bssid, sizeof(entry.bssid));
+                entry.rssi = it->rssi;
+                entry.channel = it->channel;
+                entry.encryptionType = encryptionTypeOf(it);
+                entry.isHidden = (it->is_hidden != 0);
+                table.add(entry);
+            }
+        }
     }
 
     ESP8266WiFiScanClass::_scanStarted = false;
@@ -315,19 +373,16 @@ void ESP8266WiFiScanClass::_scanDone(void* result, int status) {
     if(!ESP8266WiFiScanClass::_scanAsync) {
         esp_schedule();
     } else if (ESP8266WiFiScanClass::_onComplete) {
-        ESP8266WiFiScanClass::_onComplete(ESP8266WiFiScanClass::_scanCount);
+        ESP8266WiFiScanClass::_onComplete(ESP8266WiFiScanClass::_scanTable.size());
         ESP8266WiFiScanClass::_onComplete = nullptr;
     }
 }
 
 /**
- *
+ * scan result as kept, nothing copied
  * @param i specify from which network item want to get the information
- * @return bss_info *
+ * @return WiFiScanEntry *, NULL if there is no such item
  */
-void * ESP8266WiFiScanClass::_getScanInfoByIndex(int i) {
-    if(!ESP8266WiFiScanClass::_scanResult || (size_t) i > ESP8266WiFiScanClass::_scanCount) {
-        return 0;
-    }
-    return reinterpret_cast<bss_info*>(ESP8266WiFiScanClass::_scanResult) + i;
+const WiFiScanEntry* ESP8266WiFiScanClass::getNetworkEntry(uint8_t i) {
+    return ESP8266WiFiScanClass::_scanTable.get(i);
 }
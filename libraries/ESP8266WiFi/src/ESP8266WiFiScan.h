@@ -25,6 +25,7 @@
 
 #include "ESP8266WiFiType.h"
 #include "ESP8266WiFiGeneric.h"
+#include "include/ScanTable.h"
 
 class ESP8266WiFiScanClass {
 
@@ -40,6 +41,12 @@ class ESP8266WiFiScanClass {
         int8_t scanComplete();
         void scanDelete();
 
+        // applied to each scan as it completes: keep only networks at least
+        // minRSSI strong, named in ssids (kept by pointer, NULL for any), and
+        // at most the maxResults strongest (0 for all), in a table kept
+        // between scans
+        void setScanFilter(int8_t minRSSI = -128, const char* const* ssids = NULL, size_t ssidCount = 0, uint8_t maxResults = 0);
+
         // scan result
         bool getNetworkInfo(uint8_t networkItem, String &ssid, uint8_t &encryptionType, int32_t &RSSI, uint8_t* &BSSID, int32_t &channel, bool &isHidden);
 
@@ -51,19 +58,22 @@ class ESP8266WiFiScanClass {
         int32_t channel(uint8_t networkItem);
         bool isHidden(uint8_t networkItem);
 
+        // scan result, without allocating
+        const WiFiScanEntry* getNetworkEntry(uint8_t networkItem);
+        size_t SSID(uint8_t networkItem, char* ssid, size_t size);
+        bool BSSIDstr(uint8_t networkItem, char* bssid, size_t size);
+
     protected:
 
         static bool _scanAsync;
         static bool _scanStarted;
         static bool _scanComplete;
 
-        static size_t _scanCount;
-        static void* _scanResult;
+        static ScanTable _scanTable;
 
         static std::function<void(int)> _onComplete;
 
         static void _scanDone(void* result, int status);
-        static void * _getScanInfoByIndex(int i);
 
 };
 
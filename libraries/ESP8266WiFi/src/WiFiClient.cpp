@@ -159,11 +159,28 @@ bool WiFiClient::getNoDelay() {
     return _client->getNoDelay();
 }
 
+void WiFiClient::setReceiveLimit(size_t limit) {
+    if (!_client)
+        return;
+    _client->set_rx_limit(limit);
+}
+
+size_t WiFiClient::getReceiveLimit() {
+    if (!_client)
+        return 0;
+    return _client->get_rx_limit();
+}
+
 size_t WiFiClient::availableForWrite ()
 {
     return _client? _client->availableForWrite(): 0;
 }
 
+size_t WiFiClient::availableForWriteAsync ()
+{
+    return _client? _client->availableForWriteAsync(): 0;
+}
+
 size_t WiFiClient::write(uint8_t b)
 {
     return write(&b, 1);
@@ -179,6 +196,16 @@ size_t WiFiClient::write(const uint8_t *buf, size_t size)
     return _client->write(buf, size);
 }
 
+size_t WiFiClient::write(const IOVec* iov, size_t count)
+{
+    if (!_client || !count)
+    {
+        return 0;
+    }
+    _client->setTimeout(_timeout);
+    return _client->write(iov, count);
+}
+
 size_t WiFiClient::write(Stream& stream, size_t unused)
 {
     (void) unused;
@@ -205,6 +232,45 @@ size_t WiFiClient::write_P(PGM_P buf, size_t size)
     return _client->write_P(buf, size);
 }
 
+size_t WiFiClient::writeNoCopy(const uint8_t *buf, size_t size, std::function<void()> onReleased)
+{
+    if (!_client || !size)
+    {
+        if (onReleased)
+            onReleased();
+        return 0;
+    }
+    _client->setTimeout(_timeout);
+    return _client->write_nocopy(buf, size, onReleased);
+}
+
+size_t WiFiClient::writeAsync(const uint8_t *buf, size_t size, std::function<void(bool)> onDone)
+{
+    if (!_client || !size)
+    {
+        return 0;
+    }
+    return _client->write_async(buf, size, onDone);
+}
+
+void WiFiClient::onData(std::function<size_t(const uint8_t* data, size_t len)> handler)
+{
+    if (_client)
+        _client->on_data(handler);
+}
+
+void WiFiClient::onDisconnect(std::function<void()> handler)
+{
+    if (_client)
+        _client->on_disconnect(handler);
+}
+
+void WiFiClient::onAck(std::function<void(size_t len)> handler)
+{
+    if (_client)
+        _client->on_ack(handler);
+}
+
 int WiFiClient::available()
 {
     if (!_client)
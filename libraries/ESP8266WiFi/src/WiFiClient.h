@@ -22,11 +22,13 @@
 #ifndef wificlient_h
 #define wificlient_h
 #include <memory>
+#include <functional>
 #include "Arduino.h"
 #include "Print.h"
 #include "Client.h"
 #include "IPAddress.h"
 #include "include/slist.h"
+#include "include/IOVec.h"
 
 #define WIFICLIENT_MAX_PACKET_SIZE 1460
 
@@ -55,6 +57,20 @@ public:
   virtual size_t write(const uint8_t *buf, size_t size);
   virtual size_t write_P(PGM_P buf, size_t size);
   size_t write(Stream& stream);
+  // Send count pieces as one write, so they share TCP segments
+  virtual size_t write(const IOVec* iov, size_t count);
+  // Send a RAM buffer that stays valid and unchanged until the peer has
+  // acknowledged it, without copying it into the TCP stack. onReleased is
+  // called (from the scheduler, see Schedule.h) once the buffer may be
+  // reused.
+  virtual size_t writeNoCopy(const uint8_t *buf, size_t size, std::function<void()> onReleased = nullptr);
+  // Queue data for sending and return at once, even if the peer is slow.
+  // Returns the number of bytes accepted, limited by
+  // availableForWriteAsync(). If any were, onDone is called (from the
+  // scheduler) with true once the peer has acknowledged them, or with false
+  // if the connection is lost.
+  // stop() sends what is still queued and waits for it, up to the timeout.
+  virtual size_t writeAsync(const uint8_t *buf, size_t size, std::function<void(bool)> onDone = nullptr);
 
   // This one is deprecated, use write(Stream& instead)
   size_t write(Stream& stream, size_t unitSize) __attribute__ ((deprecated));
@@ -78,9 +94,28 @@ public:
   uint16_t  localPort();
   bool getNoDelay();
   void setNoDelay(bool nodelay);
+  // Most received bytes the peer may send ahead of what is read. The TCP
+  // window is kept that small by not reopening it for the first
+  // TCP_WND - limit bytes read; until then up to TCP_WND may arrive, as
+  // without a limit. 0 (the default) means no limit.
+  size_t getReceiveLimit();
+  void setReceiveLimit(size_t limit);
   static void setLocalPortStart(uint16_t port) { _localPort = port; }
 
+  // Opt-in events instead of polling available(). The handlers run from
+  // the scheduler (see Schedule.h), belong to the connection and are
+  // shared by all copies of this client; stop() removes them. Set them
+  // after connecting. onData is given received data in place, one
+  // contiguous piece at a time, and returns how many bytes it consumed;
+  // the rest remains for the next event or for read(). onAck reports how
+  // many sent bytes the peer has acknowledged.
+  void onData(std::function<size_t(const uint8_t* data, size_t len)> handler);
+  void onDisconnect(std::function<void()> handler);
+  void onAck(std::function<void(size_t len)> handler);
+
   size_t availableForWrite();
+  // Room left in the send queue used by writeAsync()
+  size_t availableForWriteAsync();
 
   friend class WiFiServer;
 
@@ -40,6 +40,7 @@ extern "C"
 #include "lwip/netif.h"
 #include "include/ClientContext.h"
 #include "c_types.h"
+#include <Schedule.h>
 
 #ifdef DEBUG_ESP_SSL
 #define DEBUG_SSL
@@ -71,22 +72,126 @@ typedef struct BufferItem
 
 typedef std::list<BufferItem> BufferList;
 
-class SSLContext
+// A TLS session a client may resume, kept by host and port. A resumed
+// handshake does not carry the server certificate, so the entry also
+// records how the application checked the server when the session was new.
+struct SSLSession
+{
+    String host;
+    uint16_t port = 0;
+    uint8_t id[SSL_SESSION_ID_SIZE];
+    uint8_t idSize = 0;
+    uint32_t lastUsed = 0;
+    String verifiedName;
+    bool fingerprintChecked = false;
+    uint8_t fingerprint[20];
+    bool chainChecked = false;
+};
+
+// axTLS copies what it needs out of the data while parsing it, so none of
+// these have to outlive the call
+static bool loadSSLObject(SSL_CTX* ctx, int type, const uint8_t* data, size_t size)
+{
+    int rc = ssl_obj_memory_load(ctx, type, data, static_cast<int>(size), nullptr);
+    if (rc != SSL_OK) {
+        DEBUGV("loadObject: ssl_obj_memory_load returned %d\n", rc);
+        return false;
+    }
+    return true;
+}
+
+static bool loadSSLObject_P(SSL_CTX* ctx, int type, PGM_VOID_P data, size_t size)
+{
+    // the parser reads bytes, which flash only serves as aligned words
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[size]);
+    if (!buf.get()) {
+        DEBUGV("loadObject: failed to allocate memory\n");
+        return false;
+    }
+    memcpy_P(buf.get(), data, size);
+    return loadSSLObject(ctx, type, buf.get(), size);
+}
+
+static bool loadSSLObject(SSL_CTX* ctx, int type, Stream& stream, size_t size)
+{
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[size]);
+    if (!buf.get()) {
+        DEBUGV("loadObject: failed to allocate memory\n");
+        return false;
+    }
+
+    size_t cb = stream.readBytes(buf.get(), size);
+    if (cb != size) {
+        DEBUGV("loadObject: reading %u bytes, got %u\n", size, cb);
+        return false;
+    }
+
+    return loadSSLObject(ctx, type, buf.get(), size);
+}
+
+// The key and certificate of a WiFiServerSecure, parsed once into an axTLS
+// context all of its connections share. Nothing is loaded into it after
+// construction, and each connection keeps it alive for as long as its SSL.
+class SSLServerContext
+{
+public:
+    SSLServerContext(bool usePMEM, const uint8_t* key, int keyLen, const uint8_t* cert, int certLen)
+    {
+        _ctx = ssl_ctx_new(SSL_SERVER_VERIFY_LATER | SSL_DEBUG_OPTS | SSL_CONNECT_IN_PARTS | SSL_READ_BLOCKING | SSL_NO_DEFAULT_KEY, 0);
+        if (!_ctx) {
+            return;
+        }
+        if (key && keyLen) {
+            _load(usePMEM, SSL_OBJ_RSA_KEY, key, keyLen);
+        }
+        if (cert && certLen) {
+            _load(usePMEM, SSL_OBJ_X509_CERT, cert, certLen);
+        }
+    }
+
+    ~SSLServerContext()
+    {
+        if (_ctx) {
+            ssl_ctx_free(_ctx);
+        }
+    }
+
+    SSLServerContext(const SSLServerContext&) = delete;
+    SSLServerContext& operator=(const SSLServerContext&) = delete;
+
+    SSL_CTX* get() const
+    {
+        return _ctx;
+    }
+
+protected:
+    bool _load(bool usePMEM, int type, const uint8_t* data, int len)
+    {
+        if (usePMEM) {
+            return loadSSLObject_P(_ctx, type, data, len);
+        }
+        return loadSSLObject(_ctx, type, data, len);
+    }
+
+    SSL_CTX* _ctx = nullptr;
+};
+
+class SSLContext : public std::enable_shared_from_this<SSLContext>
 {
 public:
-    SSLContext(bool isServer = false)
+    typedef std::function<void(WiFiClientSecure::HandshakeEvent event)> HandshakeHandler;
+
+    // A client context, or one for a connection accepted by a server
+    explicit SSLContext(const std::shared_ptr<SSLServerContext>& serverCtx = nullptr)
+    : _serverCtx(serverCtx)
     {
-        _isServer = isServer;
+        _isServer = serverCtx != nullptr;
         if (!_isServer) {
             if (_ssl_client_ctx_refcnt == 0) {
-                _ssl_client_ctx = ssl_ctx_new(SSL_SERVER_VERIFY_LATER | SSL_DEBUG_OPTS | SSL_CONNECT_IN_PARTS | SSL_READ_BLOCKING | SSL_NO_DEFAULT_KEY, 0);
+                // axTLS keeps the secrets of resumable sessions in the context
+                _ssl_client_ctx = ssl_ctx_new(SSL_SERVER_VERIFY_LATER | SSL_DEBUG_OPTS | SSL_CONNECT_IN_PARTS | SSL_READ_BLOCKING | SSL_NO_DEFAULT_KEY, SSL_SESSION_CACHE_SIZE);
             }
             ++_ssl_client_ctx_refcnt;
-        } else {
-            if (_ssl_svr_ctx_refcnt == 0) {
-                _ssl_svr_ctx = ssl_ctx_new(SSL_SERVER_VERIFY_LATER | SSL_DEBUG_OPTS | SSL_CONNECT_IN_PARTS | SSL_READ_BLOCKING | SSL_NO_DEFAULT_KEY, 0);
-            }
-            ++_ssl_svr_ctx_refcnt;
         }
     }
 
@@ -96,20 +201,12 @@ public:
             io_ctx->unref();
             io_ctx = nullptr;
         }
+        // freeing the context would free the SSL, so it goes first
         _ssl = nullptr;
         if (!_isServer) {
-            --_ssl_client_ctx_refcnt;
-            if (_ssl_client_ctx_refcnt == 0) {
-                ssl_ctx_free(_ssl_client_ctx);
-                _ssl_client_ctx = nullptr;
-            }
-        } else {
-            --_ssl_svr_ctx_refcnt;
-            if (_ssl_svr_ctx_refcnt == 0) {
-                ssl_ctx_free(_ssl_svr_ctx);
-                _ssl_svr_ctx = nullptr;
-            }
+            _unrefClientCtx();
         }
+        _serverCtx = nullptr;
     }
 
     static void _delete_shared_SSL(SSL *_to_del)
@@ -117,10 +214,42 @@ public:
         ssl_free(_to_del);
     }
 
-    void connect(ClientContext* ctx, const char* hostName, uint32_t timeout_ms)
+    void connect(ClientContext* ctx, const char* hostName, bool reuse, uint16_t maxFragment, uint32_t timeout_ms)
     {
+        startConnect(ctx, hostName, reuse, maxFragment);
+
+        while (millis() - _handshakeStart < timeout_ms && ssl_handshake_status(_ssl.get()) != SSL_OK) {
+            uint8_t* data;
+            int rc = ssl_read(_ssl.get(), &data);
+            if (rc < SSL_OK) {
+                ssl_display_error(rc);
+                _handshakeError = rc;
+                break;
+            }
+        }
+        _finishConnect();
+    }
+
+    // Send the client hello; the rest of the handshake is up to connect()
+    // or handshakeAsync()
+    void startConnect(ClientContext* ctx, const char* hostName, bool reuse, uint16_t maxFragment)
+    {
+        _resumed = false;
+        _handshakeError = SSL_OK;
+        _reuse = reuse;
+        _sessionHost = hostName ? String(hostName) : IPAddress(ctx->getRemoteAddress()).toString();
+        _sessionPort = ctx->getRemotePort();
+        SSLSession* session = reuse ? _findSession() : nullptr;
+        _offeredIdSize = session ? session->idSize : 0;
+        if (session) {
+            memcpy(_offeredId, session->id, _offeredIdSize);
+        }
+
         SSL_EXTENSIONS* ext = ssl_ext_new();
         ssl_ext_set_host_name(ext, hostName);
+        if (maxFragment) {
+            ssl_ext_set_max_fragment_size(ext, maxFragment);
+        }
         if (_ssl) {
             /* Creating a new TLS session on top of a new TCP connection.
                ssl_free will want to send a close notify alert, but the old TCP connection
@@ -133,20 +262,106 @@ public:
         io_ctx = ctx;
         ctx->ref();
 
+        _freeHeap = ESP.getFreeHeap();
+        _handshakeStart = millis();
+
         // Wrap the new SSL with a smart pointer, custom deleter to call ssl_free
-        SSL *_new_ssl = ssl_client_new(_ssl_client_ctx, reinterpret_cast<int>(this), nullptr, 0, ext);
+        SSL *_new_ssl = ssl_client_new(_ssl_client_ctx, reinterpret_cast<int>(this),
+                                       session ? session->id : nullptr, _offeredIdSize, ext);
         std::shared_ptr<SSL> _new_ssl_shared(_new_ssl, _delete_shared_SSL);
         _ssl = _new_ssl_shared;
+    }
 
-        uint32_t t = millis();
+    // Continue the handshake from the scheduler (see Schedule.h), once per
+    // loop iteration, reading only what has arrived instead of waiting for
+    // it. handler hears of each processed handshake message and of the end.
+    bool handshakeAsync(HandshakeHandler handler, uint32_t timeout_ms)
+    {
+        _onHandshake = handler;
+        _handshakeTimeout = timeout_ms;
+        if (!_scheduleHandshake()) {
+            _onHandshake = nullptr;
+            return false;
+        }
+        return true;
+    }
 
-        while (millis() - t < timeout_ms && ssl_handshake_status(_ssl.get()) != SSL_OK) {
-            uint8_t* data;
-            int rc = ssl_read(_ssl.get(), &data);
-            if (rc < SSL_OK) {
-                ssl_display_error(rc);
-                break;
-            }
+    bool handshaking() const
+    {
+        return _onHandshake != nullptr;
+    }
+
+    bool resumed() const
+    {
+        return _resumed;
+    }
+
+    // The server ended the handshake with an alert, as some do when they
+    // do not support an extension. axTLS returns a received alert as its
+    // negated description, above its own error codes.
+    bool alertReceived() const
+    {
+        return _handshakeError < SSL_CLOSE_NOTIFY && _handshakeError > SSL_ERROR_CONN_LOST;
+    }
+
+    uint32_t handshakeMillis() const
+    {
+        return _handshakeMillis;
+    }
+
+    uint32_t memoryUsed() const
+    {
+        return _memoryUsed;
+    }
+
+    // Called once the application accepted the server of a new session,
+    // so a later resumption of it can be accepted the same way
+    void sessionVerified(const char* name, const uint8_t* fingerprint)
+    {
+        SSLSession* session = _findSession();
+        if (!session || !_ssl || session->idSize != ssl_get_session_id_size(_ssl.get()) ||
+            memcmp(session->id, ssl_get_session_id(_ssl.get()), session->idSize) != 0) {
+            return;
+        }
+        session->verifiedName = name;
+        if (fingerprint) {
+            session->fingerprintChecked = true;
+            memcpy(session->fingerprint, fingerprint, sizeof(session->fingerprint));
+        } else {
+            session->chainChecked = true;
+        }
+    }
+
+    // Check a resumed session the way it was checked when it was new.
+    // A session which fails is forgotten, so the next connection does a
+    // full handshake.
+    bool verifyResumed(const char* name, const uint8_t* fingerprint)
+    {
+        SSLSession* session = _findSession();
+        if (!session) {
+            return false;
+        }
+        bool ok = name && session->verifiedName == name;
+        if (fingerprint) {
+            ok = ok && session->fingerprintChecked &&
+                 memcmp(session->fingerprint, fingerprint, sizeof(session->fingerprint)) == 0;
+        } else {
+            ok = ok && session->chainChecked;
+        }
+        if (!ok) {
+            _dropSession(session);
+        }
+        return ok;
+    }
+
+    static void clearSessions()
+    {
+        for (auto& session : _sessions) {
+            session = SSLSession();
+        }
+        if (_sessionsHoldCtx) {
+            _sessionsHoldCtx = false;
+            _unrefClientCtx();
         }
     }
 
@@ -155,8 +370,11 @@ public:
         io_ctx = ctx;
         ctx->ref();
 
+        if (!_serverCtx->get()) {
+            return;
+        }
         // Wrap the new SSL with a smart pointer, custom deleter to call ssl_free
-	SSL *_new_ssl = ssl_server_new(_ssl_svr_ctx, reinterpret_cast<int>(this));
+        SSL *_new_ssl = ssl_server_new(_serverCtx->get(), reinterpret_cast<int>(this));
         std::shared_ptr<SSL> _new_ssl_shared(_new_ssl, _delete_shared_SSL);
         _ssl = _new_ssl_shared;
 
@@ -289,41 +507,36 @@ public:
     // similar to available, but doesn't return exact size
     bool hasData()
     {
+        if (handshaking()) {
+            return false;
+        }
         return _available > 0 || (io_ctx && io_ctx->getSize() > 0);
     }
 
+    // Objects go into the client context. The one of a server connection
+    // is shared with the other connections and stays as the server set it.
     bool loadObject(int type, Stream& stream, size_t size)
     {
-        std::unique_ptr<uint8_t[]> buf(new uint8_t[size]);
-        if (!buf.get()) {
-            DEBUGV("loadObject: failed to allocate memory\n");
-            return false;
-        }
-
-        size_t cb = stream.readBytes(buf.get(), size);
-        if (cb != size) {
-            DEBUGV("loadObject: reading %u bytes, got %u\n", size, cb);
+        if (_isServer) {
             return false;
         }
-
-        return loadObject(type, buf.get(), size);
+        return loadSSLObject(_ssl_client_ctx, type, stream, size);
     }
 
     bool loadObject_P(int type, PGM_VOID_P data, size_t size)
     {
-        std::unique_ptr<uint8_t[]> buf(new uint8_t[size]);
-        memcpy_P(buf.get(),data, size);
-        return loadObject(type, buf.get(), size);
+        if (_isServer) {
+            return false;
+        }
+        return loadSSLObject_P(_ssl_client_ctx, type, data, size);
     }
 
     bool loadObject(int type, const uint8_t* data, size_t size)
     {
-        int rc = ssl_obj_memory_load(_isServer?_ssl_svr_ctx:_ssl_client_ctx, type, data, static_cast<int>(size), nullptr);
-        if (rc != SSL_OK) {
-            DEBUGV("loadObject: ssl_obj_memory_load returned %d\n", rc);
+        if (_isServer) {
             return false;
         }
-        return true;
+        return loadSSLObject(_ssl_client_ctx, type, data, size);
     }
 
     bool verifyCert()
@@ -360,9 +573,142 @@ public:
     }
 
 protected:
+    SSLSession* _findSession()
+    {
+        for (auto& session : _sessions) {
+            if (session.idSize && session.port == _sessionPort && session.host == _sessionHost) {
+                return &session;
+            }
+        }
+        return nullptr;
+    }
+
+    void _finishConnect()
+    {
+        _handshakeMillis = millis() - _handshakeStart;
+        // what the session and its record buffers kept after the handshake
+        uint32_t heapLeft = ESP.getFreeHeap();
+        _memoryUsed = (_freeHeap > heapLeft) ? _freeHeap - heapLeft : 0;
+
+        SSLSession* session = _offeredIdSize ? _findSession() : nullptr;
+        if (session && (session->idSize != _offeredIdSize || memcmp(session->id, _offeredId, _offeredIdSize) != 0)) {
+            // replaced while the handshake went on
+            session = nullptr;
+        }
+        if (ssl_handshake_status(_ssl.get()) != SSL_OK) {
+            if (session) {
+                _dropSession(session);
+            }
+            return;
+        }
+        const uint8_t* id = ssl_get_session_id(_ssl.get());
+        uint8_t idSize = ssl_get_session_id_size(_ssl.get());
+        // the server echoes the session id if it resumes the session
+        _resumed = _offeredIdSize && idSize == _offeredIdSize && memcmp(id, _offeredId, idSize) == 0;
+        DEBUGV(":wcs hs %u ms, resumed %d\r\n", _handshakeMillis, (int) _resumed);
+        if (_resumed && session) {
+            session->lastUsed = millis();
+        } else if (_reuse && idSize && !_resumed) {
+            _storeSession(id, idSize);
+        }
+    }
+
+    bool _scheduleHandshake()
+    {
+        // the client may go away meanwhile; it takes the handshake along
+        std::weak_ptr<SSLContext> weak = shared_from_this();
+        return schedule_function([weak]() {
+            if (auto ssl = weak.lock()) {
+                ssl->_handshakeStep();
+            }
+        });
+    }
+
+    void _handshakeStep()
+    {
+        bool progress = false;
+        int status = ssl_handshake_status(_ssl.get());
+        // a whole record arrives in a few segments, so ssl_read() does not
+        // wait long once some of it is there
+        while (status == SSL_NOT_OK && io_ctx && io_ctx->getSize()) {
+            uint8_t* data;
+            int rc = ssl_read(_ssl.get(), &data);
+            if (rc < SSL_OK) {
+                ssl_display_error(rc);
+                _handshakeError = rc;
+                status = rc;
+                break;
+            }
+            progress = true;
+            status = ssl_handshake_status(_ssl.get());
+        }
+        if (status == SSL_NOT_OK) {
+            bool lost = !io_ctx || io_ctx->state() != ESTABLISHED;
+            if (!lost && millis() - _handshakeStart < _handshakeTimeout) {
+                if (progress) {
+                    _onHandshake(WiFiClientSecure::HANDSHAKE_PROGRESS);
+                }
+                if (_scheduleHandshake()) {
+                    return;
+                }
+            }
+        }
+        _finishConnect();
+        HandshakeHandler handler = _onHandshake;
+        _onHandshake = nullptr;
+        if (status != SSL_OK) {
+            _ssl = nullptr;
+        }
+        handler(status == SSL_OK ? WiFiClientSecure::HANDSHAKE_DONE : WiFiClientSecure::HANDSHAKE_FAILED);
+    }
+
+    void _storeSession(const uint8_t* id, uint8_t idSize)
+    {
+        SSLSession* slot = _findSession();
+        if (!slot) {
+            // a free entry, or else the one used longest ago
+            slot = &_sessions[0];
+            for (auto& session : _sessions) {
+                if (!session.idSize) {
+                    slot = &session;
+                    break;
+                }
+                if ((int32_t) (session.lastUsed - slot->lastUsed) < 0) {
+                    slot = &session;
+                }
+            }
+        }
+        *slot = SSLSession();
+        slot->host = _sessionHost;
+        slot->port = _sessionPort;
+        memcpy(slot->id, id, idSize);
+        slot->idSize = idSize;
+        slot->lastUsed = millis();
+        if (!_sessionsHoldCtx) {
+            // the session secrets live as long as the context
+            _sessionsHoldCtx = true;
+            ++_ssl_client_ctx_refcnt;
+        }
+    }
+
+    static void _dropSession(SSLSession* session)
+    {
+        *session = SSLSession();
+    }
+
+    static void _unrefClientCtx()
+    {
+        --_ssl_client_ctx_refcnt;
+        if (_ssl_client_ctx_refcnt == 0) {
+            ssl_ctx_free(_ssl_client_ctx);
+            _ssl_client_ctx = nullptr;
+        }
+    }
+
     int _readAll()
     {
-        if (!_ssl) {
+        // the handshake reads for itself until it is done
+        if (!_ssl || handshaking()) {
             return 0;
         }
 
@@ -384,7 +730,7 @@ protected:
 
     int _write(const uint8_t* src, size_t size)
     {
-        if (!_ssl) {
+        if (!_ssl || handshaking()) {
             return 0;
         }
 
@@ -433,10 +779,24 @@ protected:
     }
 
     bool _isServer = false;
+    std::shared_ptr<SSLServerContext> _serverCtx;
     static SSL_CTX* _ssl_client_ctx;
     static int _ssl_client_ctx_refcnt;
-    static SSL_CTX* _ssl_svr_ctx;
-    static int _ssl_svr_ctx_refcnt;
+    static SSLSession _sessions[SSL_SESSION_CACHE_SIZE];
+    static bool _sessionsHoldCtx;
+    String _sessionHost;
+    uint16_t _sessionPort = 0;
+    bool _resumed = false;
+    int _handshakeError = SSL_OK;
+    uint32_t _handshakeMillis = 0;
+    uint32_t _memoryUsed = 0;
+    uint32_t _freeHeap = 0;
+    uint32_t _handshakeStart = 0;
+    uint32_t _handshakeTimeout = 0;
+    bool _reuse = false;
+    uint8_t _offeredId[SSL_SESSION_ID_SIZE];
+    uint8_t _offeredIdSize = 0;
+    HandshakeHandler _onHandshake;
     std::shared_ptr<SSL> _ssl = nullptr;
     const uint8_t* _read_ptr = nullptr;
     size_t _available = 0;
@@ -447,8 +807,8 @@ protected:
 
 SSL_CTX* SSLContext::_ssl_client_ctx = nullptr;
 int SSLContext::_ssl_client_ctx_refcnt = 0;
-SSL_CTX* SSLContext::_ssl_svr_ctx = nullptr;
-int SSLContext::_ssl_svr_ctx_refcnt = 0;
+SSLSession SSLContext::_sessions[SSL_SESSION_CACHE_SIZE];
+bool SSLContext::_sessionsHoldCtx = false;
 
 WiFiClientSecure::WiFiClientSecure()
 {
@@ -461,10 +821,8 @@ WiFiClientSecure::~WiFiClientSecure()
    _ssl = nullptr;
 }
 
-// Only called by the WifiServerSecure, need to get the keys/certs loaded before beginning
-WiFiClientSecure::WiFiClientSecure(ClientContext* client, bool usePMEM,
-                                   const uint8_t *rsakey, int rsakeyLen,
-                                   const uint8_t *cert, int certLen)
+// Only called by the WifiServerSecure, with the keys/certs it has loaded
+WiFiClientSecure::WiFiClientSecure(ClientContext* client, const std::shared_ptr<SSLServerContext>& serverCtx)
 {
     // TLS handshake may take more than the 5 second default timeout
     _timeout = 15000;
@@ -474,35 +832,20 @@ WiFiClientSecure::WiFiClientSecure(ClientContext* client, bool usePMEM,
     _client->ref();
 
     // Make the "_ssl" SSLContext, in the constructor there should be none yet
-    SSLContext *_new_ssl = new SSLContext(true);
-    std::shared_ptr<SSLContext> _new_ssl_shared(_new_ssl);
-    _ssl = _new_ssl_shared;
-
-    if (usePMEM) {
-        if (rsakey && rsakeyLen) {
-            _ssl->loadObject_P(SSL_OBJ_RSA_KEY, rsakey, rsakeyLen);
-        }
-        if (cert && certLen) {
-            _ssl->loadObject_P(SSL_OBJ_X509_CERT, cert, certLen);
-        }
-    } else {
-        if (rsakey && rsakeyLen) {
-            _ssl->loadObject(SSL_OBJ_RSA_KEY, rsakey, rsakeyLen);
-        }
-        if (cert && certLen) {
-            _ssl->loadObject(SSL_OBJ_X509_CERT, cert, certLen);
-        }
-    }
+    _ssl = std::make_shared<SSLContext>(serverCtx);
     _ssl->connectServer(client, _timeout);
 }
 
-int WiFiClientSecure::connect(IPAddress ip, uint16_t port)
+std::shared_ptr<SSLServerContext> WiFiClientSecure::_createServerContext(bool usePMEM,
+                                                                          const uint8_t *rsakey, int rsakeyLen,
+                                                                          const uint8_t *cert, int certLen)
 {
-    if (!WiFiClient::connect(ip, port)) {
-        return 0;
-    }
+    return std::make_shared<SSLServerContext>(usePMEM, rsakey, rsakeyLen, cert, certLen);
+}
 
-    return _connectSSL(nullptr);
+int WiFiClientSecure::connect(IPAddress ip, uint16_t port)
+{
+    return _connect(ip, port, nullptr);
 }
 
 int WiFiClientSecure::connect(const char* name, uint16_t port)
@@ -511,10 +854,29 @@ int WiFiClientSecure::connect(const char* name, uint16_t port)
     if (!WiFi.hostByName(name, remote_addr)) {
         return 0;
     }
-    if (!WiFiClient::connect(remote_addr, port)) {
+    return _connect(remote_addr, port, name);
+}
+
+int WiFiClientSecure::_connect(IPAddress ip, uint16_t port, const char* hostName)
+{
+    if (!WiFiClient::connect(ip, port)) {
+        return 0;
+    }
+    bool alerted = false;
+    if (_connectSSL(hostName, _maxFragmentLength, &alerted)) {
+        return 1;
+    }
+    if (!_maxFragmentLength || !alerted) {
         return 0;
     }
-    return _connectSSL(name);
+    // Some servers reject a max fragment length they do not support with
+    // an alert instead of ignoring it; try once more without asking.
+    // Timeouts, lost connections and certificate errors are not retried.
+    DEBUGV(":wcs retry without max fragment length\r\n");
+    if (!WiFiClient::connect(ip, port)) {
+        return 0;
+    }
+    return _connectSSL(hostName, 0);
 }
 
 int WiFiClientSecure::connect(const String host, uint16_t port)
@@ -522,15 +884,18 @@ int WiFiClientSecure::connect(const String host, uint16_t port)
     return connect(host.c_str(), port);
 }
 
-int WiFiClientSecure::_connectSSL(const char* hostName)
+int WiFiClientSecure::_connectSSL(const char* hostName, uint16_t maxFragment, bool* alerted)
 {
     if (!_ssl) {
         _ssl = std::make_shared<SSLContext>();
     }
-    _ssl->connect(_client, hostName, _timeout);
+    _ssl->connect(_client, hostName, _sessionReuse, maxFragment, _timeout);
 
     auto status = ssl_handshake_status(*_ssl);
     if (status != SSL_OK) {
+        if (alerted) {
+            *alerted = _ssl->alertReceived();
+        }
         _ssl = nullptr;
         return 0;
     }
@@ -538,6 +903,41 @@ int WiFiClientSecure::_connectSSL(const char* hostName)
     return 1;
 }
 
+int WiFiClientSecure::connectAsync(IPAddress ip, uint16_t port, HandshakeHandler handler)
+{
+    return _connectAsync(ip, port, nullptr, handler);
+}
+
+int WiFiClientSecure::connectAsync(const char* name, uint16_t port, HandshakeHandler handler)
+{
+    IPAddress remote_addr;
+    if (!WiFi.hostByName(name, remote_addr)) {
+        return 0;
+    }
+    return _connectAsync(remote_addr, port, name, handler);
+}
+
+int WiFiClientSecure::_connectAsync(IPAddress ip, uint16_t port, const char* hostName, HandshakeHandler handler)
+{
+    if (!WiFiClient::connect(ip, port)) {
+        return 0;
+    }
+    if (!_ssl) {
+        _ssl = std::make_shared<SSLContext>();
+    }
+    _ssl->startConnect(_client, hostName, _sessionReuse, _maxFragmentLength);
+    if (!_ssl->handshakeAsync(handler, _timeout)) {
+        _ssl = nullptr;
+        return 0;
+    }
+    return 1;
+}
+
+bool WiFiClientSecure::handshaking()
+{
+    return _ssl && _ssl->handshaking();
+}
+
 size_t WiFiClientSecure::write(const uint8_t *buf, size_t size)
 {
     if (!_ssl) {
@@ -564,6 +964,41 @@ size_t WiFiClientSecure::write_P(PGM_P buf, size_t size)
     return write(copy, size);
 }
 
+size_t WiFiClientSecure::write(const IOVec* iov, size_t count)
+{
+    size_t written = 0;
+    for (size_t i = 0; i < count; ++i) {
+        size_t rc = write(reinterpret_cast<const uint8_t*>(iov[i].base), iov[i].len);
+        written += rc;
+        if (rc != iov[i].len) {
+            break;
+        }
+    }
+    return written;
+}
+
+size_t WiFiClientSecure::writeNoCopy(const uint8_t *buf, size_t size, std::function<void()> onReleased)
+{
+    size_t written = write(buf, size);
+    if (onReleased) {
+        onReleased();
+    }
+    return written;
+}
+
+size_t WiFiClientSecure::writeAsync(const uint8_t *buf, size_t size, std::function<void(bool)> onDone)
+{
+    size_t written = write(buf, size);
+    if (written && onDone) {
+        if (_client) {
+            _client->notify_acked(onDone);
+        } else {
+            onDone(false);
+        }
+    }
+    return written;
+}
+
 int WiFiClientSecure::read(uint8_t *buf, size_t size)
 {
     if (!_ssl) {
@@ -719,12 +1154,19 @@ bool WiFiClientSecure::verify(const char* fp, const char* domain_name)
         pos += 2;
         sha1[i] = low | (high << 4);
     }
+    if (_ssl->resumed()) {
+        return _ssl->verifyResumed(domain_name, sha1);
+    }
     if (ssl_match_fingerprint(*_ssl, sha1) != 0) {
         DEBUGV("fingerprint doesn't match\r\n");
         return false;
     }
 
-    return _verifyDN(domain_name);
+    if (!_verifyDN(domain_name)) {
+        return false;
+    }
+    _ssl->sessionVerified(domain_name, sha1);
+    return true;
 }
 
 bool WiFiClientSecure::_verifyDN(const char* domain_name)
@@ -760,10 +1202,51 @@ bool WiFiClientSecure::verifyCertChain(const char* domain_name)
     if (!_ssl) {
         return false;
     }
+    if (_ssl->resumed()) {
+        return _ssl->verifyResumed(domain_name, nullptr);
+    }
     if (!_ssl->verifyCert()) {
         return false;
     }
-    return _verifyDN(domain_name);
+    if (!_verifyDN(domain_name)) {
+        return false;
+    }
+    _ssl->sessionVerified(domain_name, nullptr);
+    return true;
+}
+
+void WiFiClientSecure::setSessionReuse(bool reuse)
+{
+    _sessionReuse = reuse;
+}
+
+void WiFiClientSecure::clearSessionCache()
+{
+    SSLContext::clearSessions();
+}
+
+bool WiFiClientSecure::isSessionResumed()
+{
+    return _ssl && _ssl->resumed();
+}
+
+uint32_t WiFiClientSecure::getHandshakeTime()
+{
+    return _ssl ? _ssl->handshakeMillis() : 0;
+}
+
+bool WiFiClientSecure::setMaxFragmentLength(uint16_t size)
+{
+    if (size != 0 && size != 512 && size != 1024 && size != 2048 && size != 4096) {
+        return false;
+    }
+    _maxFragmentLength = size;
+    return true;
+}
+
+uint32_t WiFiClientSecure::getTLSMemory()
+{
+    return _ssl ? _ssl->memoryUsed() : 0;
 }
 
 void WiFiClientSecure::_initSSLContext()
@@ -25,8 +25,13 @@
 #include "WiFiClient.h"
 #include "include/ssl.h"
 
+// Number of TLS sessions kept for resumption, see setSessionReuse()
+#ifndef SSL_SESSION_CACHE_SIZE
+#define SSL_SESSION_CACHE_SIZE 4
+#endif
 
 class SSLContext;
+class SSLServerContext;
 
 class WiFiClientSecure : public WiFiClient {
 public:
@@ -37,12 +42,38 @@ public:
   int connect(const String host, uint16_t port) override;
   int connect(const char* name, uint16_t port) override;
 
+  // Connect without waiting for the TLS handshake: it continues from the
+  // scheduler, a step per loop iteration as the server's messages arrive,
+  // so the sketch keeps running meanwhile. handler gets HANDSHAKE_PROGRESS
+  // after each step that got further, then HANDSHAKE_DONE (when the client
+  // is connected and can be verified) or HANDSHAKE_FAILED. Returns 0 if
+  // the TCP connection or starting the handshake failed; the handler is
+  // not called then. Steps which process a certificate or key exchange
+  // still take as long as the crypto does.
+  enum HandshakeEvent {
+    HANDSHAKE_PROGRESS,
+    HANDSHAKE_DONE,
+    HANDSHAKE_FAILED
+  };
+  typedef std::function<void(HandshakeEvent event)> HandshakeHandler;
+  int connectAsync(IPAddress ip, uint16_t port, HandshakeHandler handler);
+  int connectAsync(const char* name, uint16_t port, HandshakeHandler handler);
+  // Whether an asynchronous handshake is still going on
+  bool handshaking();
+
   bool verify(const char* fingerprint, const char* domain_name);
   bool verifyCertChain(const char* domain_name);
 
   uint8_t connected() override;
   size_t write(const uint8_t *buf, size_t size) override;
   size_t write_P(PGM_P buf, size_t size) override;
+  size_t write(const IOVec* iov, size_t count) override;
+  // TLS encrypts into its own buffer and sends before returning, so these
+  // block like write(). writeNoCopy() calls onReleased before it returns;
+  // writeAsync() still calls onDone once the peer has acknowledged the
+  // records, or with false if the connection is lost.
+  size_t writeNoCopy(const uint8_t *buf, size_t size, std::function<void()> onReleased = nullptr) override;
+  size_t writeAsync(const uint8_t *buf, size_t size, std::function<void(bool)> onDone = nullptr) override;
   int read(uint8_t *buf, size_t size) override;
   int available() override;
   int read() override;
@@ -64,6 +95,31 @@ public:
 
   void allowSelfSignedCerts();
 
+  // Resume the TLS session of an earlier connection to the same host and
+  // port, which skips the key exchange and most of the handshake. Sessions
+  // are shared by all clients and kept until clearSessionCache(). A resumed
+  // connection passes verify() or verifyCertChain() only if the session
+  // passed the same check when it was new, as no certificate is sent.
+  void setSessionReuse(bool reuse);
+  static void clearSessionCache();
+  // Whether the last connect() resumed a session, and how long its
+  // handshake took in ms
+  bool isSessionResumed();
+  uint32_t getHandshakeTime();
+
+  // Ask the server for TLS records of at most size bytes: 512, 1024, 2048
+  // or 4096, or 0 (the default) for the full 16 kB. Servers which accept
+  // keep the receive buffer of the connection at that size, so several
+  // connections fit in the heap at once. If the server rejects the request
+  // with an alert, connect() tries once more without it; other handshake
+  // failures are not retried. connectAsync() never retries: its handler
+  // gets HANDSHAKE_FAILED, and the sketch may call setMaxFragmentLength(0)
+  // and connect again.
+  bool setMaxFragmentLength(uint16_t size);
+  // Heap taken by the TLS state of the connection, in bytes, as measured
+  // when its handshake completed
+  uint32_t getTLSMemory();
+
   template<typename TFile>
   bool loadCertificate(TFile& file) {
     return loadCertificate(file, file.size());
@@ -82,14 +138,20 @@ public:
 friend class WiFiServerSecure; // Needs access to custom constructor below
 protected:
   // Only called by WiFiServerSecure
-  WiFiClientSecure(ClientContext* client, bool usePMEM, const uint8_t *rsakey, int rsakeyLen, const uint8_t *cert, int certLen);
+  WiFiClientSecure(ClientContext* client, const std::shared_ptr<SSLServerContext>& serverCtx);
+  // Parses the server key and certificate once for all its connections
+  static std::shared_ptr<SSLServerContext> _createServerContext(bool usePMEM, const uint8_t *rsakey, int rsakeyLen, const uint8_t *cert, int certLen);
 
 protected:
     void _initSSLContext();
-    int _connectSSL(const char* hostName);
+    int _connect(IPAddress ip, uint16_t port, const char* hostName);
+    int _connectSSL(const char* hostName, uint16_t maxFragment, bool* alerted = nullptr);
+    int _connectAsync(IPAddress ip, uint16_t port, const char* hostName, HandshakeHandler handler);
     bool _verifyDN(const char* name);
 
     std::shared_ptr<SSLContext> _ssl = nullptr;
+    bool _sessionReuse = false;
+    uint16_t _maxFragmentLength = 0;
 };
 
 #endif //wificlientsecure_h
@@ -0,0 +1,186 @@
+/*
+ WiFiFastResume.cpp - quick reconnection after deep sleep
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "WiFiFastResume.h"
+#include <string.h>
+
+extern "C" {
+#include "lwip/init.h" // LWIP_VERSION_
+#include "lwip/netif.h"
+#include "lwip/dhcp.h"
+#include "netif/etharp.h"
+}
+
+#ifdef DEBUG_ESP_WIFI
+#ifdef DEBUG_ESP_PORT
+#define DEBUG_WIFI_RESUME(...) DEBUG_ESP_PORT.printf( __VA_ARGS__ )
+#endif
+#endif
+
+#ifndef DEBUG_WIFI_RESUME
+#define DEBUG_WIFI_RESUME(...)
+#endif
+
+const size_t WiFiFastResume::blocks = RTCRecord<WiFiFastResume::Config>::blocks;
+
+WiFiFastResume::WiFiFastResume(uint32_t rtcOffset) :
+    _rtc(rtcOffset), _renewWakes(WIFI_RESUME_RENEW_WAKES), _resumed(false), _connectTime(0) {
+}
+
+void WiFiFastResume::setRenewInterval(uint16_t wakes) {
+    _renewWakes = wakes;
+}
+
+void WiFiFastResume::forget(void) {
+    _rtc.invalidate();
+}
+
+wl_status_t WiFiFastResume::begin(const char* ssid, const char* passphrase, uint32_t timeout) {
+    uint32_t start = millis();
+    _resumed = false;
+
+    WiFi.mode(WIFI_STA);
+
+    Config config;
+    if(_rtc.read(config) && config.ssidCrc == rtcCRC32(ssid, strlen(ssid)) && leaseValid(config)) {
+        wl_status_t status = resume(config, ssid, passphrase);
+        if(status == WL_CONNECTED) {
+            _resumed = true;
+            _connectTime = millis() - start;
+            return status;
+        }
+        DEBUG_WIFI_RESUME("[WIFI] resume failed (%d), full connection\n", status);
+        _rtc.invalidate();
+        WiFi.disconnect();
+    }
+
+    wl_status_t status = connect(ssid, passphrase, timeout);
+    _connectTime = millis() - start;
+    return status;
+}
+
+void WiFiFastResume::deepSleep(uint64_t time_us, RFMode mode) {
+    Config config;
+    if(_rtc.read(config)) {
+        // millis() counts from the wake, or from the lease on a full connection
+        uint64_t elapsed = (uint64_t) config.elapsed + millis() + time_us / 1000;
+        config.elapsed = elapsed < UINT32_MAX ? elapsed : UINT32_MAX;
+        _rtc.write(config);
+    }
+    ESP.deepSleep(time_us, mode);
+}
+
+// renewed at half the lease, as DHCP clients do, and at the latest after
+// _renewWakes wakes whose sleep was not counted
+bool WiFiFastResume::leaseValid(const Config& config) const {
+    if(config.wakes >= _renewWakes) {
+        return false;
+    }
+    if(config.elapsed / 1000 >= config.lease / 2) {
+        DEBUG_WIFI_RESUME("[WIFI] %u of %u s of the lease passed, renew\n", config.elapsed / 1000, config.lease);
+        return false;
+    }
+    return true;
+}
+
+wl_status_t WiFiFastResume::resume(const Config& config, const char* ssid, const char* passphrase) {
+    // static address first, so no DHCP client is started
+    WiFi.config(IPAddress(config.ip), IPAddress(config.gateway), IPAddress(config.subnet), IPAddress(config.dns));
+    WiFi.begin(ssid, passphrase, config.channel, config.bssid);
+
+    wl_status_t status = wait(WIFI_RESUME_CONNECT_TIMEOUT);
+    if(status != WL_CONNECTED) {
+        return status;
+    }
+    requestGatewayMAC(config.gateway);
+
+    Config next = config;
+    ++next.wakes;
+    _rtc.write(next);
+    DEBUG_WIFI_RESUME("[WIFI] resumed on channel %d, wake %d\n", config.channel, next.wakes);
+    return status;
+}
+
+wl_status_t WiFiFastResume::connect(const char* ssid, const char* passphrase, uint32_t timeout) {
+    // back to DHCP, for a fresh lease
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    WiFi.begin(ssid, passphrase);
+
+    wl_status_t status = wait(timeout);
+    if(status != WL_CONNECTED) {
+        return status;
+    }
+
+    Config config;
+    memset(&config, 0, sizeof(config));
+    config.ssidCrc = rtcCRC32(ssid, strlen(ssid));
+    config.ip = WiFi.localIP();
+    config.gateway = WiFi.gatewayIP();
+    config.subnet = WiFi.subnetMask();
+    config.dns = WiFi.dnsIP();
+    memcpy(config.bssid, WiFi.BSSID(), sizeof(config.bssid));
+    config.channel = WiFi.channel();
+    config.lease = leaseTime();
+    _rtc.write(config);
+    DEBUG_WIFI_RESUME("[WIFI] full connection, lease of %u s kept for the next wakes\n", config.lease);
+    return status;
+}
+
+uint32_t WiFiFastResume::leaseTime(void) {
+    uint32_t lease = 0;
+    if(netif_default) {
+#if LWIP_VERSION_MAJOR == 1
+        struct dhcp* dhcp = netif_default->dhcp;
+#else
+        struct dhcp* dhcp = netif_dhcp_data(netif_default);
+#endif
+        if(dhcp) {
+            lease = dhcp->offered_t0_lease;
+        }
+    }
+    if(!lease || lease > WIFI_RESUME_MAX_LEASE) {
+        lease = WIFI_RESUME_MAX_LEASE;
+    }
+    return lease;
+}
+
+wl_status_t WiFiFastResume::wait(uint32_t timeout) {
+    wl_status_t status = WiFi.status();
+    uint32_t start = millis();
+    while(status != WL_CONNECTED && status != WL_NO_SSID_AVAIL && status != WL_CONNECT_FAILED && (millis() - start) <= timeout) {
+        delay(1);
+        status = WiFi.status();
+    }
+    return status;
+}
+
+// The gateway's ARP entry cannot be restored, the table only takes entries
+// the gateway answers with; ask right away, so the reply is likely in
+// before the first packet is sent.
+void WiFiFastResume::requestGatewayMAC(uint32_t gateway) {
+    if(!netif_default) {
+        return;
+    }
+#if LWIP_VERSION_MAJOR == 1
+    ip_addr_t addr;
+#else
+    ip4_addr_t addr;
+#endif
+    addr.addr = gateway;
+    etharp_request(netif_default, &addr);
+}
@@ -0,0 +1,111 @@
+/*
+ WiFiFastResume.h - quick reconnection after deep sleep
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef WIFIFASTRESUME_H_
+#define WIFIFASTRESUME_H_
+
+#include "ESP8266WiFi.h"
+#include "include/RTCRecord.h"
+
+// Wakes between two full connections, which renew the DHCP lease
+#ifndef WIFI_RESUME_RENEW_WAKES
+#define WIFI_RESUME_RENEW_WAKES 50
+#endif
+
+// Longest lease counted on, in seconds, also taken when the DHCP server
+// gives none
+#ifndef WIFI_RESUME_MAX_LEASE
+#define WIFI_RESUME_MAX_LEASE 86400
+#endif
+
+// How long a resumed connection may take before a full one is made
+#ifndef WIFI_RESUME_CONNECT_TIMEOUT
+#define WIFI_RESUME_CONNECT_TIMEOUT 3000
+#endif
+
+// Connects a station that wakes from deep sleep much faster than
+// WiFi.begin() does. The first connection is a normal one, with a scan and
+// DHCP; the address it leases, the gateway, subnet and DNS server, and the
+// BSSID and channel of the AP are kept in RTC user memory. After the next
+// wakes, the station joins that AP on that channel straight away and
+// configures the kept address statically, so it can send as soon as it is
+// associated, without waiting for DHCP. The gateway is asked for its MAC at
+// once, so the first packet does not wait for ARP either.
+//
+// A full connection is made again once half of the lease has passed, as
+// a DHCP client renews it, every WIFI_RESUME_RENEW_WAKES wakes, and
+// whenever a resumed connection fails; this keeps the lease alive and
+// notices a changed network. Only the time slept with deepSleep() below,
+// and the time awake before it, counts towards the lease.
+//
+// WiFi.persistent(false) should be called before, or each connection
+// writes the configuration to flash.
+class WiFiFastResume {
+    public:
+        // offset in RTC user memory, in 4 byte blocks as
+        // ESP.rtcUserMemoryWrite takes it; blocks of them are used
+        explicit WiFiFastResume(uint32_t rtcOffset = 0);
+
+        wl_status_t begin(const char* ssid, const char* passphrase = NULL, uint32_t timeout = 10000);
+
+        // ESP.deepSleep(), counting the time awake and asleep against the
+        // lease of the kept address
+        void deepSleep(uint64_t time_us, RFMode mode = RF_DEFAULT);
+
+        void setRenewInterval(uint16_t wakes);
+        // the next connection is a full one
+        void forget(void);
+
+        // the last connection used what was kept
+        bool resumed(void) const { return _resumed; }
+        // ms the last connection took
+        uint32_t connectTime(void) const { return _connectTime; }
+
+        static const size_t blocks;
+
+    private:
+        struct Config {
+            uint32_t ssidCrc;
+            uint32_t ip;
+            uint32_t gateway;
+            uint32_t subnet;
+            uint32_t dns;
+            uint8_t bssid[6];
+            uint8_t channel;
+            uint8_t reserved;
+            uint16_t wakes;
+            uint16_t reserved2;
+            uint32_t lease;     // s
+            uint32_t elapsed;   // ms since the lease was taken
+        };
+
+        bool leaseValid(const Config& config) const;
+        uint32_t leaseTime(void);
+
+        wl_status_t resume(const Config& config, const char* ssid, const char* passphrase);
+        wl_status_t connect(const char* ssid, const char* passphrase, uint32_t timeout);
+        wl_status_t wait(uint32_t timeout);
+        void requestGatewayMAC(uint32_t gateway);
+
+        RTCRecord<Config> _rtc;
+        uint16_t _renewWakes;
+        bool _resumed;
+        uint32_t _connectTime;
+};
+
+#endif /* WIFIFASTRESUME_H_ */
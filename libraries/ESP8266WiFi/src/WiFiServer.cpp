@@ -41,7 +41,7 @@ WiFiServer::WiFiServer(IPAddress addr, uint16_t port)
 : _port(port)
 , _addr(addr)
 , _pcb(nullptr)
-, _unclaimed(nullptr)
+, _unclaimed(&WiFiServer::_s_discard, this)
 , _discarded(nullptr)
 {
 }
@@ -50,11 +50,16 @@ WiFiServer::WiFiServer(uint16_t port)
 : _port(port)
 , _addr((uint32_t) IPADDR_ANY)
 , _pcb(nullptr)
-, _unclaimed(nullptr)
+, _unclaimed(&WiFiServer::_s_discard, this)
 , _discarded(nullptr)
 {
 }
 
+WiFiServer::~WiFiServer() {
+    // nobody else knows about connections still waiting to be claimed
+    _unclaimed.clear();
+}
+
 void WiFiServer::begin() {
 	begin(_port);
 }
@@ -95,17 +100,44 @@ bool WiFiServer::getNoDelay() {
     return _noDelay;
 }
 
+void WiFiServer::setReceiveLimit(size_t limit) {
+    _rxLimit = limit;
+}
+
+size_t WiFiServer::getReceiveLimit() {
+    return _rxLimit;
+}
+
+void WiFiServer::setBacklog(size_t backlog) {
+    _unclaimed.setBacklog(backlog);
+}
+
+size_t WiFiServer::getBacklog() {
+    return _unclaimed.getBacklog();
+}
+
+uint32_t WiFiServer::acceptedCount() {
+    return _unclaimed.accepted();
+}
+
+uint32_t WiFiServer::rejectedCount() {
+    return _unclaimed.rejected();
+}
+
+uint32_t WiFiServer::evictedCount() {
+    return _unclaimed.evicted();
+}
+
 bool WiFiServer::hasClient() {
-    if (_unclaimed)
+    if (!_unclaimed.empty())
         return true;
     return false;
 }
 
 WiFiClient WiFiServer::available(byte* status) {
     (void) status;
-    if (_unclaimed) {
-        WiFiClient result(_unclaimed);
-        _unclaimed = _unclaimed->next();
+    if (!_unclaimed.empty()) {
+        WiFiClient result(_unclaimed.pop());
         result.setNoDelay(_noDelay);
         DEBUGV("WS:av\r\n");
         return result;
@@ -145,23 +177,18 @@ size_t WiFiServer::write(const uint8_t *buffer, size_t size) {
     return 0;
 }
 
-template<typename T>
-T* slist_append_tail(T* head, T* item) {
-    if (!head)
-        return item;
-    T* last = head;
-    while(last->next())
-        last = last->next();
-    last->next(item);
-    return head;
-}
-
 long WiFiServer::_accept(tcp_pcb* apcb, long err) {
     (void) err;
     DEBUGV("WS:ac\r\n");
-    ClientContext* client = new ClientContext(apcb, &WiFiServer::_s_discard, this);
-    _unclaimed = slist_append_tail(_unclaimed, client);
     tcp_accepted(_pcb);
+    ClientContext* client = _unclaimed.push(apcb);
+    if (!client) {
+        // lwIP resets a connection whose accept callback fails
+        DEBUGV("WS:rej\r\n");
+        return ERR_MEM;
+    }
+    // applied here, before data can pile up for a client not yet claimed
+    client->set_rx_limit(_rxLimit);
     return ERR_OK;
 }
 
@@ -30,6 +30,7 @@ extern "C" {
 
 #include "Server.h"
 #include "IPAddress.h"
+#include "include/AcceptQueue.h"
 
 class ClientContext;
 class WiFiClient;
@@ -41,20 +42,34 @@ protected:
   IPAddress _addr;
   tcp_pcb* _pcb;
 
-  ClientContext* _unclaimed;
+  AcceptQueue<ClientContext> _unclaimed;
   ClientContext* _discarded;
   bool _noDelay = false;
+  size_t _rxLimit = 0;
 
 public:
   WiFiServer(IPAddress addr, uint16_t port);
   WiFiServer(uint16_t port);
-  virtual ~WiFiServer() {}
+  virtual ~WiFiServer();
   WiFiClient available(uint8_t* status = NULL);
   bool hasClient();
   void begin();
   void begin(uint16_t port);
   void setNoDelay(bool nodelay);
   bool getNoDelay();
+  // Receive limit for accepted clients, see WiFiClient::setReceiveLimit
+  void setReceiveLimit(size_t limit);
+  size_t getReceiveLimit();
+  // Most accepted connections waiting for available(), 0 for no limit,
+  // which is the default unless WIFI_SERVER_BACKLOG says otherwise. When
+  // full, the oldest one that has sent nothing yet is reset to make room;
+  // if all of them have, the new connection is reset instead.
+  void setBacklog(size_t backlog);
+  size_t getBacklog();
+  // Connections queued, turned away and reset to make room so far
+  uint32_t acceptedCount();
+  uint32_t rejectedCount();
+  uint32_t evictedCount();
   virtual size_t write(uint8_t);
   virtual size_t write(const uint8_t *buf, size_t size);
   uint8_t status();
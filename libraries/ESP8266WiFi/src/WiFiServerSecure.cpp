@@ -46,28 +46,23 @@ WiFiServerSecure::WiFiServerSecure(uint16_t port) : WiFiServer(port)
 
 void WiFiServerSecure::setServerKeyAndCert(const uint8_t *key, int keyLen, const uint8_t *cert, int certLen)
 {
-    this->usePMEM = false;
-    this->rsakey = key;
-    this->rsakeyLen = keyLen;
-    this->cert = cert;
-    this->certLen = certLen;
+    _serverCtx = WiFiClientSecure::_createServerContext(false, key, keyLen, cert, certLen);
 }
 
 void WiFiServerSecure::setServerKeyAndCert_P(const uint8_t *key, int keyLen, const uint8_t *cert, int certLen)
 {
-    this->usePMEM = true;
-    this->rsakey = key;
-    this->rsakeyLen = keyLen;
-    this->cert = cert;
-    this->certLen = certLen;
+    _serverCtx = WiFiClientSecure::_createServerContext(true, key, keyLen, cert, certLen);
 }
 
 WiFiClientSecure WiFiServerSecure::available(uint8_t* status)
 {
     (void) status; // Unused
-    if (_unclaimed) {
-        WiFiClientSecure result(_unclaimed, usePMEM, rsakey, rsakeyLen, cert, certLen);
-        _unclaimed = _unclaimed->next();
+    if (!_unclaimed.empty()) {
+        if (!_serverCtx) {
+            // no key set, the handshake is going to fail as it always did
+            _serverCtx = WiFiClientSecure::_createServerContext(false, nullptr, 0, nullptr, 0);
+        }
+        WiFiClientSecure result(_unclaimed.pop(), _serverCtx);
         result.setNoDelay(_noDelay);
         DEBUGV("WS:av\r\n");
         return result;
@@ -20,23 +20,23 @@
 #ifndef wifiserversecure_h
 #define wifiserversecure_h
 
+#include <memory>
 #include "WiFiServer.h"
 class WiFiClientSecure;
+class SSLServerContext;
 
 class WiFiServerSecure : public WiFiServer {
 public:
   WiFiServerSecure(IPAddress addr, uint16_t port);
   WiFiServerSecure(uint16_t port);
+  // The key and certificate are parsed here, once, and shared by all
+  // connections; the data may be released or overwritten afterwards.
   void setServerKeyAndCert(const uint8_t *key, int keyLen, const uint8_t *cert, int certLen);
   void setServerKeyAndCert_P(const uint8_t *key, int keyLen, const uint8_t *cert, int certLen);
   virtual ~WiFiServerSecure() {}
   WiFiClientSecure available(uint8_t* status = NULL);
 private:
-  bool usePMEM = false;
-  const uint8_t *rsakey = nullptr;
-  int rsakeyLen = 0;
-  const uint8_t *cert = nullptr;
-  int certLen = 0;
+  std::shared_ptr<SSLServerContext> _serverCtx;
 };
 
 #endif
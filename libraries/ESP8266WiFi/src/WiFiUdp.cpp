@@ -163,6 +163,22 @@ int WiFiUDP::beginPacket(IPAddress ip, uint16_t port)
     return (_ctx->connect(addr, port)) ? 1 : 0;
 }
 
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port, size_t size)
+{
+    if (!beginPacket(ip, port))
+        return 0;
+    _ctx->reserve(size);
+    return 1;
+}
+
+int WiFiUDP::beginPacket(const char *host, uint16_t port, size_t size)
+{
+    if (!beginPacket(host, port))
+        return 0;
+    _ctx->reserve(size);
+    return 1;
+}
+
 int WiFiUDP::beginPacketMulticast(IPAddress multicastAddress, uint16_t port,
     IPAddress interfaceAddress, int ttl)
 {
@@ -204,6 +220,14 @@ size_t WiFiUDP::write(const uint8_t *buffer, size_t size)
     return _ctx->append(reinterpret_cast<const char*>(buffer), size);
 }
 
+size_t WiFiUDP::write(const IOVec* iov, size_t count)
+{
+    if (!_ctx)
+        return 0;
+
+    return _ctx->append(iov, count);
+}
+
 int WiFiUDP::parsePacket()
 {
     if (!_ctx)
@@ -246,6 +270,32 @@ void WiFiUDP::flush()
     endPacket();
 }
 
+size_t WiFiUDP::recvBatch(BatchHandler handler, size_t max)
+{
+    if (!_ctx)
+        return 0;
+
+    return _ctx->recv_batch([&handler](const uint8_t* data, size_t len, uint32_t addr, uint16_t port) {
+        handler(data, len, IPAddress(addr), port);
+    }, max);
+}
+
+size_t WiFiUDP::rxQueued()
+{
+    if (!_ctx)
+        return 0;
+
+    return _ctx->getRxQueued();
+}
+
+size_t WiFiUDP::rxDropped()
+{
+    if (!_ctx)
+        return 0;
+
+    return _ctx->getRxDropped();
+}
+
 IPAddress WiFiUDP::remoteIP()
 {
     if (!_ctx)
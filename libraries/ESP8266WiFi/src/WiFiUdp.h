@@ -22,8 +22,10 @@
 #ifndef WIFIUDP_H
 #define WIFIUDP_H
 
+#include <functional>
 #include <Udp.h>
 #include <include/slist.h>
+#include <include/IOVec.h>
 
 #define UDP_TX_PACKET_MAX_SIZE 8192
 
@@ -57,6 +59,10 @@ public:
   // Start building up a packet to send to the remote host specific in host and port
   // Returns 1 if successful, 0 if there was a problem resolving the hostname or port
   virtual int beginPacket(const char *host, uint16_t port);
+  // Same as above for a packet of about size bytes, which is then built
+  // in one buffer and handed to the network stack without another copy
+  int beginPacket(IPAddress ip, uint16_t port, size_t size);
+  int beginPacket(const char *host, uint16_t port, size_t size);
   // Start building up a packet to send to the multicast address
   // multicastAddress - muticast address to send to
   // interfaceAddress - the local IP address of the interface that should be used
@@ -74,6 +80,8 @@ public:
   virtual size_t write(uint8_t);
   // Write size bytes from buffer into the packet
   virtual size_t write(const uint8_t *buffer, size_t size);
+  // Write count pieces into the packet in one go
+  size_t write(const IOVec* iov, size_t count);
   
   using Print::write;
 
@@ -94,6 +102,17 @@ public:
   virtual int peek();
   virtual void flush();	// Finish reading the current packet
 
+  // Hand up to max queued packets to handler, one call each, and drop
+  // them; the current packet is left alone. data is only valid during the
+  // call. Returns the number of packets handled.
+  typedef std::function<void(const uint8_t* data, size_t len, IPAddress remoteIP, uint16_t remotePort)> BatchHandler;
+  size_t recvBatch(BatchHandler handler, size_t max = SIZE_MAX);
+  // Packets waiting behind the current one
+  size_t rxQueued();
+  // Packets dropped because too many were waiting, see UDP_RX_QUEUE_LEN
+  // in include/UdpContext.h
+  size_t rxDropped();
+
   // Return the IP address of the host who sent the current incoming packet
   virtual IPAddress remoteIP();
   // Return the port of the host who sent the current incoming packet
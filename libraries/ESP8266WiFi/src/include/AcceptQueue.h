@@ -0,0 +1,183 @@
+/*
+ AcceptQueue.h - bounded queue of accepted, not yet claimed connections
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef ACCEPTQUEUE_H
+#define ACCEPTQUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct tcp_pcb;
+
+// Most connections a server keeps waiting for available() by default; 0,
+// no limit, as before the backlog existed. Browsers open about six
+// connections at once, so a limit below that resets idle ones.
+#ifndef WIFI_SERVER_BACKLOG
+#define WIFI_SERVER_BACKLOG 0
+#endif
+
+// Connections accepted by a listening pcb wait here until the sketch claims
+// them. The queue holds at most backlog of them; when a new one arrives at a
+// full queue, the oldest idle one (nothing to read) makes room for it, and if
+// every waiting client has sent data the newcomer is turned away. Only this
+// queue knows about an unclaimed context, so it owns it until pop().
+// T is ClientContext; the template keeps lwIP out of WiFiServer.h.
+template<typename T>
+class AcceptQueue
+{
+public:
+    typedef void (*discard_cb_t)(void*, T*);
+
+    AcceptQueue(discard_cb_t discard_cb, void* discard_cb_arg) :
+        _head(0), _tail(0), _count(0), _backlog(WIFI_SERVER_BACKLOG),
+        _accepted(0), _rejected(0), _evicted(0),
+        _discard_cb(discard_cb), _discard_cb_arg(discard_cb_arg)
+    {
+    }
+
+    ~AcceptQueue()
+    {
+        clear();
+    }
+
+    AcceptQueue(const AcceptQueue&) = delete;
+    AcceptQueue& operator=(const AcceptQueue&) = delete;
+
+    // Wrap a pcb lwIP has just accepted and queue it. Returns nullptr if
+    // there is no room; the accept callback should then fail so that lwIP
+    // resets the connection before anything is allocated for it.
+    T* push(tcp_pcb* pcb)
+    {
+        if(_backlog && _count >= _backlog && !_evict()) {
+            ++_rejected;
+            return 0;
+        }
+        T* client = new T(pcb, _discard_cb, _discard_cb_arg);
+        if(_tail) {
+            _tail->next(client);
+        } else {
+            _head = client;
+        }
+        _tail = client;
+        ++_count;
+        ++_accepted;
+        return client;
+    }
+
+    // Oldest waiting connection, now owned by the caller
+    T* pop()
+    {
+        T* client = _head;
+        if(client) {
+            _unlink(0, client);
+        }
+        return client;
+    }
+
+    bool empty() const
+    {
+        return !_head;
+    }
+
+    size_t size() const
+    {
+        return _count;
+    }
+
+    // 0 lifts the limit. A smaller backlog does not drop anything already
+    // waiting, it only applies to connections arriving from now on.
+    void setBacklog(size_t backlog)
+    {
+        _backlog = backlog;
+    }
+
+    size_t getBacklog() const
+    {
+        return _backlog;
+    }
+
+    uint32_t accepted() const
+    {
+        return _accepted;
+    }
+
+    uint32_t rejected() const
+    {
+        return _rejected;
+    }
+
+    uint32_t evicted() const
+    {
+        return _evicted;
+    }
+
+    // Reset every waiting connection
+    void clear()
+    {
+        while(_head) {
+            _drop(0, _head);
+        }
+    }
+
+protected:
+    bool _evict()
+    {
+        T* prev = 0;
+        for(T* client = _head; client; prev = client, client = client->next()) {
+            if(!client->getSize()) {
+                _drop(prev, client);
+                ++_evicted;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void _drop(T* prev, T* client)
+    {
+        _unlink(prev, client);
+        client->ref();
+        client->abort();
+        client->unref();
+    }
+
+    void _unlink(T* prev, T* client)
+    {
+        if(prev) {
+            prev->next(client->next());
+        } else {
+            _head = client->next();
+        }
+        if(_tail == client) {
+            _tail = prev;
+        }
+        client->next(0);
+        --_count;
+    }
+
+    T* _head;
+    T* _tail;
+    size_t _count;
+    size_t _backlog;
+    uint32_t _accepted;
+    uint32_t _rejected;
+    uint32_t _evicted;
+    discard_cb_t _discard_cb;
+    void* _discard_cb_arg;
+};
+
+#endif //ACCEPTQUEUE_H
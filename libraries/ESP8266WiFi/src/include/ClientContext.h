@@ -29,11 +29,16 @@ typedef void (*discard_cb_t)(void*, ClientContext*);
 extern "C" void esp_yield();
 extern "C" void esp_schedule();
 
+#include <functional>
+#include <Schedule.h>
 #include "DataSource.h"
 
 class ClientContext
 {
 public:
+    typedef std::function<size_t(const uint8_t* data, size_t len)> data_cb_t;
+    typedef std::function<void()> disconnect_cb_t;
+    typedef std::function<void(size_t len)> ack_cb_t;
     ClientContext(tcp_pcb* pcb, discard_cb_t discard_cb, void* discard_cb_arg) :
         _pcb(pcb), _rx_buf(0), _rx_buf_offset(0), _discard_cb(discard_cb), _discard_cb_arg(discard_cb_arg), _refcnt(0), _next(0)
     {
@@ -60,12 +65,31 @@ public:
             tcp_abort(_pcb);
             _pcb = 0;
         }
+        // lwIP has dropped all queued segments
+        _release_all();
         return ERR_ABRT;
     }
 
     err_t close()
     {
         err_t err = ERR_OK;
+        if(_pcb && (_async_len || _release_head)) {
+            // what write_async() queued goes to lwIP first, then data with
+            // a completion callback is waited for, so a stop() right after
+            // a write loses nothing. lwIP would keep referencing data queued
+            // without copy after the close, so if that is not acknowledged
+            // in time the connection is dropped.
+            _flush_async();
+            _wait_for_release();
+            if(_nocopy_pending()) {
+                DEBUGV(":clnc\r\n");
+                return abort();
+            }
+        }
+        // handlers often hold on to the client, which holds on to us
+        _on_data = nullptr;
+        _on_disconnect = nullptr;
+        _on_ack = nullptr;
         if(_pcb) {
             DEBUGV(":close\r\n");
             tcp_arg(_pcb, NULL);
@@ -81,11 +105,14 @@ public:
             }
             _pcb = 0;
         }
+        // callbacks are gone, whatever is still pending cannot be confirmed
+        _release_all();
         return err;
     }
 
     ~ClientContext()
     {
+        free(_async_buf);
     }
 
     ClientContext* next() const
@@ -111,6 +138,8 @@ public:
         if(--_refcnt == 0) {
             discard_received();
             close();
+            // with no owner left, nothing was scheduled for these
+            _run_done();
             if(_discard_cb) {
                 _discard_cb(_discard_cb_arg, this);
             }
@@ -147,6 +176,12 @@ public:
         return _pcb? tcp_sndbuf(_pcb): 0;
     }
 
+    // Room left in the send queue, i.e. how much write_async() accepts
+    size_t availableForWriteAsync()
+    {
+        return _pcb? _async_capacity - _async_len: 0;
+    }
+
     void setNoDelay(bool nodelay)
     {
         if(!_pcb) {
@@ -243,18 +278,37 @@ public:
         size = (size < max_size) ? size : max_size;
 
         DEBUGV(":rd %d, %d, %d\r\n", size, _rx_buf->tot_len, _rx_buf_offset);
-        size_t size_read = 0;
-        while(size) {
-            size_t buf_size = _rx_buf->len - _rx_buf_offset;
-            size_t copy_size = (size < buf_size) ? size : buf_size;
+        // copy across the chain first, then release the pbufs emptied on
+        // the way and open the window for them with a single tcp_recved()
+        pbuf* head = _rx_buf;
+        pbuf* p = head;
+        size_t offset = _rx_buf_offset;
+        size_t freed = 0;
+        size_t left = size;
+        while(left) {
+            size_t buf_size = p->len - offset;
+            size_t copy_size = (left < buf_size) ? left : buf_size;
             DEBUGV(":rdi %d, %d\r\n", buf_size, copy_size);
-            os_memcpy(dst, reinterpret_cast<char*>(_rx_buf->payload) + _rx_buf_offset, copy_size);
+            os_memcpy(dst, reinterpret_cast<char*>(p->payload) + offset, copy_size);
             dst += copy_size;
-            _consume(copy_size);
-            size -= copy_size;
-            size_read += copy_size;
+            left -= copy_size;
+            offset += copy_size;
+            if(offset == p->len) {
+                freed += p->len;
+                p = p->next;
+                offset = 0;
+            }
         }
-        return size_read;
+        if(p != head) {
+            if(p) {
+                pbuf_ref(p);
+            }
+            pbuf_free(head);
+            _rx_buf = p;
+            _recved(freed);
+        }
+        _rx_buf_offset = offset;
+        return size;
     }
 
     char peek()
@@ -288,9 +342,7 @@ public:
         if(!_rx_buf) {
             return;
         }
-        if(_pcb) {
-            tcp_recved(_pcb, (size_t) _rx_buf->tot_len);
-        }
+        _recved(_rx_buf->tot_len);
         pbuf_free(_rx_buf);
         _rx_buf = 0;
         _rx_buf_offset = 0;
@@ -306,7 +358,8 @@ public:
 
         int tries = 1+ WAIT_TRIES_MS;
 
-        while (state() == ESTABLISHED && tcp_sndbuf(_pcb) != TCP_SND_BUF && --tries) {
+        while (state() == ESTABLISHED && (tcp_sndbuf(_pcb) != TCP_SND_BUF || _async_len) && --tries) {
+            _drain_async();
             _write_some();
             delay(1); // esp_ schedule+yield
         }
@@ -327,7 +380,19 @@ public:
         if (!_pcb) {
             return 0;
         }
-        return _write_from_source(new BufferDataSource(data, size));
+        BufferDataSource ds(data, size);
+        return _write_from_source(ds);
+    }
+
+    // All pieces are queued before tcp_output(), so small headers and
+    // trailers share segments with the payload
+    size_t write(const IOVec* iov, size_t count)
+    {
+        if (!_pcb) {
+            return 0;
+        }
+        IOVecDataSource ds(iov, count, _staging);
+        return _write_from_source(ds);
     }
 
     size_t write(Stream& stream)
@@ -335,7 +400,8 @@ public:
         if (!_pcb) {
             return 0;
         }
-        return _write_from_source(new BufferedStreamDataSource<Stream>(stream, stream.available()));
+        BufferedStreamDataSource<Stream> ds(stream, stream.available(), _staging);
+        return _write_from_source(ds);
     }
 
     size_t write_P(PGM_P buf, size_t size)
@@ -343,8 +409,142 @@ public:
         if (!_pcb) {
             return 0;
         }
+        // flash is not byte addressable, so lwIP cannot reference it
         ProgmemStream stream(buf, size);
-        return _write_from_source(new BufferedStreamDataSource<ProgmemStream>(stream, size));
+        BufferedStreamDataSource<ProgmemStream> ds(stream, size, _staging);
+        return _write_from_source(ds);
+    }
+
+    // Queue data in RAM without copying it: lwIP references it until the
+    // peer acknowledges it. The data must stay valid and unchanged until
+    // then. released, if given, is called once lwIP no longer references
+    // the data: right away if it already does not, otherwise from the
+    // scheduler (see Schedule.h).
+    size_t write_nocopy(const uint8_t* data, size_t size, std::function<void()> released = nullptr)
+    {
+        size_t written = 0;
+        if (_pcb) {
+            BufferDataSource ds(data, size);
+            written = _write_from_source(ds, 0);
+        }
+        if (_pcb && written) {
+            _nocopy_end = _snd_total;
+        }
+        if (released) {
+            if (_pcb && (int32_t) (_snd_total - _acked_total) > 0) {
+                _add_release(_snd_total, [released](bool) { released(); });
+            } else {
+                released();
+            }
+        }
+        return written;
+    }
+
+    // Copy data into the send queue and return without waiting; the queue
+    // is drained into lwIP as the peer acknowledges earlier data. Returns
+    // the number of bytes accepted, which is less than size when the queue
+    // is full (see availableForWriteAsync()). If anything was accepted,
+    // done is called with true once the peer has acknowledged it all, or
+    // with false if the connection goes away first. done runs from the
+    // scheduler, never from the network stack, so it may write or stop the
+    // client.
+    size_t write_async(const uint8_t* data, size_t size, std::function<void(bool)> done = nullptr)
+    {
+        if (!_pcb) {
+            return 0;
+        }
+        if (!_async_buf) {
+            _async_buf = (uint8_t*) malloc(_async_capacity);
+            if (!_async_buf) {
+                return 0;
+            }
+        }
+        // whatever lwIP takes right away makes room for more
+        size_t accepted = 0;
+        while (accepted < size && _async_len < _async_capacity) {
+            size_t len = _async_capacity - _async_len;
+            if (len > size - accepted) {
+                len = size - accepted;
+            }
+            size_t tail = (_async_head + _async_len) % _async_capacity;
+            size_t first = _async_capacity - tail;
+            if (first > len) {
+                first = len;
+            }
+            memcpy(_async_buf + tail, data + accepted, first);
+            memcpy(_async_buf, data + accepted + first, len - first);
+            _async_len += len;
+            accepted += len;
+            _drain_async();
+        }
+        if (accepted && done) {
+            _add_release(_snd_total + _async_len, done);
+        }
+        return accepted;
+    }
+
+    // Call done with true once the peer has acknowledged everything written
+    // so far, or with false if the connection goes away first. Unless that
+    // is known now, done runs from the scheduler.
+    void notify_acked(std::function<void(bool)> done)
+    {
+        if (!_pcb) {
+            done(false);
+            return;
+        }
+        uint32_t end = _snd_total + _async_len;
+        if ((int32_t) (end - _acked_total) <= 0) {
+            done(true);
+            return;
+        }
+        _add_release(end, done);
+    }
+
+    // Event handlers are called from the scheduler (see Schedule.h) after
+    // the network stack has reported something, never from the stack
+    // itself. on_data gets received data in place, one contiguous piece at
+    // a time, and returns how much of it it consumed; the rest stays
+    // available for the next event or for read().
+    void on_data(data_cb_t cb)
+    {
+        _on_data = cb;
+        if (_on_data && _rx_buf) {
+            _schedule_events();
+        }
+    }
+
+    void on_disconnect(disconnect_cb_t cb)
+    {
+        _on_disconnect = cb;
+    }
+
+    void on_ack(ack_cb_t cb)
+    {
+        _on_ack = cb;
+    }
+
+    // Most received data to let the peer send ahead of what is read, when
+    // less than the TCP window. The window is kept that small by holding
+    // back its reopening by TCP_WND - limit bytes as data is read, so the
+    // limit is in force once that much has been read; until then up to
+    // TCP_WND is buffered, as without a limit. 0 means no limit.
+    void set_rx_limit(size_t limit)
+    {
+        _rx_limit = limit;
+        // a higher limit gives back what is held beyond it
+        size_t hold = _rx_hold();
+        if (_rx_withheld > hold) {
+            size_t give = _rx_withheld - hold;
+            _rx_withheld = hold;
+            if (_pcb) {
+                tcp_recved(_pcb, give);
+            }
+        }
+    }
+
+    size_t get_rx_limit() const
+    {
+        return _rx_limit;
     }
 
     void keepAlive (uint16_t idle_sec = TCP_DEFAULT_KEEPALIVE_IDLE_SEC, uint16_t intv_sec = TCP_DEFAULT_KEEPALIVE_INTERVAL_SEC, uint8_t count = TCP_DEFAULT_KEEPALIVE_COUNT)
@@ -393,11 +593,17 @@ protected:
         }
     }
 
-    size_t _write_from_source(DataSource* ds)
+    // ds only needs to live for the duration of the call
+    size_t _write_from_source(DataSource& ds, uint8_t flags = TCP_WRITE_FLAG_COPY)
     {
         assert(_datasource == nullptr);
         assert(_send_waiting == 0);
-        _datasource = ds;
+        // what was queued by write_async() goes first
+        if (!_flush_async()) {
+            return 0;
+        }
+        _datasource = &ds;
+        _write_flags = flags;
         _written = 0;
         _op_start_time = millis();
         do {
@@ -409,7 +615,6 @@ protected:
                 if (_is_timeout()) {
                     DEBUGV(":wtmo\r\n");
                 }
-                delete _datasource;
                 _datasource = nullptr;
                 break;
             }
@@ -434,20 +639,27 @@ protected:
         }
         size_t will_send = (can_send < left) ? can_send : left;
         DEBUGV(":wr %d %d %d\r\n", will_send, left, _written);
+        // one segment per tcp_write: fewer, fuller pbufs than small pieces,
+        // and each no-copy reference maps onto exactly one segment
+        size_t chunk_size = tcp_mss(_pcb);
+        if (chunk_size < _min_write_chunk_size) {
+            chunk_size = _min_write_chunk_size;
+        }
         bool need_output = false;
         while( will_send && _datasource) {
             size_t next_chunk =
-                will_send > _write_chunk_size ? _write_chunk_size : will_send;
+                will_send > chunk_size ? chunk_size : will_send;
             const uint8_t* buf = _datasource->get_buffer(next_chunk);
-            if (state() == CLOSED) {
+            if (!buf || state() == CLOSED) {
                 need_output = false;
                 break;
             }
-            err_t err = tcp_write(_pcb, buf, next_chunk, TCP_WRITE_FLAG_COPY);
+            err_t err = tcp_write(_pcb, buf, next_chunk, _write_flags);
             DEBUGV(":wrc %d %d %d\r\n", next_chunk, will_send, (int) err);
             if (err == ERR_OK) {
                 _datasource->release_buffer(buf, next_chunk);
                 _written += next_chunk;
+                _snd_total += next_chunk;
                 need_output = true;
             } else {
 		// ERR_MEM(-1) is a valid error meaning
@@ -463,6 +675,63 @@ protected:
         return false;
     }
 
+    // Hand as much of the send queue to lwIP as it takes now. Called from
+    // user code as well as from the sent and poll callbacks.
+    void _drain_async()
+    {
+        if (!_async_len || !_pcb || state() == CLOSED) {
+            return;
+        }
+        size_t chunk_size = tcp_mss(_pcb);
+        bool need_output = false;
+        while (_async_len && _pcb->snd_queuelen < TCP_SND_QUEUELEN) {
+            size_t next_chunk = _async_capacity - _async_head;
+            if (next_chunk > _async_len) {
+                next_chunk = _async_len;
+            }
+            if (next_chunk > chunk_size) {
+                next_chunk = chunk_size;
+            }
+            if (next_chunk > tcp_sndbuf(_pcb)) {
+                next_chunk = tcp_sndbuf(_pcb);
+            }
+            if (!next_chunk || tcp_write(_pcb, _async_buf + _async_head, next_chunk, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+                break;
+            }
+            DEBUGV(":wra %d %d\r\n", next_chunk, _async_len);
+            _async_head = (_async_head + next_chunk) % _async_capacity;
+            _async_len -= next_chunk;
+            _snd_total += next_chunk;
+            need_output = true;
+        }
+        if (!_async_len) {
+            _async_head = 0;
+        }
+        if (need_output) {
+            tcp_output(_pcb);
+        }
+    }
+
+    bool _flush_async()
+    {
+        _op_start_time = millis();
+        while (_async_len) {
+            _drain_async();
+            if (!_async_len) {
+                break;
+            }
+            if (_is_timeout() || state() == CLOSED) {
+                DEBUGV(":fatmo\r\n");
+                _send_waiting = 0;
+                return false;
+            }
+            ++_send_waiting;
+            esp_yield();
+        }
+        _send_waiting = 0;
+        return true;
+    }
+
     void _write_some_from_cb()
     {
         if (_send_waiting == 1) {
@@ -474,12 +743,214 @@ protected:
     err_t _sent(tcp_pcb* pcb, uint16_t len)
     {
         (void) pcb;
-        (void) len;
         DEBUGV(":sent %d\r\n", len);
+        // nothing run from here may drop the last owner of this context
+        bool hold = _refcnt > 0;
+        if (hold) {
+            ref();
+        }
+        _acked_total += len;
+        _release_acked();
+        _drain_async();
         _write_some_from_cb();
+        if (_on_ack) {
+            _acked_pending += len;
+            _schedule_events();
+        }
+        if (hold) {
+            _unref_from_stack();
+        }
         return ERR_OK;
     }
 
+    // Drop a reference taken in a network stack callback. The last one is
+    // dropped from the scheduler instead: close() may have to wait for the
+    // peer, which cannot be done from the stack.
+    void _unref_from_stack()
+    {
+        if (_refcnt == 1 && schedule_function([this]() { unref(); })) {
+            return;
+        }
+        unref();
+    }
+
+    // Events from the network stack are collected here and handed to the
+    // handlers in one scheduled call. The context stays referenced until
+    // then, so it outlives the WiFiClient if need be.
+    void _schedule_events()
+    {
+        if (_events_scheduled) {
+            return;
+        }
+        ref();
+        if (schedule_function([this]() { _dispatch_events(); unref(); })) {
+            _events_scheduled = true;
+        } else {
+            --_refcnt;
+        }
+    }
+
+    void _dispatch_events()
+    {
+        _events_scheduled = false;
+        _run_done();
+        // handlers are called through copies: one that stops the client
+        // clears them, which would destroy it and its captures mid-call
+        if (_on_ack && _acked_pending) {
+            size_t len = _acked_pending;
+            _acked_pending = 0;
+            ack_cb_t on_ack = _on_ack;
+            on_ack(len);
+        }
+        // data received before a disconnect is delivered first
+        while (_rx_buf && _on_data) {
+            pbuf* buf = _rx_buf;
+            size_t offset = _rx_buf_offset;
+            size_t len = buf->len - offset;
+            const uint8_t* data = reinterpret_cast<const uint8_t*>(buf->payload) + offset;
+            data_cb_t on_data = _on_data;
+            size_t used = on_data(data, len);
+            if (_rx_buf != buf || _rx_buf_offset != offset) {
+                // the handler read or discarded the data itself
+                break;
+            }
+            if (used > len) {
+                used = len;
+            }
+            if (used) {
+                _consume(used);
+            }
+            if (used < len) {
+                break;
+            }
+        }
+        if (_disconnect_pending) {
+            _disconnect_pending = false;
+            if (_on_disconnect) {
+                disconnect_cb_t on_disconnect = _on_disconnect;
+                on_disconnect();
+            }
+        }
+    }
+
+    // Call released(true) once the peer acknowledges the byte before end
+    void _add_release(uint32_t end, std::function<void(bool)> released)
+    {
+        release_t* rel = new release_t{end, released, false, nullptr};
+        if (_release_tail) {
+            _release_tail->next = rel;
+        } else {
+            _release_head = rel;
+        }
+        _release_tail = rel;
+    }
+
+    // Move the releases of acknowledged data to the done list. Their
+    // callbacks may block, write or stop the client, none of which can be
+    // done from the network stack, so they run from the scheduler along
+    // with the other events; while unref() destroys the context, it runs
+    // them itself.
+    void _release_acked(bool acked = true)
+    {
+        bool moved = false;
+        while (_release_head && (int32_t) (_acked_total - _release_head->end) >= 0) {
+            release_t* rel = _release_head;
+            _release_head = rel->next;
+            if (!_release_head) {
+                _release_tail = nullptr;
+            }
+            rel->acked = acked;
+            rel->next = nullptr;
+            if (_done_tail) {
+                _done_tail->next = rel;
+            } else {
+                _done_head = rel;
+            }
+            _done_tail = rel;
+            moved = true;
+        }
+        if (moved && _refcnt > 0) {
+            _schedule_events();
+        }
+    }
+
+    // Call back the owners of released data. A callback may drop the last
+    // owner of this context, e.g. the WiFiClient it captured, so a
+    // reference is held for the loop; while unref() is destroying the
+    // context there is no owner left to drop.
+    void _run_done()
+    {
+        bool hold = _refcnt > 0;
+        if (hold) {
+            ref();
+        }
+        while (_done_head) {
+            release_t* rel = _done_head;
+            _done_head = rel->next;
+            if (!_done_head) {
+                _done_tail = nullptr;
+            }
+            // unlinked and freed first, the callback may add releases
+            std::function<void(bool)> released = std::move(rel->released);
+            bool acked = rel->acked;
+            delete rel;
+            released(acked);
+        }
+        if (hold) {
+            unref();
+        }
+    }
+
+    // The pcb is gone along with its segments, nothing is referenced
+    // anymore and nothing more will be acknowledged
+    void _release_all()
+    {
+        _acked_total = _snd_total + _async_len;
+        _async_head = 0;
+        _async_len = 0;
+        _release_acked(false);
+    }
+
+    bool _nocopy_pending() const
+    {
+        return (int32_t) (_nocopy_end - _acked_total) > 0;
+    }
+
+    void _wait_for_release()
+    {
+        assert(_send_waiting == 0);
+        _op_start_time = millis();
+        while (_release_head && state() != CLOSED && !_is_timeout()) {
+            ++_send_waiting;
+            esp_yield();
+        }
+        _send_waiting = 0;
+    }
+
+    // How much of the window to keep closed for the receive limit
+    size_t _rx_hold() const
+    {
+        size_t wnd = TCP_WND;
+        return (_rx_limit && _rx_limit < wnd) ? wnd - _rx_limit : 0;
+    }
+
+    // Reopen the window for len bytes read, keeping _rx_hold() of it closed
+    void _recved(size_t len)
+    {
+        size_t hold = _rx_hold();
+        if (_rx_withheld < hold) {
+            size_t take = hold - _rx_withheld;
+            if (take > len) {
+                take = len;
+            }
+            _rx_withheld += take;
+            len -= take;
+        }
+        if (len && _pcb) {
+            tcp_recved(_pcb, len);
+        }
+    }
+
     void _consume(size_t size)
     {
         ptrdiff_t left = _rx_buf->len - _rx_buf_offset - size;
@@ -487,9 +958,7 @@ protected:
             _rx_buf_offset += size;
         } else if(!_rx_buf->next) {
             DEBUGV(":c0 %d, %d\r\n", size, _rx_buf->tot_len);
-            if(_pcb) {
-                tcp_recved(_pcb, _rx_buf->len);
-            }
+            _recved(_rx_buf->len);
             pbuf_free(_rx_buf);
             _rx_buf = 0;
             _rx_buf_offset = 0;
@@ -499,9 +968,7 @@ protected:
             _rx_buf = _rx_buf->next;
             _rx_buf_offset = 0;
             pbuf_ref(_rx_buf);
-            if(_pcb) {
-                tcp_recved(_pcb, head->len);
-            }
+            _recved(head->len);
             pbuf_free(head);
         }
     }
@@ -512,6 +979,10 @@ protected:
         (void) err;
         if(pb == 0) { // connection closed
             DEBUGV(":rcl\r\n");
+            if (_on_disconnect) {
+                _disconnect_pending = true;
+                _schedule_events();
+            }
             _notify_error();
             abort();
             return ERR_ABRT;
@@ -525,6 +996,9 @@ protected:
             _rx_buf = pb;
             _rx_buf_offset = 0;
         }
+        if (_on_data) {
+            _schedule_events();
+        }
         return ERR_OK;
     }
 
@@ -537,7 +1011,19 @@ protected:
         tcp_recv(_pcb, NULL);
         tcp_err(_pcb, NULL);
         _pcb = NULL;
+        bool hold = _refcnt > 0;
+        if (hold) {
+            ref();
+        }
+        _release_all();
+        if (_on_disconnect) {
+            _disconnect_pending = true;
+            _schedule_events();
+        }
         _notify_error();
+        if (hold) {
+            _unref_from_stack();
+        }
     }
 
     err_t _connected(struct tcp_pcb *pcb, err_t err)
@@ -552,7 +1038,12 @@ protected:
 
     err_t _poll(tcp_pcb*)
     {
+        _drain_async();
         _write_some_from_cb();
+        // callbacks that could not be scheduled before
+        if (_done_head && !_events_scheduled) {
+            _schedule_events();
+        }
         return ERR_OK;
     }
 
@@ -590,9 +1081,43 @@ private:
     discard_cb_t _discard_cb;
     void* _discard_cb_arg;
 
+    struct release_t {
+        uint32_t end;
+        std::function<void(bool)> released;
+        bool acked;
+        release_t* next;
+    };
+
     DataSource* _datasource = nullptr;
+    // _write_some() asks for one segment at a time
+    DataSourceBuffer _staging{TCP_MSS};
     size_t _written = 0;
-    size_t _write_chunk_size = 256;
+    size_t _min_write_chunk_size = 256;
+    uint8_t _write_flags = TCP_WRITE_FLAG_COPY;
+    // bytes handed to tcp_write() and acknowledged by the peer so far
+    uint32_t _snd_total = 0;
+    uint32_t _acked_total = 0;
+    // end of the last no-copy write, close() waits until it is acknowledged
+    uint32_t _nocopy_end = 0;
+    release_t* _release_head = nullptr;
+    release_t* _release_tail = nullptr;
+    // released, waiting for their callbacks to be dispatched
+    release_t* _done_head = nullptr;
+    release_t* _done_tail = nullptr;
+    data_cb_t _on_data;
+    disconnect_cb_t _on_disconnect;
+    ack_cb_t _on_ack;
+    size_t _acked_pending = 0;
+    size_t _rx_limit = 0;
+    // window held back for _rx_limit
+    size_t _rx_withheld = 0;
+    bool _events_scheduled = false;
+    bool _disconnect_pending = false;
+    // ring buffer behind write_async(), allocated on first use
+    uint8_t* _async_buf = nullptr;
+    size_t _async_capacity = TCP_SND_BUF;
+    size_t _async_head = 0;
+    size_t _async_len = 0;
     uint32_t _timeout_ms = 5000;
     uint32_t _op_start_time = 0;
     uint8_t _send_waiting = 0;
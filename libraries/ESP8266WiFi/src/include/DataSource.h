@@ -6,6 +6,7 @@
 #define DATASOURCE_H
 
 #include <assert.h>
+#include "IOVec.h"
 
 class DataSource {
 public:
@@ -49,11 +50,40 @@ protected:
     size_t _pos = 0;
 };
 
+// Staging memory for data sources that copy, kept by the owner from one
+// write to the next. It is at least minSize bytes, so that with minSize
+// set to the largest piece asked for it is only allocated once.
+class DataSourceBuffer {
+public:
+    DataSourceBuffer(size_t minSize = 0) :
+        _minSize(minSize)
+    {
+    }
+
+    uint8_t* get(size_t size)
+    {
+        if (_size < size) {
+            if (size < _minSize) {
+                size = _minSize;
+            }
+            _buffer.reset(new uint8_t[size]);
+            _size = _buffer ? size : 0;
+        }
+        return _buffer.get();
+    }
+
+protected:
+    std::unique_ptr<uint8_t[]> _buffer;
+    size_t _size = 0;
+    size_t _minSize;
+};
+
 template<typename TStream>
 class BufferedStreamDataSource : public DataSource {
 public:
-    BufferedStreamDataSource(TStream& stream, size_t size) :
+    BufferedStreamDataSource(TStream& stream, size_t size, DataSourceBuffer& buffer) :
         _stream(stream),
+        _buffer(buffer),
         _size(size)
     {
     }
@@ -66,14 +96,14 @@ public:
     const uint8_t* get_buffer(size_t size) override
     {
         assert(_pos + size <= _size);
-        if (_bufferSize < size) {
-            _buffer.reset(new uint8_t[size]);
-            _bufferSize = size;
+        uint8_t* buffer = _buffer.get(size);
+        if (!buffer) {
+            return nullptr;
         }
-        size_t cb = _stream.readBytes(reinterpret_cast<char*>(_buffer.get()), size);
+        size_t cb = _stream.readBytes(reinterpret_cast<char*>(buffer), size);
         assert(cb == size);
         (void) cb;
-        return _buffer.get();
+        return buffer;
     }
 
     void release_buffer(const uint8_t* buffer, size_t size) override
@@ -84,10 +114,87 @@ public:
 
 protected:
     TStream& _stream;
-    std::unique_ptr<uint8_t[]> _buffer;
+    DataSourceBuffer& _buffer;
     size_t _size;
     size_t _pos = 0;
-    size_t _bufferSize = 0;
+};
+
+// Serves the pieces of an IOVec array in order. A request that lies within
+// one piece is served in place, one spanning pieces is gathered into the
+// staging buffer.
+class IOVecDataSource : public DataSource {
+public:
+    IOVecDataSource(const IOVec* iov, size_t count, DataSourceBuffer& buffer) :
+        _iov(iov),
+        _count(count),
+        _buffer(buffer)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            _size += iov[i].len;
+        }
+    }
+
+    size_t available() override
+    {
+        return _size - _pos;
+    }
+
+    const uint8_t* get_buffer(size_t size) override
+    {
+        assert(_pos + size <= _size);
+        while (_index < _count && _offset == _iov[_index].len) {
+            ++_index;
+            _offset = 0;
+        }
+        const uint8_t* base = reinterpret_cast<const uint8_t*>(_iov[_index].base);
+        if (_iov[_index].len - _offset >= size) {
+            return base + _offset;
+        }
+        uint8_t* buffer = _buffer.get(size);
+        if (!buffer) {
+            return nullptr;
+        }
+        size_t index = _index;
+        size_t offset = _offset;
+        for (size_t copied = 0; copied < size; ) {
+            size_t n = _iov[index].len - offset;
+            if (n > size - copied) {
+                n = size - copied;
+            }
+            memcpy(buffer + copied, reinterpret_cast<const uint8_t*>(_iov[index].base) + offset, n);
+            copied += n;
+            ++index;
+            offset = 0;
+        }
+        return buffer;
+    }
+
+    void release_buffer(const uint8_t* buffer, size_t size) override
+    {
+        (void) buffer;
+        _pos += size;
+        while (size) {
+            size_t n = _iov[_index].len - _offset;
+            if (n > size) {
+                n = size;
+            }
+            _offset += n;
+            size -= n;
+            if (_offset == _iov[_index].len) {
+                ++_index;
+                _offset = 0;
+            }
+        }
+    }
+
+protected:
+    const IOVec* _iov;
+    size_t _count;
+    DataSourceBuffer& _buffer;
+    size_t _size = 0;
+    size_t _pos = 0;
+    size_t _index = 0;
+    size_t _offset = 0;
 };
 
 class ProgmemStream
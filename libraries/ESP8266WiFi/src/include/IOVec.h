@@ -0,0 +1,31 @@
+/*
+ IOVec.h - a piece of data for gather writes
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef IOVEC_H
+#define IOVEC_H
+
+#include <stddef.h>
+
+// WiFiClient::write(const IOVec*, size_t) and WiFiUDP::write(const IOVec*,
+// size_t) send an array of these as if the pieces were one buffer, e.g. a
+// header, a payload and a trailer kept in separate places.
+struct IOVec {
+    const void* base;
+    size_t len;
+};
+
+#endif //IOVEC_H
@@ -0,0 +1,105 @@
+/*
+ RTCRecord.h - data kept in RTC user memory across deep sleep
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef RTCRECORD_H
+#define RTCRECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <Arduino.h>
+
+inline uint32_t rtcCRC32(const void* data, size_t length)
+{
+    const uint8_t* p = (const uint8_t*) data;
+    uint32_t crc = 0xffffffff;
+    while(length--) {
+        crc ^= *p++;
+        for(int i = 0; i < 8; ++i) {
+            crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// A T stored in RTC user memory behind a CRC32, so that what a power-up
+// leaves there is not taken for data. offset is in 4 byte blocks, as
+// ESP.rtcUserMemoryRead takes it.
+template<typename T>
+class RTCRecord
+{
+public:
+    // number of 4 byte blocks taken
+    static const size_t blocks = (sizeof(uint32_t) + sizeof(T) + 3) / 4;
+
+    explicit RTCRecord(uint32_t offset = 0) : _offset(offset)
+    {
+    }
+
+    void setOffset(uint32_t offset)
+    {
+        _offset = offset;
+    }
+
+    uint32_t offset() const
+    {
+        return _offset;
+    }
+
+    // false if nothing valid is stored
+    bool read(T& data) const
+    {
+        Block block;
+        if(!ESP.rtcUserMemoryRead(_offset, (uint32_t*) &block, sizeof(block))) {
+            return false;
+        }
+        if(block.crc != rtcCRC32(&block.data, sizeof(block.data))) {
+            return false;
+        }
+        data = block.data;
+        return true;
+    }
+
+    bool write(const T& data)
+    {
+        Block block;
+        block.data = data;
+        block.crc = rtcCRC32(&block.data, sizeof(block.data));
+        return ESP.rtcUserMemoryWrite(_offset, (uint32_t*) &block, sizeof(block));
+    }
+
+    // only the CRC is written, made sure not to match
+    bool invalidate()
+    {
+        Block block;
+        if(!ESP.rtcUserMemoryRead(_offset, (uint32_t*) &block, sizeof(block))) {
+            return false;
+        }
+        uint32_t crc = ~rtcCRC32(&block.data, sizeof(block.data));
+        return ESP.rtcUserMemoryWrite(_offset, &crc, sizeof(crc));
+    }
+
+protected:
+    struct Block {
+        uint32_t crc;
+        T data;
+    };
+    static_assert(sizeof(Block) % 4 == 0, "RTC memory is written in 4 byte blocks");
+
+    uint32_t _offset;
+};
+
+#endif//RTCRECORD_H
@@ -0,0 +1,163 @@
+/*
+ ScanTable.h - compact table of WiFi scan results
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Lesser General Public
+ License as published by the Free Software Foundation; either
+ version 2.1 of the License, or (at your option) any later version.
+
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public
+ License along with this library; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+#ifndef SCANTABLE_H
+#define SCANTABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <new>
+
+// One network found by a scan, a third of the size of the SDK's bss_info
+struct WiFiScanEntry {
+    char ssid[33];
+    uint8_t bssid[6];
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t encryptionType;
+    bool isHidden;
+};
+
+// Scan results, filtered as they come in. Only networks at least minRSSI
+// strong and, if a set of SSIDs is given, with one of them are kept. With
+// maxResults, the strongest ones are kept, in a table allocated once and
+// reused by every scan; without, each scan gets a table just big enough.
+class ScanTable
+{
+public:
+    ScanTable() :
+        _entries(0), _count(0), _capacity(0),
+        _minRSSI(-128), _ssids(0), _ssidCount(0), _maxResults(0)
+    {
+    }
+
+    ~ScanTable()
+    {
+        delete[] _entries;
+    }
+
+    ScanTable(const ScanTable&) = delete;
+    ScanTable& operator=(const ScanTable&) = delete;
+
+    // ssids are kept by pointer, and must stay valid
+    void setFilter(int8_t minRSSI, const char* const* ssids, size_t ssidCount, size_t maxResults)
+    {
+        _minRSSI = minRSSI;
+        _ssids = ssids;
+        _ssidCount = ssids ? ssidCount : 0;
+        if(maxResults != _maxResults) {
+            _count = 0;
+            _release();
+            _maxResults = maxResults;
+        }
+    }
+
+    bool accepts(const char* ssid, int8_t rssi) const
+    {
+        if(rssi < _minRSSI) {
+            return false;
+        }
+        if(!_ssidCount) {
+            return true;
+        }
+        for(size_t i = 0; i < _ssidCount; ++i) {
+            if(strcmp(_ssids[i], ssid) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Start the results of a scan, of which count networks are accepted
+    bool begin(size_t count)
+    {
+        _count = 0;
+        size_t capacity = count;
+        if(_maxResults) {
+            capacity = _maxResults;
+        }
+        if(capacity > _capacity || (!_maxResults && capacity < _capacity)) {
+            _release();
+            if(capacity) {
+                _entries = new (std::nothrow) WiFiScanEntry[capacity];
+                if(!_entries) {
+                    return false;
+                }
+                _capacity = capacity;
+            }
+        }
+        return true;
+    }
+
+    // Add an accepted network; when the table is full, it takes the place
+    // of the weakest one if it is stronger
+    void add(const WiFiScanEntry& entry)
+    {
+        if(_count < _capacity) {
+            _entries[_count++] = entry;
+            return;
+        }
+        size_t weakest = 0;
+        for(size_t i = 1; i < _count; ++i) {
+            if(_entries[i].rssi < _entries[weakest].rssi) {
+                weakest = i;
+            }
+        }
+        if(_count && entry.rssi > _entries[weakest].rssi) {
+            _entries[weakest] = entry;
+        }
+    }
+
+    // Drop the results; the memory is kept if maxResults is set
+    void clear()
+    {
+        _count = 0;
+        if(!_maxResults) {
+            _release();
+        }
+    }
+
+    size_t size() const
+    {
+        return _count;
+    }
+
+    const WiFiScanEntry* get(size_t i) const
+    {
+        return (i < _count) ? &_entries[i] : 0;
+    }
+
+protected:
+    void _release()
+    {
+        delete[] _entries;
+        _entries = 0;
+        _capacity = 0;
+    }
+
+    WiFiScanEntry* _entries;
+    size_t _count;
+    size_t _capacity;
+
+    int8_t _minRSSI;
+    const char* const* _ssids;
+    size_t _ssidCount;
+    size_t _maxResults;
+};
+
+#endif//SCANTABLE_H
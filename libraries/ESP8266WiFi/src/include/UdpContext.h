@@ -30,6 +30,11 @@ void esp_schedule();
 }
 
 
+// Most received datagrams queued before further ones are dropped
+#ifndef UDP_RX_QUEUE_LEN
+#define UDP_RX_QUEUE_LEN 8
+#endif
+
 #define GET_IP_HDR(pb) reinterpret_cast<ip_hdr*>(((uint8_t*)((pb)->payload)) - UDP_HLEN - IP_HLEN);
 #define GET_UDP_HDR(pb) reinterpret_cast<udp_hdr*>(((uint8_t*)((pb)->payload)) - UDP_HLEN);
 
@@ -38,12 +43,18 @@ class UdpContext
 public:
 
     typedef std::function<void(void)> rxhandler_t;
+    typedef std::function<void(const uint8_t* data, size_t len, uint32_t addr, uint16_t port)> batchhandler_t;
 
     UdpContext()
     : _pcb(0)
     , _rx_buf(0)
-    , _first_buf_taken(false)
     , _rx_buf_offset(0)
+    , _rx_src_addr(0)
+    , _rx_dst_addr(0)
+    , _rx_src_port(0)
+    , _rx_queue_head(0)
+    , _rx_queue_count(0)
+    , _rx_dropped(0)
     , _refcnt(0)
     , _tx_buf_head(0)
     , _tx_buf_cur(0)
@@ -72,6 +83,11 @@ public:
             _rx_buf = 0;
             _rx_buf_offset = 0;
         }
+        rxpacket_t packet;
+        while (_pop(packet))
+        {
+            pbuf_free(packet.pb);
+        }
     }
 
     void ref()
@@ -148,8 +164,7 @@ public:
         if (!_rx_buf)
             return 0;
 
-        ip_hdr* iphdr = GET_IP_HDR(_rx_buf);
-        return iphdr->src.addr;
+        return _rx_src_addr;
     }
 
     uint16_t getRemotePort()
@@ -157,8 +172,7 @@ public:
         if (!_rx_buf)
             return 0;
 
-        udp_hdr* udphdr = GET_UDP_HDR(_rx_buf);
-        return ntohs(udphdr->src);
+        return _rx_src_port;
     }
 
     uint32_t getDestAddress()
@@ -166,8 +180,7 @@ public:
         if (!_rx_buf)
             return 0;
 
-        ip_hdr* iphdr = GET_IP_HDR(_rx_buf);
-        return iphdr->dest.addr;
+        return _rx_dst_addr;
     }
 
     uint16_t getLocalPort()
@@ -178,27 +191,52 @@ public:
         return _pcb->local_port;
     }
 
+    // Drop the current datagram and make the next queued one current
     bool next()
     {
-        if (!_rx_buf)
-            return false;
-
-        if (!_first_buf_taken)
+        if (_rx_buf)
         {
-            _first_buf_taken = true;
-            return true;
+            pbuf_free(_rx_buf);
+            _rx_buf = 0;
         }
-
-        auto head = _rx_buf;
-        _rx_buf = _rx_buf->next;
         _rx_buf_offset = 0;
 
-        if (_rx_buf)
+        rxpacket_t packet;
+        if (!_pop(packet))
+            return false;
+
+        _rx_buf = packet.pb;
+        _rx_src_addr = packet.src_addr;
+        _rx_dst_addr = packet.dst_addr;
+        _rx_src_port = packet.src_port;
+        return true;
+    }
+
+    // Hand up to max queued datagrams to handler and drop them, leaving
+    // the current one alone. The data is only valid during the call.
+    size_t recv_batch(batchhandler_t handler, size_t max)
+    {
+        size_t count = 0;
+        rxpacket_t packet;
+        while (count < max && _pop(packet))
         {
-            pbuf_ref(_rx_buf);
+            handler(reinterpret_cast<const uint8_t*>(packet.pb->payload), packet.pb->len,
+                    packet.src_addr, packet.src_port);
+            pbuf_free(packet.pb);
+            ++count;
         }
-        pbuf_free(head);
-        return _rx_buf != 0;
+        return count;
+    }
+
+    size_t getRxQueued() const
+    {
+        return _rx_queue_count;
+    }
+
+    // Datagrams dropped because the queue was full or out of memory
+    size_t getRxDropped() const
+    {
+        return _rx_dropped;
     }
 
     int read()
@@ -275,24 +313,68 @@ public:
         return size;
     }
 
+    // Append all pieces, growing the packet buffer once for all of them
+    size_t append(const IOVec* iov, size_t count)
+    {
+        size_t size = 0;
+        for (size_t i = 0; i < count; ++i) {
+            size += iov[i].len;
+        }
+        if (!_tx_buf_head || _tx_buf_head->tot_len < _tx_buf_offset + size)
+        {
+            _reserve(_tx_buf_offset + size);
+        }
+        if (!_tx_buf_head || _tx_buf_head->tot_len < _tx_buf_offset + size)
+        {
+            DEBUGV("failed _reserve");
+            return 0;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            append(reinterpret_cast<const char*>(iov[i].base), iov[i].len);
+        }
+        return size;
+    }
+
+    // Make room for a packet of size bytes up front, so it is built in
+    // a single pbuf which send() passes to lwIP without copying it
+    bool reserve(size_t size)
+    {
+        if (!_tx_buf_head || _tx_buf_head->tot_len < size)
+        {
+            _reserve(size);
+        }
+        return _tx_buf_head && _tx_buf_head->tot_len >= size;
+    }
+
     bool send(ip_addr_t* addr = 0, uint16_t port = 0)
     {
         size_t data_size = _tx_buf_offset;
-        pbuf* tx_copy = pbuf_alloc(PBUF_TRANSPORT, data_size, PBUF_RAM);
-        if(!tx_copy){
-            DEBUGV("failed pbuf_alloc");
+        pbuf* tx_copy;
+        if (_tx_buf_head && !_tx_buf_head->next)
+        {
+            // the packet is in one pbuf already: trim and send it as is
+            tx_copy = _tx_buf_head;
+            pbuf_realloc(tx_copy, data_size);
         }
-        else{
-            uint8_t* dst = reinterpret_cast<uint8_t*>(tx_copy->payload);
-            for (pbuf* p = _tx_buf_head; p; p = p->next) {
-                size_t will_copy = (data_size < p->len) ? data_size : p->len;
-                memcpy(dst, p->payload, will_copy);
-                dst += will_copy;
-                data_size -= will_copy;
+        else
+        {
+            // the wifi driver wants the datagram in one piece
+            tx_copy = pbuf_alloc(PBUF_TRANSPORT, data_size, PBUF_RAM);
+            if(!tx_copy){
+                DEBUGV("failed pbuf_alloc");
             }
+            else{
+                uint8_t* dst = reinterpret_cast<uint8_t*>(tx_copy->payload);
+                for (pbuf* p = _tx_buf_head; p; p = p->next) {
+                    size_t will_copy = (data_size < p->len) ? data_size : p->len;
+                    memcpy(dst, p->payload, will_copy);
+                    dst += will_copy;
+                    data_size -= will_copy;
+                }
+            }
+            if (_tx_buf_head)
+                pbuf_free(_tx_buf_head);
         }
-        if (_tx_buf_head)
-            pbuf_free(_tx_buf_head);
         _tx_buf_head = 0;
         _tx_buf_cur = 0;
         _tx_buf_offset = 0;
@@ -324,12 +406,22 @@ public:
 
 private:
 
+    struct rxpacket_t
+    {
+        pbuf* pb;
+        uint32_t src_addr;
+        uint32_t dst_addr;
+        uint16_t src_port;
+    };
+
     void _reserve(size_t size)
     {
         const size_t pbuf_unit_size = 128;
         if (!_tx_buf_head)
         {
-            _tx_buf_head = pbuf_alloc(PBUF_TRANSPORT, pbuf_unit_size, PBUF_RAM);
+            // a packet whose size is known up front gets a single pbuf
+            size_t first_size = (size > pbuf_unit_size) ? size : pbuf_unit_size;
+            _tx_buf_head = pbuf_alloc(PBUF_TRANSPORT, first_size, PBUF_RAM);
             if (!_tx_buf_head)
             {
                 return;
@@ -363,26 +455,56 @@ private:
         _rx_buf_offset += size;
     }
 
+    bool _pop(rxpacket_t& packet)
+    {
+        if (!_rx_queue_count)
+            return false;
+
+        packet = _rx_queue[_rx_queue_head];
+        _rx_queue_head = (_rx_queue_head + 1) % UDP_RX_QUEUE_LEN;
+        --_rx_queue_count;
+        return true;
+    }
+
     void _recv(udp_pcb *upcb, pbuf *pb,
             const ip_addr_t *addr, u16_t port)
     {
         (void) upcb;
-        (void) addr;
-        (void) port;
-        if (_rx_buf)
+        if (_rx_queue_count == UDP_RX_QUEUE_LEN)
         {
-            // there is some unread data
-            // chain the new pbuf to the existing one
-            DEBUGV(":urch %d, %d\r\n", _rx_buf->tot_len, pb->tot_len);
-            pbuf_cat(_rx_buf, pb);
+            DEBUGV(":urfull %d\r\n", pb->tot_len);
+            ++_rx_dropped;
+            pbuf_free(pb);
+            return;
         }
-        else
+
+        rxpacket_t packet;
+        packet.pb = pb;
+        packet.src_addr = addr->addr;
+        packet.src_port = port;
+        // the IP header is still in front of the payload at this point
+        ip_hdr* iphdr = GET_IP_HDR(pb);
+        packet.dst_addr = iphdr->dest.addr;
+
+        if (pb->next)
         {
-            DEBUGV(":urn %d\r\n", pb->tot_len);
-            _first_buf_taken = false;
-            _rx_buf = pb;
-            _rx_buf_offset = 0;
+            // keep every datagram in one piece, so it can be read in place
+            packet.pb = pbuf_alloc(PBUF_RAW, pb->tot_len, PBUF_RAM);
+            if (packet.pb)
+            {
+                pbuf_copy_partial(pb, packet.pb->payload, pb->tot_len, 0);
+            }
+            pbuf_free(pb);
+            if (!packet.pb)
+            {
+                ++_rx_dropped;
+                return;
+            }
         }
+
+        DEBUGV(":urn %d, %d\r\n", packet.pb->tot_len, _rx_queue_count);
+        _rx_queue[(_rx_queue_head + _rx_queue_count) % UDP_RX_QUEUE_LEN] = packet;
+        ++_rx_queue_count;
         if (_on_rx) {
             _on_rx();
         }
@@ -405,8 +527,14 @@ private:
 private:
     udp_pcb* _pcb;
     pbuf* _rx_buf;
-    bool _first_buf_taken;
     size_t _rx_buf_offset;
+    uint32_t _rx_src_addr;
+    uint32_t _rx_dst_addr;
+    uint16_t _rx_src_port;
+    rxpacket_t _rx_queue[UDP_RX_QUEUE_LEN];
+    size_t _rx_queue_head;
+    size_t _rx_queue_count;
+    size_t _rx_dropped;
     int _refcnt;
     pbuf* _tx_buf_head;
     pbuf* _tx_buf_cur;
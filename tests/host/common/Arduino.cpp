@@ -19,13 +19,22 @@
 #include "Arduino.h"
 
 
-extern "C" unsigned long millis()
+static unsigned long s_epochMillis()
 {
     timeval time;
     gettimeofday(&time, NULL);
     return (time.tv_sec * 1000) + (time.tv_usec / 1000);
 }
 
+static const unsigned long s_startMillis = s_epochMillis();
+
+// counts from program start like on the device, so the value fits the
+// uint32_t timestamps the libraries keep
+extern "C" unsigned long millis()
+{
+    return s_epochMillis() - s_startMillis;
+}
+
 
 extern "C" void yield()
 {
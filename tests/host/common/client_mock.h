@@ -0,0 +1,117 @@
+/*
+ client_mock.h - in-memory Client for host tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef client_mock_h
+#define client_mock_h
+
+#include <string>
+#include <stdlib.h>
+#include <Client.h>
+
+// Serves a fixed input to the reader, making at most `segment` bytes
+// available at a time (0 = everything), like a TCP connection receiving
+// segments. When `randomSegments` is set, each segment gets a random size in
+// [1, segment]. Everything written to the client is kept in `output`.
+class ClientMock : public Client {
+public:
+    ClientMock(const std::string& input, size_t segment = 0, bool randomSegments = false)
+    : input(input), segment(segment), randomSegments(randomSegments)
+    {
+        _timeout = 0;
+    }
+
+    int connect(IPAddress ip, uint16_t port) override { (void) ip; (void) port; return 0; }
+    int connect(const char *host, uint16_t port) override { (void) host; (void) port; return 0; }
+
+    size_t write(uint8_t c) override
+    {
+        output += (char) c;
+        return 1;
+    }
+
+    size_t write(const uint8_t *buf, size_t size) override
+    {
+        output.append((const char*) buf, size);
+        ++writes;
+        return size;
+    }
+
+    int available() override
+    {
+        if (!_avail && pos < input.size()) {
+            size_t left = input.size() - pos;
+            size_t n = segment ? segment : left;
+            if (randomSegments && segment) {
+                n = 1 + rand() % segment;
+            }
+            _avail = (n < left) ? n : left;
+        }
+        return _avail;
+    }
+
+    int read() override
+    {
+        if (!available()) {
+            return -1;
+        }
+        --_avail;
+        return (uint8_t) input[pos++];
+    }
+
+    int read(uint8_t *buf, size_t size) override
+    {
+        size_t n = available();
+        if (n > size) {
+            n = size;
+        }
+        memcpy(buf, input.data() + pos, n);
+        pos += n;
+        _avail -= n;
+        ++reads;
+        return n;
+    }
+
+    int peek() override
+    {
+        return available() ? (uint8_t) input[pos] : -1;
+    }
+
+    size_t peekBytes(uint8_t *buf, size_t size)
+    {
+        size_t n = available();
+        if (n > size) {
+            n = size;
+        }
+        memcpy(buf, input.data() + pos, n);
+        return n;
+    }
+
+    void flush() override { }
+    void stop() override { pos = input.size(); _avail = 0; }
+    uint8_t connected() override { return pos < input.size(); }
+    operator bool() override { return true; }
+
+    std::string input;
+    std::string output;
+    size_t segment;
+    bool randomSegments;
+    size_t pos = 0;
+    size_t reads = 0;
+    size_t writes = 0;
+
+protected:
+    size_t _avail = 0;
+};
+
+#endif//client_mock_h
@@ -0,0 +1,364 @@
+/*
+ lwip_stub.cpp - minimal lwIP TCP stand-in for host tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <stdlib.h>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include "lwip_stub.h"
+
+static std::vector<tcp_pcb*> s_pcbs;
+tcp_pcb* lwip_stub_closed_pcb = nullptr;
+bool lwip_stub_closed_by_abort = false;
+udp_pcb* lwip_stub_udp_pcb = nullptr;
+
+tcp_pcb* lwip_stub_pcb_new()
+{
+    tcp_pcb* pcb = new tcp_pcb();
+    pcb->state = ESTABLISHED;
+    pcb->mss = TCP_MSS;
+    pcb->snd_buf = TCP_SND_BUF;
+    pcb->auto_ack = true;
+    pcb->queue.reserve(TCP_SND_QUEUELEN);
+    pcb->copies.reserve(1 << 20);
+    pcb->received.reserve(1 << 20);
+    s_pcbs.reserve(16);
+    s_pcbs.push_back(pcb);
+    return pcb;
+}
+
+void lwip_stub_pcb_free(tcp_pcb* pcb)
+{
+    s_pcbs.erase(std::remove(s_pcbs.begin(), s_pcbs.end(), pcb), s_pcbs.end());
+    if (lwip_stub_closed_pcb == pcb) {
+        lwip_stub_closed_pcb = nullptr;
+    }
+    delete pcb;
+}
+
+void lwip_stub_ack(tcp_pcb* pcb, size_t len)
+{
+    if (len > pcb->unacked) {
+        len = pcb->unacked;
+    }
+    size_t acked = len;
+    while (len) {
+        tcp_pcb::queued_t& q = pcb->queue.front();
+        size_t n = std::min(len, q.len);
+        // referenced data is read now, as a retransmission would
+        if (q.data) {
+            pcb->received.append((const char*) q.data, n);
+            q.data += n;
+        } else {
+            pcb->received.append(pcb->copies, q.offset, n);
+            q.offset += n;
+        }
+        q.len -= n;
+        len -= n;
+        if (!q.len) {
+            pcb->queue.erase(pcb->queue.begin());
+            --pcb->snd_queuelen;
+        }
+    }
+    pcb->unacked -= acked;
+    pcb->snd_buf += acked;
+    if (acked && pcb->sent) {
+        pcb->sent(pcb->callback_arg, pcb, acked);
+    }
+}
+
+err_t lwip_stub_receive(tcp_pcb* pcb, pbuf* p)
+{
+    return pcb->recv(pcb->callback_arg, pcb, p, ERR_OK);
+}
+
+err_t lwip_stub_remote_close(tcp_pcb* pcb)
+{
+    pcb->state = CLOSE_WAIT;
+    return pcb->recv(pcb->callback_arg, pcb, nullptr, ERR_OK);
+}
+
+void lwip_stub_error(tcp_pcb* pcb, err_t err)
+{
+    // lwIP frees the pcb before reporting the error
+    s_pcbs.erase(std::remove(s_pcbs.begin(), s_pcbs.end(), pcb), s_pcbs.end());
+    pcb->state = CLOSED;
+    pcb->errf(pcb->callback_arg, err);
+}
+
+tcp_pcb* lwip_stub_accept(tcp_accept_fn accept, void* arg)
+{
+    tcp_pcb* pcb = lwip_stub_pcb_new();
+    err_t err = accept(arg, pcb, ERR_OK);
+    if (err != ERR_OK && err != ERR_ABRT) {
+        tcp_abort(pcb);
+    }
+    return pcb;
+}
+
+extern "C" void esp_yield()
+{
+    for (size_t i = 0; i < s_pcbs.size(); ++i) {
+        if (s_pcbs[i]->auto_ack) {
+            lwip_stub_ack(s_pcbs[i], s_pcbs[i]->unacked);
+        }
+    }
+}
+
+extern "C" void esp_schedule()
+{
+}
+
+void tcp_setprio(tcp_pcb*, uint8_t)
+{
+}
+
+void tcp_arg(tcp_pcb* pcb, void* arg)
+{
+    pcb->callback_arg = arg;
+}
+
+void tcp_recv(tcp_pcb* pcb, tcp_recv_fn recv)
+{
+    pcb->recv = recv;
+}
+
+void tcp_sent(tcp_pcb* pcb, tcp_sent_fn sent)
+{
+    pcb->sent = sent;
+}
+
+void tcp_err(tcp_pcb* pcb, tcp_err_fn err)
+{
+    pcb->errf = err;
+}
+
+void tcp_poll(tcp_pcb* pcb, tcp_poll_fn poll, uint8_t)
+{
+    pcb->poll = poll;
+}
+
+void tcp_abort(tcp_pcb* pcb)
+{
+    // queued segments are dropped; a pcb is not freed, so tests can look at it
+    pcb->queue.clear();
+    pcb->state = CLOSED;
+    s_pcbs.erase(std::remove(s_pcbs.begin(), s_pcbs.end(), pcb), s_pcbs.end());
+    lwip_stub_closed_pcb = pcb;
+    lwip_stub_closed_by_abort = true;
+}
+
+err_t tcp_close(tcp_pcb* pcb)
+{
+    pcb->state = FIN_WAIT_1;
+    s_pcbs.erase(std::remove(s_pcbs.begin(), s_pcbs.end(), pcb), s_pcbs.end());
+    lwip_stub_closed_pcb = pcb;
+    lwip_stub_closed_by_abort = false;
+    return ERR_OK;
+}
+
+err_t tcp_connect(tcp_pcb*, ip_addr_t*, uint16_t, tcp_connected_fn)
+{
+    return ERR_CONN;
+}
+
+void tcp_recved(tcp_pcb* pcb, uint16_t len)
+{
+    pcb->recved += len;
+    ++pcb->recved_calls;
+}
+
+err_t tcp_write(tcp_pcb* pcb, const void* dataptr, uint16_t len, uint8_t apiflags)
+{
+    if (len > pcb->snd_buf || pcb->snd_queuelen >= TCP_SND_QUEUELEN) {
+        return ERR_MEM;
+    }
+    tcp_pcb::queued_t q;
+    q.len = len;
+    if (apiflags & TCP_WRITE_FLAG_COPY) {
+        q.data = nullptr;
+        q.offset = pcb->copies.size();
+        pcb->copies.append((const char*) dataptr, len);
+        pcb->copied += len;
+    } else {
+        q.data = (const uint8_t*) dataptr;
+        q.offset = 0;
+        pcb->referenced += len;
+    }
+    pcb->queue.push_back(q);
+    ++pcb->snd_queuelen;
+    ++pcb->writes;
+    pcb->snd_buf -= len;
+    pcb->unsent += len;
+    return ERR_OK;
+}
+
+err_t tcp_output(tcp_pcb* pcb)
+{
+    pcb->segments += (pcb->unsent + pcb->mss - 1) / pcb->mss;
+    pcb->unacked += pcb->unsent;
+    pcb->unsent = 0;
+    return ERR_OK;
+}
+
+udp_pcb* udp_new()
+{
+    udp_pcb* pcb = new udp_pcb();
+    pcb->ttl = 255;
+    pcb->sent.reserve(1 << 16);
+    lwip_stub_udp_pcb = pcb;
+    return pcb;
+}
+
+void udp_remove(udp_pcb* pcb)
+{
+    if (lwip_stub_udp_pcb == pcb) {
+        lwip_stub_udp_pcb = nullptr;
+    }
+    delete pcb;
+}
+
+void udp_recv(udp_pcb* pcb, udp_recv_fn recv, void* arg)
+{
+    pcb->recv = recv;
+    pcb->recv_arg = arg;
+}
+
+err_t udp_bind(udp_pcb* pcb, ip_addr_t* addr, u16_t port)
+{
+    pcb->local_ip = *addr;
+    pcb->local_port = port;
+    return ERR_OK;
+}
+
+void udp_disconnect(udp_pcb* pcb)
+{
+    pcb->remote_ip.addr = 0;
+    pcb->remote_port = 0;
+}
+
+err_t udp_sendto(udp_pcb* pcb, pbuf* p, ip_addr_t*, u16_t)
+{
+    ++pcb->datagrams;
+    if (p->next) {
+        ++pcb->chained;
+    }
+    for (size_t left = p->tot_len; left; p = p->next) {
+        size_t n = std::min<size_t>(left, p->len);
+        pcb->sent.append((const char*) p->payload, n);
+        left -= n;
+    }
+    return ERR_OK;
+}
+
+void udp_set_multicast_netif_addr(udp_pcb*, ip_addr_t)
+{
+}
+
+void udp_set_multicast_ttl(udp_pcb* pcb, int ttl)
+{
+    pcb->ttl = ttl;
+}
+
+pbuf* lwip_stub_udp_datagram(const void* data, size_t len, uint32_t dst)
+{
+    pbuf* p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+    memcpy(p->payload, data, len);
+    ip_hdr* iphdr = (ip_hdr*) ((uint8_t*) p->payload - UDP_HLEN - IP_HLEN);
+    iphdr->dest.addr = dst;
+    return p;
+}
+
+void lwip_stub_udp_receive(udp_pcb* pcb, pbuf* p, uint32_t src, uint16_t port)
+{
+    ip_addr_t addr = { src };
+    pcb->recv(pcb->recv_arg, pcb, p, &addr, port);
+}
+
+pbuf* pbuf_alloc(pbuf_layer layer, uint16_t len, pbuf_type)
+{
+    // one block for the pbuf, room for headers and the payload, like a
+    // PBUF_RAM
+    size_t headers = (layer == PBUF_TRANSPORT) ? UDP_HLEN + IP_HLEN : 0;
+    pbuf* p = (pbuf*) malloc(sizeof(pbuf) + headers + len);
+    if (!p) {
+        return nullptr;
+    }
+    new (p) pbuf();
+    p->payload = (uint8_t*) (p + 1) + headers;
+    p->tot_len = p->len = len;
+    p->ref = 1;
+    return p;
+}
+
+void pbuf_realloc(pbuf* p, uint16_t len)
+{
+    // shrink only, as lwIP does; pbufs past the new end are released
+    size_t left = len;
+    while (left > p->len) {
+        left -= p->len;
+        p->tot_len = left + p->len;
+        p = p->next;
+    }
+    p->len = p->tot_len = left;
+    if (p->next) {
+        pbuf_free(p->next);
+        p->next = nullptr;
+    }
+}
+
+uint16_t pbuf_copy_partial(pbuf* p, void* dataptr, uint16_t len, uint16_t offset)
+{
+    uint16_t copied = 0;
+    for (; p && copied < len; p = p->next) {
+        if (offset >= p->len) {
+            offset -= p->len;
+            continue;
+        }
+        uint16_t n = std::min<uint16_t>(p->len - offset, len - copied);
+        memcpy((uint8_t*) dataptr + copied, (uint8_t*) p->payload + offset, n);
+        copied += n;
+        offset = 0;
+    }
+    return copied;
+}
+
+uint8_t pbuf_free(pbuf* p)
+{
+    uint8_t count = 0;
+    while (p && p->ref && --p->ref == 0) {
+        pbuf* next = p->next;
+        free(p);
+        ++count;
+        p = next;
+    }
+    return count;
+}
+
+void pbuf_ref(pbuf* p)
+{
+    if (p->ref) {
+        ++p->ref;
+    }
+}
+
+void pbuf_cat(pbuf* head, pbuf* tail)
+{
+    pbuf* p = head;
+    for (; p->next; p = p->next) {
+        p->tot_len += tail->tot_len;
+    }
+    p->tot_len += tail->tot_len;
+    p->next = tail;
+}
@@ -0,0 +1,251 @@
+/*
+ lwip_stub.h - minimal lwIP TCP stand-in for host tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef lwip_stub_h
+#define lwip_stub_h
+
+// Provides just enough of the lwIP raw TCP and UDP API for ClientContext.h
+// and UdpContext.h to build
+// on the host. Instead of sending anything, a pcb records what it is given:
+// how many bytes were copied and how many queued by reference, how many
+// segments tcp_output() would have produced, and the byte stream the peer
+// receives. Queued data is only read when it is acknowledged, so data
+// released too early shows up as corrupted output. Once a pcb is set up the
+// stub does not allocate, so tests can count the allocations of the code
+// under test.
+
+#include <stdint.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef DEBUGV
+#define DEBUGV(...)
+#endif
+#define os_memcpy memcpy
+
+typedef int8_t err_t;
+#define ERR_OK    0
+#define ERR_MEM  -1
+#define ERR_ABRT -10
+#define ERR_CONN -13
+
+enum tcp_state {
+    CLOSED = 0,
+    LISTEN,
+    SYN_SENT,
+    SYN_RCVD,
+    ESTABLISHED,
+    FIN_WAIT_1,
+    FIN_WAIT_2,
+    CLOSE_WAIT,
+    CLOSING,
+    LAST_ACK,
+    TIME_WAIT
+};
+
+struct ip_addr {
+    uint32_t addr;
+};
+typedef struct ip_addr ip_addr_t;
+
+// A pbuf with ref 0 belongs to the test and is never freed by the stub;
+// pbuf_alloc() returns counted ones
+struct pbuf {
+    struct pbuf* next = nullptr;
+    void* payload = nullptr;
+    uint16_t tot_len = 0;
+    uint16_t len = 0;
+    uint16_t ref = 0;
+};
+
+typedef enum {
+    PBUF_TRANSPORT,
+    PBUF_IP,
+    PBUF_LINK,
+    PBUF_RAW
+} pbuf_layer;
+
+typedef enum {
+    PBUF_RAM,
+    PBUF_ROM,
+    PBUF_REF,
+    PBUF_POOL
+} pbuf_type;
+
+struct tcp_pcb;
+typedef err_t (*tcp_recv_fn)(void* arg, tcp_pcb* pcb, pbuf* p, err_t err);
+typedef err_t (*tcp_sent_fn)(void* arg, tcp_pcb* pcb, uint16_t len);
+typedef err_t (*tcp_poll_fn)(void* arg, tcp_pcb* pcb);
+typedef err_t (*tcp_connected_fn)(void* arg, tcp_pcb* pcb, err_t err);
+typedef err_t (*tcp_accept_fn)(void* arg, tcp_pcb* newpcb, err_t err);
+typedef void (*tcp_err_fn)(void* arg, err_t err);
+
+#define TCP_PRIO_MIN 1
+#define TF_NODELAY 0x40
+#define SOF_KEEPALIVE 0x08
+#define TCP_MSS 1460
+#define TCP_SND_BUF (2 * TCP_MSS)
+#define TCP_WND (4 * TCP_MSS)
+#define TCP_SND_QUEUELEN ((4 * (TCP_SND_BUF) + (TCP_MSS - 1)) / (TCP_MSS))
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+#ifndef TCP_DEFAULT_KEEPALIVE_IDLE_SEC
+#define TCP_DEFAULT_KEEPALIVE_IDLE_SEC     7200
+#define TCP_DEFAULT_KEEPALIVE_INTERVAL_SEC 75
+#define TCP_DEFAULT_KEEPALIVE_COUNT        9
+#endif
+
+struct tcp_pcb {
+    ip_addr_t local_ip;
+    ip_addr_t remote_ip;
+    uint16_t local_port;
+    uint16_t remote_port;
+    uint8_t so_options;
+    uint32_t keep_idle;
+    uint32_t keep_intvl;
+    uint8_t keep_cnt;
+    enum tcp_state state;
+    uint8_t flags;
+    uint16_t mss;
+    uint16_t snd_buf;
+    uint16_t snd_queuelen;
+
+    // callbacks registered by the user of the pcb
+    void* callback_arg;
+    tcp_recv_fn recv;
+    tcp_sent_fn sent;
+    tcp_err_fn errf;
+    tcp_poll_fn poll;
+
+    // bookkeeping of the stub
+    struct queued_t {
+        const uint8_t* data;   // referenced data, or null if copied
+        size_t offset;         // position of copied data in copies
+        size_t len;
+    };
+    std::vector<queued_t> queue;
+    std::string copies;
+    size_t unsent;             // queued bytes not yet passed to tcp_output
+    size_t unacked;            // bytes output and not yet acknowledged
+    bool auto_ack;             // acknowledge everything on esp_yield()
+    size_t writes;             // tcp_write() calls
+    size_t copied;             // bytes copied by tcp_write()
+    size_t referenced;         // bytes queued by reference
+    size_t segments;           // segments tcp_output() would have sent
+    size_t recved;             // bytes the window was opened for
+    size_t recved_calls;       // tcp_recved() calls
+    std::string received;      // what the peer got, in order
+};
+
+typedef uint16_t u16_t;
+#define UDP_HLEN 8
+#define IP_HLEN 20
+#define ip_addr_copy(dest, src) ((dest).addr = (src).addr)
+#define ntohs(x) ((uint16_t) ((((x) & 0xff) << 8) | (((x) & 0xff00) >> 8)))
+
+struct ip_hdr {
+    uint8_t fields[12];
+    ip_addr_t src;
+    ip_addr_t dest;
+};
+
+struct udp_hdr {
+    uint16_t src;
+    uint16_t dest;
+    uint16_t len;
+    uint16_t chksum;
+};
+
+struct udp_pcb;
+typedef void (*udp_recv_fn)(void* arg, udp_pcb* pcb, pbuf* p, ip_addr_t* addr, u16_t port);
+
+struct udp_pcb {
+    ip_addr_t local_ip;
+    ip_addr_t remote_ip;
+    uint16_t local_port;
+    uint16_t remote_port;
+    uint8_t ttl;
+    udp_recv_fn recv;
+    void* recv_arg;
+
+    // bookkeeping of the stub
+    size_t datagrams;          // udp_sendto() calls
+    size_t chained;            // datagrams passed as more than one pbuf
+    std::string sent;          // payloads of all datagrams, in order
+};
+
+#define tcp_mss(pcb)             ((pcb)->mss)
+#define tcp_sndbuf(pcb)          ((pcb)->snd_buf)
+#define tcp_nagle_disable(pcb)   ((pcb)->flags |= TF_NODELAY)
+#define tcp_nagle_enable(pcb)    ((pcb)->flags &= ~TF_NODELAY)
+#define tcp_nagle_disabled(pcb)  (((pcb)->flags & TF_NODELAY) != 0)
+
+// An established connection, registered for esp_yield() to acknowledge
+tcp_pcb* lwip_stub_pcb_new();
+// Release a pcb that lwIP would have freed (after close or abort)
+void lwip_stub_pcb_free(tcp_pcb* pcb);
+// Acknowledge len bytes of output data, as the peer would
+void lwip_stub_ack(tcp_pcb* pcb, size_t len);
+// Deliver what the peer sent: p (owned by the caller, pbuf_free() does not
+// release it), an orderly close or a connection error, as lwIP would
+err_t lwip_stub_receive(tcp_pcb* pcb, pbuf* p);
+err_t lwip_stub_remote_close(tcp_pcb* pcb);
+void lwip_stub_error(tcp_pcb* pcb, err_t err);
+// A connection completing its handshake with a listening pcb: a new pcb is
+// passed to accept and reset if that fails. The caller frees the pcb.
+tcp_pcb* lwip_stub_accept(tcp_accept_fn accept, void* arg);
+// A received datagram for dst, with room for the headers in front of it,
+// and its delivery from src:port to a listening pcb, which takes p over
+pbuf* lwip_stub_udp_datagram(const void* data, size_t len, uint32_t dst);
+void lwip_stub_udp_receive(udp_pcb* pcb, pbuf* p, uint32_t src, uint16_t port);
+// The last UDP pcb udp_new() returned
+extern udp_pcb* lwip_stub_udp_pcb;
+// The last pcb freed by tcp_close() or tcp_abort(), and how
+extern tcp_pcb* lwip_stub_closed_pcb;
+extern bool lwip_stub_closed_by_abort;
+
+void tcp_setprio(tcp_pcb* pcb, uint8_t prio);
+void tcp_arg(tcp_pcb* pcb, void* arg);
+void tcp_recv(tcp_pcb* pcb, tcp_recv_fn recv);
+void tcp_sent(tcp_pcb* pcb, tcp_sent_fn sent);
+void tcp_err(tcp_pcb* pcb, tcp_err_fn err);
+void tcp_poll(tcp_pcb* pcb, tcp_poll_fn poll, uint8_t interval);
+void tcp_abort(tcp_pcb* pcb);
+err_t tcp_close(tcp_pcb* pcb);
+err_t tcp_connect(tcp_pcb* pcb, ip_addr_t* ipaddr, uint16_t port, tcp_connected_fn connected);
+void tcp_recved(tcp_pcb* pcb, uint16_t len);
+err_t tcp_write(tcp_pcb* pcb, const void* dataptr, uint16_t len, uint8_t apiflags);
+err_t tcp_output(tcp_pcb* pcb);
+udp_pcb* udp_new();
+void udp_remove(udp_pcb* pcb);
+void udp_recv(udp_pcb* pcb, udp_recv_fn recv, void* arg);
+err_t udp_bind(udp_pcb* pcb, ip_addr_t* addr, u16_t port);
+void udp_disconnect(udp_pcb* pcb);
+err_t udp_sendto(udp_pcb* pcb, pbuf* p, ip_addr_t* addr, u16_t port);
+void udp_set_multicast_netif_addr(udp_pcb* pcb, ip_addr_t addr);
+void udp_set_multicast_ttl(udp_pcb* pcb, int ttl);
+pbuf* pbuf_alloc(pbuf_layer layer, uint16_t len, pbuf_type type);
+void pbuf_realloc(pbuf* p, uint16_t len);
+uint16_t pbuf_copy_partial(pbuf* p, void* dataptr, uint16_t len, uint16_t offset);
+uint8_t pbuf_free(pbuf* p);
+void pbuf_ref(pbuf* p);
+void pbuf_cat(pbuf* head, pbuf* tail);
+
+extern "C" void esp_yield();
+extern "C" void esp_schedule();
+
+#endif//lwip_stub_h
@@ -0,0 +1,54 @@
+/*
+ malloc_counter.cpp - count heap allocations made by the code under test
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <stdlib.h>
+#include "malloc_counter.h"
+
+static size_t s_mallocCount = 0;
+
+#ifdef __GLIBC__
+
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+
+extern "C" void* malloc(size_t size)
+{
+    ++s_mallocCount;
+    return __libc_malloc(size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+    ++s_mallocCount;
+    return __libc_realloc(ptr, size);
+}
+
+bool mallocCounterEnabled()
+{
+    return true;
+}
+
+#else
+
+bool mallocCounterEnabled()
+{
+    return false;
+}
+
+#endif
+
+size_t mallocCount()
+{
+    return s_mallocCount;
+}
@@ -0,0 +1,26 @@
+/*
+ malloc_counter.h - count heap allocations made by the code under test
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#ifndef malloc_counter_h
+#define malloc_counter_h
+
+#include <stddef.h>
+
+// Number of malloc and realloc calls so far. Counting relies on glibc
+// letting the program override malloc; elsewhere mallocCounterEnabled()
+// returns false and the count stays at zero.
+size_t mallocCount();
+bool mallocCounterEnabled();
+
+#endif//malloc_counter_h
@@ -0,0 +1,191 @@
+/*
+ test_body_reader.cpp - HTTP response body decoder tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string>
+#include <Arduino.h>
+#include "../common/client_mock.h"
+#include <detail/BodyReader.h>
+
+// Reads the whole body through a buffer of bufSize bytes; returns the error
+// if there is one
+static int readAll(BodyReader& reader, Client& client, size_t bufSize, std::string& body)
+{
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[bufSize]);
+    int len;
+    while ((len = reader.read(client, buf.get(), bufSize)) > 0) {
+        REQUIRE((size_t) len <= bufSize);
+        body.append((const char*) buf.get(), len);
+    }
+    return len;
+}
+
+static std::string chunked(const std::string& body, size_t chunkSize)
+{
+    std::string out;
+    char line[16];
+    for (size_t pos = 0; pos < body.size(); pos += chunkSize) {
+        std::string chunk = body.substr(pos, chunkSize);
+        snprintf(line, sizeof(line), "%zx\r\n", chunk.size());
+        out += line + chunk + "\r\n";
+    }
+    return out + "0\r\n\r\n";
+}
+
+TEST_CASE("BodyReader stops at Content-Length", "[http][body]")
+{
+    ClientMock client("hello, worldHTTP/1.1 200 OK", 5);
+    BodyReader reader;
+    reader.begin(12, false, 0);
+    std::string body;
+    REQUIRE(readAll(reader, client, 64, body) == 0);
+    REQUIRE(body == "hello, world");
+    REQUIRE(reader.done());
+    REQUIRE(reader.total() == 12);
+    // the next response is left alone
+    REQUIRE(client.pos == 12);
+}
+
+// HTTPClient::read() ends the request on ended(); writeToStream() reads a
+// Content-Length body through a buffer of exactly its size
+TEST_CASE("BodyReader reports the end of a Content-Length body once", "[http][body]")
+{
+    ClientMock client("hello, world", 5);
+    BodyReader reader;
+    reader.begin(12, false, 0);
+    uint8_t buf[12];
+    size_t total = 0;
+    int len;
+    while (!reader.done()) {
+        REQUIRE_FALSE(reader.ended());
+        REQUIRE((len = reader.read(client, buf + total, sizeof(buf) - total)) > 0);
+        total += len;
+    }
+    // done with the last byte, with no read having returned 0
+    REQUIRE(total == 12);
+    REQUIRE(reader.ended());
+    REQUIRE_FALSE(reader.ended());
+    REQUIRE(reader.read(client, buf, sizeof(buf)) == 0);
+    REQUIRE_FALSE(reader.ended());
+}
+
+TEST_CASE("BodyReader reports the end of an empty body before any read", "[http][body]")
+{
+    BodyReader reader;
+    reader.begin(0, false, 0);
+    REQUIRE(reader.done());
+    REQUIRE(reader.ended());
+    REQUIRE_FALSE(reader.ended());
+
+    // each body ends on its own
+    ClientMock client("0\r\n\r\n");
+    reader.begin(-1, true, 0);
+    REQUIRE_FALSE(reader.ended());
+    uint8_t buf[4];
+    REQUIRE(reader.read(client, buf, sizeof(buf)) == 0);
+    REQUIRE(reader.ended());
+    REQUIRE_FALSE(reader.ended());
+}
+
+TEST_CASE("BodyReader reads up to the end of the connection", "[http][body]")
+{
+    ClientMock client("no length given", 4);
+    BodyReader reader;
+    reader.begin(-1, false, 0);
+    std::string body;
+    REQUIRE(readAll(reader, client, 3, body) == 0);
+    REQUIRE(body == "no length given");
+}
+
+TEST_CASE("BodyReader reports a body cut short", "[http][body]")
+{
+    ClientMock client("short");
+    BodyReader reader;
+    reader.begin(10, false, 0);
+    std::string body;
+    REQUIRE(readAll(reader, client, 64, body) == BODY_ERROR_CONNECTION_LOST);
+    REQUIRE(body == "short");
+    uint8_t buf[4];
+    REQUIRE(reader.read(client, buf, sizeof(buf)) == BODY_ERROR_CONNECTION_LOST);
+}
+
+TEST_CASE("BodyReader decodes chunked bodies", "[http][body]")
+{
+    std::string input =
+        "5\r\nhello\r\n"
+        "2;name=value\r\n, \r\n"
+        "A \r\n0123456789\r\n"
+        "0\r\n"
+        "Trailer: ignored\r\n"
+        "\r\n"
+        "next";
+    ClientMock client(input, 3);
+    BodyReader reader;
+    reader.begin(-1, true, 0);
+    std::string body;
+    REQUIRE(readAll(reader, client, 4, body) == 0);
+    REQUIRE(body == "hello, 0123456789");
+    REQUIRE(reader.total() == body.size());
+    REQUIRE(input.substr(client.pos) == "next");
+}
+
+TEST_CASE("BodyReader rejects malformed chunks", "[http][body]")
+{
+    const char* inputs[] = {
+        "x\r\nhello\r\n0\r\n\r\n",
+        "\r\n",
+        "5\r\nhelloXX0\r\n\r\n",
+        "5\rhello\r\n0\r\n\r\n",
+        "fffffffffffffffffffff\r\n",
+    };
+    for (const char* input : inputs) {
+        ClientMock client(input);
+        BodyReader reader;
+        reader.begin(-1, true, 0);
+        std::string body;
+        REQUIRE(readAll(reader, client, 64, body) == BODY_ERROR_ENCODING);
+    }
+}
+
+TEST_CASE("BodyReader reads randomized chunked bodies", "[http][body]")
+{
+    srand(7);
+    for (int i = 0; i < 100; ++i) {
+        std::string payload(rand() % 20000, 0);
+        for (char& c : payload) {
+            c = (char) rand();
+        }
+        size_t chunkSize = 1 + rand() % 3000;
+        size_t bufSize = 1 + rand() % 2000;
+        ClientMock client(chunked(payload, chunkSize), 1 + rand() % 1460, true);
+        BodyReader reader;
+        reader.begin(-1, true, 0);
+        std::string body;
+        REQUIRE(readAll(reader, client, bufSize, body) == 0);
+        REQUIRE(body == payload);
+    }
+}
+
+TEST_CASE("BodyReader reads chunk data in bulk", "[http][body]")
+{
+    std::string payload(50000, 'x');
+    ClientMock client(chunked(payload, 8192), 1460);
+    BodyReader reader;
+    reader.begin(-1, true, 0);
+    std::string body;
+    REQUIRE(readAll(reader, client, 1460, body) == 0);
+    REQUIRE(body == payload);
+    // framing aside, one read per segment at most
+    REQUIRE(client.reads <= 2 * (client.input.size() / 1460 + 1));
+}
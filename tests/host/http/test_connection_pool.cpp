@@ -0,0 +1,156 @@
+/*
+ test_connection_pool.cpp - keep-alive connection pool tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string>
+#include <memory>
+#include <unistd.h>
+#include <Arduino.h>
+#include "../common/client_mock.h"
+#include <detail/ConnectionPool.h>
+
+// An open connection with nothing to read, as a pooled one should be.
+class IdleClient : public ClientMock {
+public:
+    IdleClient(int id, int& stops) : ClientMock(""), id(id), stops(stops) { }
+
+    void stop() override { open = false; ++stops; }
+    uint8_t connected() override { return open; }
+
+    int id;
+    int& stops;
+    bool open = true;
+};
+
+class TestPool : public ConnectionPool<IdleClient> {
+public:
+    using ConnectionPool::ConnectionPool;
+    using ConnectionPool::take;
+    using ConnectionPool::put;
+};
+
+static std::unique_ptr<IdleClient> client(int id, int& stops)
+{
+    return std::unique_ptr<IdleClient>(new IdleClient(id, stops));
+}
+
+TEST_CASE("ConnectionPool hands connections back by key", "[http][pool]")
+{
+    int stops = 0;
+    TestPool pool(3, 10000);
+    pool.put("a", client(1, stops));
+    pool.put("b", client(2, stops));
+    pool.put("a", client(3, stops));
+    REQUIRE(pool.size() == 3);
+
+    // the most recently used one first
+    std::unique_ptr<IdleClient> c = pool.take("a");
+    REQUIRE(c);
+    REQUIRE(c->id == 3);
+    c = pool.take("a");
+    REQUIRE(c);
+    REQUIRE(c->id == 1);
+    REQUIRE_FALSE(pool.take("a"));
+    REQUIRE_FALSE(pool.take("c"));
+    REQUIRE(pool.size() == 1);
+    REQUIRE(pool.requests() == 4);
+    REQUIRE(pool.reused() == 2);
+    REQUIRE(pool.expired() == 0);
+    REQUIRE(pool.evicted() == 0);
+    REQUIRE(stops == 0);
+}
+
+TEST_CASE("ConnectionPool closes the least recently used connection to make room", "[http][pool]")
+{
+    int stops = 0;
+    TestPool pool(2, 10000);
+    pool.put("a", client(1, stops));
+    pool.put("b", client(2, stops));
+    pool.put("c", client(3, stops));
+    REQUIRE(pool.size() == 2);
+    REQUIRE(pool.evicted() == 1);
+    REQUIRE(stops == 1);
+    REQUIRE_FALSE(pool.take("a"));
+    REQUIRE(pool.take("b"));
+
+    // taking a connection and putting it back makes it the most recent
+    pool.put("b", client(4, stops));
+    pool.put("a", client(5, stops));
+    REQUIRE(pool.evicted() == 2);
+    REQUIRE_FALSE(pool.take("c"));
+    REQUIRE(pool.take("b")->id == 4);
+
+    pool.put("c", client(6, stops));
+    pool.setMaxConnections(1);
+    REQUIRE(pool.size() == 1);
+    REQUIRE(pool.evicted() == 3);
+    REQUIRE(pool.take("c")->id == 6);
+
+    // no room at all closes what is put
+    pool.setMaxConnections(0);
+    REQUIRE(pool.size() == 0);
+    pool.put("a", client(7, stops));
+    REQUIRE(pool.size() == 0);
+    REQUIRE(stops == 4);
+    REQUIRE(pool.expired() == 0);
+}
+
+TEST_CASE("ConnectionPool closes connections idle for too long", "[http][pool]")
+{
+    int stops = 0;
+    TestPool pool(3, 20);
+    pool.put("a", client(1, stops));
+    REQUIRE(pool.size() == 1);
+    usleep(30000);
+    pool.put("b", client(2, stops));
+    REQUIRE(pool.expired() == 1);
+    REQUIRE(stops == 1);
+    REQUIRE_FALSE(pool.take("a"));
+    REQUIRE(pool.take("b"));
+
+    pool.put("a", client(3, stops));
+    pool.setIdleTimeout(0);
+    REQUIRE(pool.size() == 0);
+    REQUIRE(pool.expired() == 2);
+    REQUIRE(pool.requests() == 2);
+    REQUIRE(pool.reused() == 1);
+    REQUIRE(pool.evicted() == 0);
+}
+
+TEST_CASE("ConnectionPool drops connections the server closed or wrote to", "[http][pool]")
+{
+    int stops = 0;
+    TestPool pool(3, 10000);
+    pool.put("a", client(1, stops));
+    pool.put("b", client(2, stops));
+    pool.put("c", client(3, stops));
+    pool.take("a");
+    pool.take("b");
+    pool.take("c");
+    REQUIRE(pool.reused() == 3);
+
+    std::unique_ptr<IdleClient> closed = client(4, stops);
+    IdleClient* closedp = closed.get();
+    pool.put("a", std::move(closed));
+    std::unique_ptr<IdleClient> unasked = client(5, stops);
+    IdleClient* unaskedp = unasked.get();
+    pool.put("b", std::move(unasked));
+    closedp->open = false;
+    unaskedp->input = "HTTP/1.1 408 Request Timeout\r\n\r\n";
+    REQUIRE_FALSE(pool.take("a"));
+    REQUIRE_FALSE(pool.take("b"));
+    REQUIRE(pool.expired() == 2);
+    REQUIRE(pool.reused() == 3);
+    REQUIRE(pool.requests() == 5);
+}
@@ -0,0 +1,256 @@
+/*
+ test_header_parser.cpp - HTTP response head parser tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string>
+#include <Arduino.h>
+#include "../common/client_mock.h"
+#include "../common/malloc_counter.h"
+#include <detail/HeaderParser.h>
+#include <detail/BodyReader.h>
+
+// Responses as servers send them
+static const char* nginxResponse =
+    "HTTP/1.1 200 OK\r\n"
+    "Server: nginx/1.14.0 (Ubuntu)\r\n"
+    "Date: Tue, 12 Jun 2018 09:21:47 GMT\r\n"
+    "Content-Type: application/octet-stream\r\n"
+    "Content-Length: 412304\r\n"
+    "Last-Modified: Mon, 11 Jun 2018 17:02:12 GMT\r\n"
+    "Connection: keep-alive\r\n"
+    "ETag: \"5b1eaa74-64a90\"\r\n"
+    "x-MD5: 1b8f4a1c1fd0a1e3a4e62ef4e34a9c06\r\n"
+    "Accept-Ranges: bytes\r\n"
+    "\r\n";
+
+static const char* apiResponse =
+    "HTTP/1.1 301 Moved Permanently\r\n"
+    "Date: Tue, 12 Jun 2018 09:24:03 GMT\r\n"
+    "Content-Type: text/html; charset=utf-8\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "Connection: close\r\n"
+    "Set-Cookie: __cfduid=d6c2b0e9a1f3d4b5c6e7f8091a2b3c4d51528795443; expires=Wed, 12-Jun-19 09:24:03 GMT; path=/; domain=.example.com; HttpOnly\r\n"
+    "Location: https://api.example.com/v1/devices/esp8266\r\n"
+    "Cache-Control: max-age=3600\r\n"
+    "Expires: Tue, 12 Jun 2018 10:24:03 GMT\r\n"
+    "Vary: Accept-Encoding\r\n"
+    "Server: cloudflare\r\n"
+    "CF-RAY: 429b6c8f1e3a2c4d-AMS\r\n"
+    "\r\n";
+
+static size_t parseAll(HeaderParser& parser, const std::string& input, size_t piece)
+{
+    size_t used = 0;
+    while (used < input.size() && !parser.done()) {
+        size_t len = std::min(piece, input.size() - used);
+        used += parser.parse((const uint8_t*) input.data() + used, len);
+    }
+    return used;
+}
+
+TEST_CASE("HeaderParser reads the status and the fields the client needs", "[http][headers]")
+{
+    HTTPHeaderField fields[2];
+    fields[0].key = "Location";
+    fields[1].key = "x-md5";
+    std::string input = std::string(nginxResponse) + "body";
+    for (size_t piece : { (size_t) 1, (size_t) 7, input.size() }) {
+        HeaderParser parser;
+        parser.begin(fields, 2);
+        size_t used = parseAll(parser, input, piece);
+        REQUIRE(parser.done());
+        REQUIRE(input.substr(used) == "body");
+        REQUIRE(parser.isHTTP());
+        REQUIRE(parser.code() == 200);
+        REQUIRE(parser.contentLength() == 412304);
+        REQUIRE(parser.keepAlive());
+        REQUIRE_FALSE(parser.chunked());
+        REQUIRE(fields[0].value == "");
+        REQUIRE(fields[1].value == "1b8f4a1c1fd0a1e3a4e62ef4e34a9c06");
+    }
+
+    HeaderParser parser;
+    parser.begin(fields, 2);
+    parseAll(parser, apiResponse, 5);
+    REQUIRE(parser.code() == 301);
+    REQUIRE(parser.contentLength() == -1);
+    REQUIRE_FALSE(parser.keepAlive());
+    REQUIRE(parser.chunked());
+    REQUIRE_FALSE(parser.unknownEncoding());
+    REQUIRE(fields[0].value == "https://api.example.com/v1/devices/esp8266");
+    // cleared for the new response
+    REQUIRE(fields[1].value == "");
+}
+
+TEST_CASE("HeaderParser trims values and tolerates odd lines", "[http][headers]")
+{
+    HTTPHeaderField fields[2];
+    fields[0].key = "X-Spaced";
+    fields[1].key = "X-Repeated";
+    std::string input =
+        "HTTP/1.0 404 Not Found\n"
+        "no colon here\r\n"
+        "x-spaced: \t  a  b \t \r\n"
+        "X-Repeated: first\r\n"
+        "X-Repeated:second\r\n"
+        "X-Empty:\r\n"
+        "Transfer-Encoding: gzip\r\n"
+        "\n"
+        "rest";
+    HeaderParser parser;
+    parser.begin(fields, 2);
+    size_t used = parseAll(parser, input, 3);
+    REQUIRE(parser.done());
+    REQUIRE(input.substr(used) == "rest");
+    REQUIRE(parser.code() == 404);
+    REQUIRE(fields[0].value == "a  b");
+    REQUIRE(fields[1].value == "second");
+    REQUIRE(parser.unknownEncoding());
+}
+
+TEST_CASE("HeaderParser collects long values", "[http][headers]")
+{
+    HTTPHeaderField field;
+    field.key = "Set-Cookie";
+    HeaderParser parser;
+    parser.begin(&field, 1);
+    parseAll(parser, apiResponse, 11);
+    REQUIRE(field.value == "__cfduid=d6c2b0e9a1f3d4b5c6e7f8091a2b3c4d51528795443; expires=Wed, 12-Jun-19 09:24:03 GMT; path=/; domain=.example.com; HttpOnly");
+}
+
+TEST_CASE("HeaderParser tells when the peer is not an HTTP server", "[http][headers]")
+{
+    HeaderParser parser;
+    parser.begin(nullptr, 0);
+    std::string input = "SSH-2.0-OpenSSH_7.6\r\nContent-Length: 5\r\n\r\n";
+    REQUIRE(parseAll(parser, input, input.size()) == input.size());
+    REQUIRE(parser.done());
+    REQUIRE_FALSE(parser.isHTTP());
+    REQUIRE(parser.contentLength() == 5);
+}
+
+TEST_CASE("HeaderParser and BodyReader split pipelined responses", "[http][headers]")
+{
+    std::string input =
+        "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\nfirst"
+        "HTTP/1.1 204 No Content\r\n\r\n"
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n6\r\nthird!\r\n0\r\n\r\n"
+        "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\nContent-Length: 4\r\n\r\nlast";
+    const char* bodies[] = { "first", "", "third!", "last" };
+    const int codes[] = { 200, 204, 200, 503 };
+
+    ClientMock client(input, 7, true);
+    HeaderParser parser;
+    BodyReader reader;
+    uint8_t buf[16];
+    for (int i = 0; i < 4; ++i) {
+        parser.begin(nullptr, 0);
+        while (!parser.done() && client.available()) {
+            size_t len = client.peekBytes(buf, std::min((size_t) client.available(), sizeof(buf)));
+            client.read(buf, parser.parse(buf, len));
+        }
+        REQUIRE(parser.code() == codes[i]);
+        REQUIRE(parser.close() == (i == 3));
+        // a 204 has no body whatever its head says
+        reader.begin(codes[i] == 204 ? 0 : parser.contentLength(), parser.chunked(), 0);
+        std::string body;
+        int len;
+        while ((len = reader.read(client, buf, sizeof(buf))) > 0) {
+            body.append((const char*) buf, len);
+        }
+        REQUIRE(len == 0);
+        REQUIRE(body == bodies[i]);
+    }
+    REQUIRE(client.pos == input.size());
+}
+
+// What the client did before: a String per line, more for name and value
+static int stringHeaders(Client& client, String* keys, String* values, size_t count)
+{
+    int size = -1;
+    while (client.available()) {
+        String headerLine = client.readStringUntil('\n');
+        headerLine.trim();
+        if (headerLine == "") {
+            break;
+        }
+        if (headerLine.indexOf(':') > 0) {
+            String headerName = headerLine.substring(0, headerLine.indexOf(':'));
+            String headerValue = headerLine.substring(headerLine.indexOf(':') + 1);
+            headerValue.trim();
+            if (headerName.equalsIgnoreCase("Content-Length")) {
+                size = headerValue.toInt();
+            }
+            for (size_t i = 0; i < count; i++) {
+                if (keys[i].equalsIgnoreCase(headerName)) {
+                    values[i] = headerValue;
+                    break;
+                }
+            }
+        }
+    }
+    return size;
+}
+
+TEST_CASE("HeaderParser only allocates for collected fields", "[http][headers][benchmark]")
+{
+    if (!mallocCounterEnabled()) {
+        return;
+    }
+    const int responses = 100;
+    String keys[1] = { "x-MD5" };
+    String values[1];
+    HTTPHeaderField fields[1];
+    fields[0].key = keys[0];
+
+    // no REQUIRE in the loops, it allocates
+    int found = 0;
+    size_t before = mallocCount();
+    for (int i = 0; i < responses; ++i) {
+        ClientMock client(nginxResponse, 536);
+        found += stringHeaders(client, keys, values, 1) == 412304;
+    }
+    size_t stringAllocs = mallocCount() - before;
+
+    HeaderParser parser;
+    uint8_t buf[128];
+    before = mallocCount();
+    for (int i = 0; i < responses; ++i) {
+        ClientMock client(nginxResponse, 536);
+        parser.begin(fields, 1);
+        while (!parser.done() && client.available()) {
+            size_t len = client.peekBytes(buf, std::min((size_t) client.available(), sizeof(buf)));
+            client.read(buf, parser.parse(buf, len));
+        }
+        found += parser.contentLength() == 412304;
+    }
+    size_t parserAllocs = mallocCount() - before;
+
+    // the mock client itself allocates, take that out of both
+    before = mallocCount();
+    for (int i = 0; i < responses; ++i) {
+        ClientMock client(nginxResponse, 536);
+    }
+    size_t clientAllocs = mallocCount() - before;
+
+    stringAllocs -= clientAllocs;
+    parserAllocs -= clientAllocs;
+    INFO("String: " << (double) stringAllocs / responses << " allocations per response");
+    INFO("HeaderParser: " << (double) parserAllocs / responses << " allocations per response");
+    REQUIRE(found == 2 * responses);
+    REQUIRE(values[0] == fields[0].value);
+    REQUIRE(stringAllocs >= (size_t) responses * 10);
+    // at most the collected value, whose buffer is kept between responses
+    REQUIRE(parserAllocs <= (size_t) responses);
+}
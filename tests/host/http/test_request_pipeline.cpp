@@ -0,0 +1,158 @@
+/*
+ test_request_pipeline.cpp - pipelined HTTP request sequencing tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string>
+#include <vector>
+#include <memory>
+#include <Arduino.h>
+#include "../common/client_mock.h"
+#include <detail/RequestPipeline.h>
+#include <detail/HeaderParser.h>
+#include <detail/BodyReader.h>
+
+struct Answer {
+    size_t request;
+    int code;
+    std::string body;
+};
+
+// Drives the pipeline the way HTTPClient::sendQueue does: one connection per
+// entry of responses, each carrying what the server answers on it. What was
+// written on each connection is left in sent.
+static std::vector<Answer> runQueue(const std::vector<std::string>& requests, const std::vector<std::string>& responses,
+                                    size_t depth, std::vector<std::string>& sent)
+{
+    std::vector<Answer> answers;
+    std::unique_ptr<ClientMock> client;
+    size_t connections = 0;
+    RequestPipeline pipeline;
+    HeaderParser parser;
+    BodyReader reader;
+    uint8_t buf[16];
+
+    pipeline.begin(requests.size(), depth);
+    while (!pipeline.done()) {
+        if (pipeline.idle()) {
+            REQUIRE(connections < responses.size());
+            client.reset(new ClientMock(responses[connections++], 5));
+            sent.push_back("");
+        }
+
+        for (int next; (next = pipeline.next()) >= 0; pipeline.sent()) {
+            client->write((const uint8_t*) requests[next].data(), requests[next].size());
+        }
+        REQUIRE(pipeline.outstanding() <= depth);
+        sent.back() = client->output;
+
+        // the server only answers what it was sent
+        REQUIRE(pipeline.outstanding() > 0);
+        parser.begin(nullptr, 0);
+        while (!parser.done() && client->available()) {
+            size_t len = client->peekBytes(buf, std::min((size_t) client->available(), sizeof(buf)));
+            client->read(buf, parser.parse(buf, len));
+        }
+        REQUIRE(parser.done());
+        reader.begin(parser.contentLength(), parser.chunked(), 0);
+        Answer answer = { pipeline.answering(), parser.code(), "" };
+        int len;
+        while ((len = reader.read(*client, buf, sizeof(buf))) > 0) {
+            answer.body.append((const char*) buf, len);
+        }
+        REQUIRE(len == 0);
+        answers.push_back(answer);
+
+        if (parser.close()) {
+            client->stop();
+        }
+        pipeline.answered(parser.close());
+    }
+    return answers;
+}
+
+static std::string response(const char* body, bool close = false)
+{
+    std::string out = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(strlen(body)) + "\r\n";
+    if (close) {
+        out += "Connection: close\r\n";
+    }
+    return out + "\r\n" + body;
+}
+
+TEST_CASE("RequestPipeline keeps depth requests ahead of their responses", "[http][pipeline]")
+{
+    RequestPipeline pipeline;
+    pipeline.begin(5, 2);
+    REQUIRE(pipeline.idle());
+    REQUIRE(pipeline.next() == 0);
+    pipeline.sent();
+    REQUIRE(pipeline.next() == 1);
+    pipeline.sent();
+    REQUIRE(pipeline.next() == -1);
+    REQUIRE(pipeline.answering() == 0);
+    pipeline.answered(false);
+    REQUIRE(pipeline.next() == 2);
+    REQUIRE(pipeline.answering() == 1);
+    REQUIRE_FALSE(pipeline.idle());
+    REQUIRE_FALSE(pipeline.done());
+}
+
+TEST_CASE("RequestPipeline hands responses to requests in order", "[http][pipeline]")
+{
+    std::vector<std::string> requests = { "GET /a\r\n\r\n", "GET /b\r\n\r\n", "GET /c\r\n\r\n", "GET /d\r\n\r\n" };
+    std::vector<std::string> responses = { response("a") + response("bb") + response("ccc") + response("dddd") };
+    std::vector<std::string> sent;
+    std::vector<Answer> answers = runQueue(requests, responses, 2, sent);
+
+    REQUIRE(answers.size() == 4);
+    const char* bodies[] = { "a", "bb", "ccc", "dddd" };
+    for (size_t i = 0; i < answers.size(); ++i) {
+        REQUIRE(answers[i].request == i);
+        REQUIRE(answers[i].code == 200);
+        REQUIRE(answers[i].body == bodies[i]);
+    }
+    REQUIRE(sent.size() == 1);
+    REQUIRE(sent[0] == requests[0] + requests[1] + requests[2] + requests[3]);
+}
+
+TEST_CASE("RequestPipeline sends again what a closed connection lost", "[http][pipeline]")
+{
+    std::vector<std::string> requests = { "GET /a\r\n\r\n", "GET /b\r\n\r\n", "GET /c\r\n\r\n" };
+    // the server answers /a and closes; /b went out on that connection too
+    std::vector<std::string> responses = {
+        response("a", true),
+        response("b") + response("c"),
+    };
+    std::vector<std::string> sent;
+    std::vector<Answer> answers = runQueue(requests, responses, 2, sent);
+
+    REQUIRE(answers.size() == 3);
+    REQUIRE(answers[0].body == "a");
+    REQUIRE(answers[1].request == 1);
+    REQUIRE(answers[1].body == "b");
+    REQUIRE(answers[2].request == 2);
+    REQUIRE(answers[2].body == "c");
+    REQUIRE(sent.size() == 2);
+    REQUIRE(sent[0] == requests[0] + requests[1]);
+    REQUIRE(sent[1] == requests[1] + requests[2]);
+}
+
+TEST_CASE("RequestPipeline sets the Content-Length of each request", "[http][pipeline]")
+{
+    String headers = "User-Agent: test\r\ncontent-length: 11\r\nAccept: */*\r\n";
+    REQUIRE(RequestPipeline::withContentLength(headers, 5) == "User-Agent: test\r\nAccept: */*\r\nContent-Length: 5\r\n");
+    // a GET queued after a POST gets no length
+    REQUIRE(RequestPipeline::withContentLength(headers, 0) == "User-Agent: test\r\nAccept: */*\r\n");
+    REQUIRE(RequestPipeline::withContentLength("", 0) == "");
+}
@@ -0,0 +1,60 @@
+/*
+ test_asset_bundle.cpp - static asset bundle tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <Arduino.h>
+#include <detail/AssetBundle.h>
+
+// Same layout as the output of tools/webassets.py
+static const uint8_t test_data[] PROGMEM = { 'i', 'n', 'd', 'e', 'x', 'a', 'p', 'p' };
+static const char test_str0[] PROGMEM = "/";
+static const char test_str1[] PROGMEM = "text/html";
+static const char test_str2[] PROGMEM = "\"0123\"";
+static const char test_str3[] PROGMEM = "/index.html";
+static const char test_str4[] PROGMEM = "/js/app.js";
+static const char test_str5[] PROGMEM = "application/javascript";
+static const char test_str6[] PROGMEM = "\"4567\"";
+
+static const AssetEntry test_entries[] PROGMEM = {
+    { test_str0, test_str1, test_str2, 0, 5, 0x01 },
+    { test_str3, test_str1, test_str2, 0, 5, 0x01 },
+    { test_str4, test_str5, test_str6, 5, 3, 0x00 },
+};
+
+static const AssetBundle test_bundle = { test_data, test_entries, 3 };
+
+TEST_CASE("AssetBundle finds every entry", "[web][assets]")
+{
+    AssetEntry entry;
+    REQUIRE(test_bundle.find("/", entry));
+    REQUIRE(entry.offset == 0);
+    REQUIRE(entry.length == 5);
+    REQUIRE((entry.flags & ASSET_FLAG_GZIP));
+    REQUIRE(test_bundle.find("/index.html", entry));
+    REQUIRE(strcmp(entry.etag, "\"0123\"") == 0);
+    REQUIRE(test_bundle.find("/js/app.js", entry));
+    REQUIRE(strcmp(entry.mimeType, "application/javascript") == 0);
+    REQUIRE(memcmp(test_bundle.data + entry.offset, "app", entry.length) == 0);
+}
+
+TEST_CASE("AssetBundle rejects unknown paths", "[web][assets]")
+{
+    AssetEntry entry;
+    REQUIRE_FALSE(test_bundle.find("", entry));
+    REQUIRE_FALSE(test_bundle.find("/index.htm", entry));
+    REQUIRE_FALSE(test_bundle.find("/js", entry));
+    REQUIRE_FALSE(test_bundle.find("/zzz", entry));
+    AssetBundle empty = { test_data, test_entries, 0 };
+    REQUIRE_FALSE(empty.find("/", entry));
+}
@@ -0,0 +1,130 @@
+/*
+ test_chunked_writer.cpp - chunked transfer-encoding writer tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <detail/ChunkedWriter.h>
+
+struct Segments {
+    std::vector<std::string> sent;
+
+    ChunkedWriter::Output output()
+    {
+        return [this](const char* data, size_t len) {
+            sent.push_back(std::string(data, len));
+            return len;
+        };
+    }
+
+    std::string stream() const
+    {
+        std::string s;
+        for (auto& segment : sent) {
+            s += segment;
+        }
+        return s;
+    }
+};
+
+// Decodes a chunked body, returns false if the framing is broken
+static bool decode(const std::string& s, std::string& body)
+{
+    size_t pos = 0;
+    for (;;) {
+        size_t eol = s.find("\r\n", pos);
+        if (eol == std::string::npos) {
+            return false;
+        }
+        size_t len = strtoul(s.substr(pos, eol - pos).c_str(), nullptr, 16);
+        pos = eol + 2;
+        if (len == 0) {
+            return s.compare(pos, std::string::npos, "\r\n") == 0;
+        }
+        if (pos + len + 2 > s.size() || s.compare(pos + len, 2, "\r\n") != 0) {
+            return false;
+        }
+        body.append(s, pos, len);
+        pos += len + 2;
+    }
+}
+
+TEST_CASE("ChunkedWriter terminates empty bodies", "[web][chunked]")
+{
+    Segments segments;
+    ChunkedWriter writer(segments.output());
+    writer.begin(1460);
+    REQUIRE(writer.active());
+    REQUIRE(writer.end());
+    REQUIRE_FALSE(writer.active());
+    REQUIRE(segments.sent.size() == 1);
+    REQUIRE(segments.stream() == "0\r\n\r\n");
+}
+
+TEST_CASE("ChunkedWriter coalesces small writes", "[web][chunked]")
+{
+    Segments segments;
+    ChunkedWriter writer(segments.output());
+    writer.begin(1460);
+    std::string body;
+    for (int i = 0; i < 1000; ++i) {
+        std::string row = "<tr><td>" + std::to_string(i) + "</td></tr>\n";
+        REQUIRE(writer.write(row.c_str(), row.size()) == row.size());
+        body += row;
+    }
+    REQUIRE(writer.end());
+
+    std::string decoded;
+    REQUIRE(decode(segments.stream(), decoded));
+    REQUIRE(decoded == body);
+    // every segment but the last is full, the last carries the terminator
+    REQUIRE(segments.sent.size() == body.size() / (1460 - 13) + 1);
+    for (size_t i = 0; i + 1 < segments.sent.size(); ++i) {
+        REQUIRE(segments.sent[i].compare(0, 5, "5a7\r\n") == 0);
+        REQUIRE(segments.sent[i].size() == 5 + 0x5a7 + 2);
+    }
+    REQUIRE(segments.sent.back().size() <= 1460);
+}
+
+TEST_CASE("ChunkedWriter splits large writes", "[web][chunked]")
+{
+    Segments segments;
+    ChunkedWriter writer(segments.output());
+    writer.begin(512);
+    std::string big(5000, 'x');
+    REQUIRE(writer.write_P(big.c_str(), 3) == 3);
+    REQUIRE(writer.write(big.c_str(), big.size()) == big.size());
+    REQUIRE(writer.flush());
+    size_t flushed = segments.sent.size();
+    REQUIRE(writer.end());
+    REQUIRE(segments.sent.size() == flushed + 1);
+    REQUIRE(segments.sent.back() == "0\r\n\r\n");
+
+    std::string decoded;
+    REQUIRE(decode(segments.stream(), decoded));
+    REQUIRE(decoded == big + "xxx");
+    for (auto& segment : segments.sent) {
+        REQUIRE(segment.size() <= 512);
+    }
+}
+
+TEST_CASE("ChunkedWriter reports short writes", "[web][chunked]")
+{
+    ChunkedWriter writer([](const char*, size_t len) { return len / 2; });
+    writer.begin(128);
+    std::string big(1000, 'x');
+    REQUIRE(writer.write(big.c_str(), big.size()) < big.size());
+    REQUIRE_FALSE(writer.end());
+}
@@ -0,0 +1,122 @@
+/*
+ test_conditional.cpp - conditional and range request tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <Arduino.h>
+#include <detail/conditional.h>
+
+using namespace conditional;
+
+TEST_CASE("If-None-Match is compared against the ETag", "[web][conditional]")
+{
+    using conditional::etagMatches;
+    REQUIRE(etagMatches("\"abc\"", "\"abc\""));
+    REQUIRE(etagMatches("W/\"abc\"", "\"abc\""));
+    REQUIRE(etagMatches("\"abc\"", "W/\"abc\""));
+    REQUIRE(etagMatches("\"x\", \"abc\"", "\"abc\""));
+    REQUIRE(etagMatches("\"x\",W/\"abc\"", "\"abc\""));
+    REQUIRE(etagMatches("*", "\"abc\""));
+    REQUIRE_FALSE(etagMatches("", "\"abc\""));
+    REQUIRE_FALSE(etagMatches("\"abc\"", ""));
+    REQUIRE_FALSE(etagMatches("\"abcd\"", "\"abc\""));
+    REQUIRE_FALSE(etagMatches("\"ab\"", "\"abc\""));
+    REQUIRE_FALSE(etagMatches("\"a,bc\"", "\"abc\""));
+    REQUIRE_FALSE(etagMatches("\"abc", "\"abc\""));
+}
+
+static uint32_t hashOf(const char* content)
+{
+    return contentHash(CONTENT_HASH_INIT, (const uint8_t*) content, strlen(content));
+}
+
+TEST_CASE("File ETags depend on size and content", "[web][conditional]")
+{
+    String tag = fileETag(11, hashOf("hello world"));
+    REQUIRE(tag.startsWith("W/\"b-"));
+    REQUIRE(tag.endsWith("\""));
+    REQUIRE(tag == fileETag(11, hashOf("hello world")));
+    // a file replaced by one of the same size gets a new tag
+    REQUIRE(tag != fileETag(11, hashOf("hello World")));
+    REQUIRE(tag != fileETag(12, hashOf("hello world")));
+    // the hash can be fed in pieces, as a file is read
+    uint32_t hash = contentHash(CONTENT_HASH_INIT, (const uint8_t*) "hello ", 6);
+    hash = contentHash(hash, (const uint8_t*) "world", 5);
+    REQUIRE(fileETag(11, hash) == tag);
+    REQUIRE(etagMatches(tag, tag));
+    REQUIRE(etagMatches(tag.substring(2), tag));
+}
+
+static RangeResult range(const char* header, size_t size, size_t& start, size_t& end)
+{
+    start = end = 12345;
+    return parseRange(header, size, start, end);
+}
+
+TEST_CASE("Single byte ranges are parsed", "[web][conditional]")
+{
+    size_t start, end;
+    REQUIRE(range("bytes=0-99", 1000, start, end) == RANGE_OK);
+    REQUIRE(start == 0);
+    REQUIRE(end == 99);
+    REQUIRE(range("bytes=500-", 1000, start, end) == RANGE_OK);
+    REQUIRE(start == 500);
+    REQUIRE(end == 999);
+    REQUIRE(range("bytes=-100", 1000, start, end) == RANGE_OK);
+    REQUIRE(start == 900);
+    REQUIRE(end == 999);
+    REQUIRE(range("bytes = 10-20", 1000, start, end) == RANGE_OK);
+    REQUIRE(start == 10);
+    REQUIRE(end == 20);
+    REQUIRE(range("Bytes=999-999", 1000, start, end) == RANGE_OK);
+    REQUIRE(start == 999);
+    REQUIRE(end == 999);
+}
+
+TEST_CASE("Byte ranges are clamped to the body", "[web][conditional]")
+{
+    size_t start, end;
+    REQUIRE(range("bytes=900-2000", 1000, start, end) == RANGE_OK);
+    REQUIRE(start == 900);
+    REQUIRE(end == 999);
+    REQUIRE(range("bytes=-5000", 1000, start, end) == RANGE_OK);
+    REQUIRE(start == 0);
+    REQUIRE(end == 999);
+}
+
+TEST_CASE("Unsatisfiable ranges are reported", "[web][conditional]")
+{
+    size_t start, end;
+    REQUIRE(range("bytes=1000-", 1000, start, end) == RANGE_UNSATISFIABLE);
+    REQUIRE(range("bytes=2000-3000", 1000, start, end) == RANGE_UNSATISFIABLE);
+    REQUIRE(range("bytes=-0", 1000, start, end) == RANGE_UNSATISFIABLE);
+    REQUIRE(range("bytes=0-", 0, start, end) == RANGE_UNSATISFIABLE);
+    REQUIRE(range("bytes=-10", 0, start, end) == RANGE_UNSATISFIABLE);
+}
+
+TEST_CASE("Unsupported or malformed ranges are ignored", "[web][conditional]")
+{
+    size_t start, end;
+    REQUIRE(range("", 1000, start, end) == RANGE_NONE);
+    REQUIRE(range("bytes", 1000, start, end) == RANGE_NONE);
+    REQUIRE(range("bytes=", 1000, start, end) == RANGE_NONE);
+    REQUIRE(range("bytes=-", 1000, start, end) == RANGE_NONE);
+    REQUIRE(range("items=0-10", 1000, start, end) == RANGE_NONE);
+    REQUIRE(range("bytes=0-10,20-30", 1000, start, end) == RANGE_NONE);
+    REQUIRE(range("bytes=10-5", 1000, start, end) == RANGE_NONE);
+    REQUIRE(range("bytes=a-5", 1000, start, end) == RANGE_NONE);
+    REQUIRE(range("bytes=5-b", 1000, start, end) == RANGE_NONE);
+    REQUIRE(range("bytes=+5-10", 1000, start, end) == RANGE_NONE);
+    REQUIRE(range("bytes=99999999999999999999999-", 1000, start, end) == RANGE_NONE);
+    REQUIRE(start == 12345);
+}
@@ -0,0 +1,156 @@
+/*
+ test_multipart_reader.cpp - multipart body reader tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string>
+#include <Arduino.h>
+#include "../common/client_mock.h"
+#include <detail/MultipartReader.h>
+
+static const char boundary[] = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+
+// Reads one part body through a buffer of bufSize bytes and returns it
+static bool readBody(MultipartReader& reader, size_t bufSize, std::string& body)
+{
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[bufSize]);
+    size_t tail;
+    bool found = reader.readPart(buf.get(), bufSize, tail, [&](size_t len) {
+        REQUIRE(len > 0);
+        body.append((const char*) buf.get(), len);
+    });
+    if (found) {
+        body.append((const char*) buf.get(), tail);
+    }
+    return found;
+}
+
+// Random payload, biased towards bytes that look like parts of a delimiter
+static std::string randomPayload(size_t len)
+{
+    static const char tricky[] = "\r\n--";
+    std::string delim = std::string("\r\n--") + boundary;
+    std::string s;
+    // pieces may still add up to a whole delimiter, start over if they do
+    while (s.size() < len || s.find(delim) != std::string::npos) {
+        if (s.size() >= len) {
+            s.clear();
+        }
+        switch (rand() % 8) {
+        case 0:
+            s += tricky[rand() % 4];
+            break;
+        case 1:
+            // a truncated delimiter is still payload
+            s += delim.substr(0, 1 + rand() % (delim.size() - 1));
+            break;
+        default:
+            s += (char) (rand() % 256);
+        }
+    }
+    return s;
+}
+
+TEST_CASE("MultipartReader rejects invalid boundaries", "[web][multipart]")
+{
+    ClientMock client("");
+    MultipartReader empty(client, "");
+    REQUIRE_FALSE(empty.valid());
+    MultipartReader tooLong(client, String("0123456789012345678901234567890123456789012345678901234567890123456789X"));
+    REQUIRE_FALSE(tooLong.valid());
+    MultipartReader ok(client, boundary);
+    REQUIRE(ok.valid());
+}
+
+TEST_CASE("MultipartReader finds the closing delimiter", "[web][multipart]")
+{
+    std::string input = std::string("hello\r\n-world\r\n--") + boundary + "--\r\n";
+    ClientMock client(input);
+    MultipartReader reader(client, boundary);
+    std::string body;
+    REQUIRE(readBody(reader, 256, body));
+    REQUIRE(body == "hello\r\n-world");
+    // data read past the delimiter is still available through Stream
+    REQUIRE(reader.readStringUntil('\r') == "--");
+    REQUIRE(reader.read() == '\n');
+    REQUIRE(reader.available() == 0);
+}
+
+TEST_CASE("MultipartReader handles empty bodies", "[web][multipart]")
+{
+    std::string input = std::string("\r\n--") + boundary + "\r\nnext";
+    ClientMock client(input, 3);
+    MultipartReader reader(client, boundary);
+    std::string body;
+    REQUIRE(readBody(reader, 128, body));
+    REQUIRE(body.empty());
+    REQUIRE(reader.readStringUntil('\r') == "");
+    REQUIRE(reader.readStringUntil('t') == "\nnex");
+}
+
+TEST_CASE("MultipartReader reports disconnects", "[web][multipart]")
+{
+    std::string input = std::string("no delimiter here\r\n--") + std::string(boundary, 10);
+    ClientMock client(input, 7);
+    MultipartReader reader(client, boundary);
+    std::string body;
+    REQUIRE_FALSE(readBody(reader, 64, body));
+}
+
+TEST_CASE("MultipartReader reads randomized bodies", "[web][multipart]")
+{
+    srand(42);
+    for (int i = 0; i < 200; ++i) {
+        size_t bufSize = 64 + rand() % 3000;
+        size_t segment = 1 + rand() % 2000;
+        std::string first = randomPayload(rand() % 10000);
+        std::string second = randomPayload(rand() % 3000);
+        std::string input =
+            first + "\r\n--" + boundary + "\r\n" +
+            "Content-Disposition: form-data; name=\"b\"\r\n\r\n" +
+            second + "\r\n--" + boundary + "--\r\n";
+
+        ClientMock client(input, segment, true);
+        MultipartReader reader(client, boundary);
+
+        std::string body;
+        REQUIRE(readBody(reader, bufSize, body));
+        REQUIRE(body == first);
+
+        REQUIRE(reader.readStringUntil('\r') == "");
+        reader.readStringUntil('\n');
+        REQUIRE(reader.readStringUntil('\r') == "Content-Disposition: form-data; name=\"b\"");
+        reader.readStringUntil('\n');
+        REQUIRE(reader.readStringUntil('\r') == "");
+        reader.readStringUntil('\n');
+
+        body.clear();
+        REQUIRE(readBody(reader, bufSize, body));
+        REQUIRE(body == second);
+        REQUIRE(reader.readStringUntil('\r') == "--");
+    }
+}
+
+TEST_CASE("MultipartReader reads the client in bulk", "[web][multipart]")
+{
+    std::string payload(100000, 'x');
+    std::string input = payload + "\r\n--" + boundary + "--\r\n";
+    ClientMock client(input, 1460);
+    MultipartReader reader(client, boundary);
+    std::string body;
+    REQUIRE(readBody(reader, 2048, body));
+    REQUIRE(body == payload);
+    // a segment that straddles the end of the 2 KB buffer takes two reads,
+    // reading byte by byte would take one per byte
+    REQUIRE(client.reads <= 2 * (input.size() / 1460 + 1));
+}
@@ -0,0 +1,145 @@
+/*
+ test_response_headers.cpp - response header buffer tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string>
+#include <Arduino.h>
+#include <detail/ResponseHeaders.h>
+#include "../common/malloc_counter.h"
+
+static std::string head(const ResponseHeaders& h)
+{
+    return std::string(h.data(), h.length());
+}
+
+TEST_CASE("ResponseHeaders builds a response head", "[web][headers]")
+{
+    ResponseHeaders h;
+    REQUIRE(h.add("Cache-Control", "no-cache"));
+    REQUIRE(h.add_P(PSTR("Content-Type"), PSTR("text/html"), true));
+    REQUIRE(h.add_P(PSTR("Content-Length"), 1234));
+    REQUIRE(h.finish(1, 404, PSTR("Not Found")));
+    REQUIRE(head(h) ==
+        "HTTP/1.1 404 Not Found\r\n"
+        "Content-Type: text/html\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Content-Length: 1234\r\n"
+        "\r\n");
+    h.clear();
+    REQUIRE(h.length() == 0);
+    REQUIRE(h.add_P(PSTR("Content-Length"), 5));
+    REQUIRE(h.finish(0, 200, PSTR("OK")));
+    REQUIRE(head(h) == "HTTP/1.0 200 OK\r\nContent-Length: 5\r\n\r\n");
+}
+
+TEST_CASE("ResponseHeaders takes the start of the body", "[web][headers]")
+{
+    ResponseHeaders h;
+    h.finish(1, 200, PSTR("OK"));
+    REQUIRE(h.fill("hello", 5) == 5);
+    REQUIRE(head(h) == "HTTP/1.1 200 OK\r\n\r\nhello");
+
+    std::string body(2 * HTTP_HEADER_BUFLEN, 'x');
+    size_t before = h.length();
+    REQUIRE(h.fill_P(body.c_str(), body.size()) == HTTP_HEADER_BUFLEN - before);
+    REQUIRE(h.length() == HTTP_HEADER_BUFLEN);
+    REQUIRE(h.fill("y", 1) == 0);
+}
+
+TEST_CASE("ResponseHeaders grows for oversized headers", "[web][headers]")
+{
+    ResponseHeaders h;
+    String cookie;
+    for (int i = 0; i < HTTP_HEADER_BUFLEN; ++i) {
+        cookie += 'c';
+    }
+    REQUIRE(h.add("Set-Cookie", cookie));
+    REQUIRE(h.add_P(PSTR("Content-Type"), PSTR("text/plain"), true));
+    REQUIRE(h.finish(1, 200, PSTR("OK")));
+    std::string s = head(h);
+    REQUIRE(s.find("HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nSet-Cookie: ccc") == 0);
+    REQUIRE(s.size() == 17 + 26 + 12 + HTTP_HEADER_BUFLEN + 2 + 2);
+}
+
+// What _prepareHeader used to do for a typical response
+static String stringHead(int code, const String& contentType, size_t contentLength)
+{
+    String headers;
+    String line = String(F("Cache-Control"));
+    line += F(": ");
+    line += String(F("max-age=86400"));
+    line += "\r\n";
+    headers += line;
+    line = String(F("Content-Type"));
+    line += F(": ");
+    line += contentType;
+    line += "\r\n";
+    headers = line + headers;
+    line = String(F("Content-Length"));
+    line += F(": ");
+    line += String(contentLength);
+    line += "\r\n";
+    headers += line;
+    line = String(F("Connection"));
+    line += F(": ");
+    line += String(F("close"));
+    line += "\r\n";
+    headers += line;
+
+    String response = String(F("HTTP/1.")) + String(1) + ' ';
+    response += String(code);
+    response += ' ';
+    response += String(F("OK"));
+    response += "\r\n";
+    response += headers;
+    response += "\r\n";
+    return response;
+}
+
+TEST_CASE("ResponseHeaders does not allocate per response", "[web][headers][benchmark]")
+{
+    if (!mallocCounterEnabled()) {
+        return;
+    }
+    const int responses = 100;
+
+    size_t before = mallocCount();
+    size_t total = 0;
+    for (int i = 0; i < responses; ++i) {
+        total += stringHead(200, "text/html", 1000 + i).length();
+    }
+    size_t stringAllocs = mallocCount() - before;
+
+    ResponseHeaders h;
+    String cacheName("Cache-Control");
+    String cache("max-age=86400");
+    before = mallocCount();
+    size_t bufferTotal = 0;
+    for (int i = 0; i < responses; ++i) {
+        h.add(cacheName, cache);
+        h.add_P(PSTR("Content-Type"), PSTR("text/html"), true);
+        h.add_P(PSTR("Content-Length"), 1000 + i);
+        h.add_P(PSTR("Connection"), PSTR("close"));
+        h.finish(1, 200, PSTR("OK"));
+        bufferTotal += h.length();
+        h.clear();
+    }
+    size_t bufferAllocs = mallocCount() - before;
+
+    INFO("String: " << (double) stringAllocs / responses << " allocations per response");
+    INFO("ResponseHeaders: " << (double) bufferAllocs / responses << " allocations per response");
+    REQUIRE(bufferTotal == total);
+    REQUIRE(stringAllocs >= (size_t) responses);
+    REQUIRE(bufferAllocs == 0);
+}
@@ -0,0 +1,170 @@
+/*
+ test_accept_queue.cpp - WiFiServer accept queue tests against an lwIP stub
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include "../common/lwip_stub.h"
+#include <ClientContext.h>
+#include <AcceptQueue.h>
+
+struct Listener {
+    AcceptQueue<ClientContext> queue;
+    std::vector<tcp_pcb*> pcbs;
+    size_t discarded;
+
+    Listener() : queue(&Listener::_s_discard, this), discarded(0)
+    {
+    }
+
+    ~Listener()
+    {
+        queue.clear();
+        for (tcp_pcb* pcb : pcbs) {
+            lwip_stub_pcb_free(pcb);
+        }
+    }
+
+    // A peer connects; returns its pcb, CLOSED if the connection was reset
+    tcp_pcb* connect()
+    {
+        tcp_pcb* pcb = lwip_stub_accept(&Listener::_s_accept, this);
+        pcbs.push_back(pcb);
+        return pcb;
+    }
+
+    // Same as WiFiServer::_accept
+    static err_t _s_accept(void* arg, tcp_pcb* newpcb, err_t)
+    {
+        Listener* self = reinterpret_cast<Listener*>(arg);
+        return self->queue.push(newpcb) ? ERR_OK : ERR_MEM;
+    }
+
+    static void _s_discard(void* arg, ClientContext*)
+    {
+        ++reinterpret_cast<Listener*>(arg)->discarded;
+    }
+};
+
+struct Segment {
+    std::string data;
+    pbuf p;
+
+    Segment(const std::string& s) : data(s)
+    {
+        p.payload = &data[0];
+        p.len = p.tot_len = data.size();
+    }
+};
+
+TEST_CASE("AcceptQueue hands out connections in order", "[wifi][server]")
+{
+    Listener l;
+    l.queue.setBacklog(0);
+    std::vector<tcp_pcb*> pcbs;
+    for (int i = 0; i < 20; ++i) {
+        pcbs.push_back(l.connect());
+    }
+    REQUIRE(l.queue.size() == 20);
+    REQUIRE(l.queue.accepted() == 20);
+    for (tcp_pcb* pcb : pcbs) {
+        ClientContext* ctx = l.queue.pop();
+        REQUIRE(ctx);
+        ctx->ref();
+        REQUIRE(pcb->callback_arg == ctx);
+        ctx->unref();
+        REQUIRE(pcb->state == FIN_WAIT_1);
+    }
+    REQUIRE(l.queue.empty());
+    REQUIRE(l.queue.size() == 0);
+    REQUIRE(l.queue.pop() == nullptr);
+    REQUIRE(l.discarded == 20);
+    // the tail is still right after the queue ran empty
+    tcp_pcb* last = l.connect();
+    ClientContext* ctx = l.queue.pop();
+    REQUIRE(last->callback_arg == ctx);
+    ctx->ref();
+    ctx->unref();
+}
+
+TEST_CASE("AcceptQueue makes room by resetting the oldest idle connection", "[wifi][server]")
+{
+    Listener l;
+    l.queue.setBacklog(3);
+    tcp_pcb* busy = l.connect();
+    tcp_pcb* idle1 = l.connect();
+    tcp_pcb* idle2 = l.connect();
+    Segment request("GET / HTTP/1.1\r\n\r\n");
+    lwip_stub_receive(busy, &request.p);
+
+    tcp_pcb* fresh = l.connect();
+    REQUIRE(fresh->state == ESTABLISHED);
+    REQUIRE(idle1->state == CLOSED);
+    REQUIRE(idle2->state == ESTABLISHED);
+    REQUIRE(busy->state == ESTABLISHED);
+    REQUIRE(l.queue.size() == 3);
+    REQUIRE(l.queue.evicted() == 1);
+    REQUIRE(l.discarded == 1);
+
+    ClientContext* ctx = l.queue.pop();
+    REQUIRE(ctx->getSize() == request.data.size());
+    ctx->ref();
+    ctx->unref();
+    ctx = l.queue.pop();
+    REQUIRE(ctx->getSize() == 0);
+    ctx->ref();
+    ctx->unref();
+    // the evicted entry in the middle left the list intact up to the tail
+    ClientContext* last = l.queue.pop();
+    REQUIRE(fresh->callback_arg == last);
+    REQUIRE(l.queue.empty());
+    last->ref();
+    last->unref();
+}
+
+TEST_CASE("AcceptQueue turns new connections away when every client has data", "[wifi][server]")
+{
+    // outlives the contexts holding on to it
+    Segment a("a"), b("b");
+    Listener l;
+    l.queue.setBacklog(2);
+    lwip_stub_receive(l.connect(), &a.p);
+    lwip_stub_receive(l.connect(), &b.p);
+    for (int i = 0; i < 10; ++i) {
+        tcp_pcb* pcb = l.connect();
+        REQUIRE(pcb->state == CLOSED);
+        REQUIRE(lwip_stub_closed_by_abort);
+    }
+    REQUIRE(l.queue.size() == 2);
+    REQUIRE(l.queue.accepted() == 2);
+    REQUIRE(l.queue.rejected() == 10);
+    REQUIRE(l.queue.evicted() == 0);
+    // nothing was ever allocated for the rejected ones
+    REQUIRE(l.discarded == 0);
+}
+
+TEST_CASE("AcceptQueue resets waiting connections when cleared", "[wifi][server]")
+{
+    Listener l;
+    tcp_pcb* first = l.connect();
+    tcp_pcb* second = l.connect();
+    l.queue.clear();
+    REQUIRE(first->state == CLOSED);
+    REQUIRE(second->state == CLOSED);
+    REQUIRE(l.queue.empty());
+    REQUIRE(l.discarded == 2);
+    // unlimited unless asked for
+    REQUIRE(l.queue.getBacklog() == 0);
+}
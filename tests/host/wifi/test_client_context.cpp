@@ -0,0 +1,589 @@
+/*
+ test_client_context.cpp - TCP send path tests against an lwIP stub
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include "../common/lwip_stub.h"
+#include "../common/malloc_counter.h"
+#include <ClientContext.h>
+
+static std::string pattern(size_t len)
+{
+    std::string s(len, 0);
+    for (size_t i = 0; i < len; ++i) {
+        s[i] = (char) (i * 7 + i / 251);
+    }
+    return s;
+}
+
+struct Connection {
+    tcp_pcb* pcb;
+    ClientContext* ctx;
+
+    Connection()
+    {
+        pcb = lwip_stub_pcb_new();
+        ctx = new ClientContext(pcb, nullptr, nullptr);
+        ctx->ref();
+    }
+
+    ~Connection()
+    {
+        if (ctx) {
+            ctx->unref();
+        }
+        lwip_stub_pcb_free(pcb);
+    }
+
+    void close()
+    {
+        ctx->unref();
+        ctx = nullptr;
+    }
+};
+
+TEST_CASE("ClientContext copies writes in whole segments", "[wifi][tcp]")
+{
+    Connection c;
+    std::string data = pattern(10000);
+    REQUIRE(c.ctx->write((const uint8_t*) data.data(), data.size()) == data.size());
+    esp_yield();
+    REQUIRE(c.pcb->received == data);
+    REQUIRE(c.pcb->copied == data.size());
+    REQUIRE(c.pcb->referenced == 0);
+    // one tcp_write per segment rather than per 256 bytes
+    REQUIRE(c.pcb->writes == (data.size() + TCP_MSS - 1) / TCP_MSS);
+    REQUIRE(c.pcb->segments == c.pcb->writes);
+}
+
+TEST_CASE("ClientContext copies PROGMEM writes", "[wifi][tcp]")
+{
+    Connection c;
+    static const char text[] PROGMEM = "flash is not byte addressable by the MAC";
+    REQUIRE(c.ctx->write_P(text, sizeof(text) - 1) == sizeof(text) - 1);
+    esp_yield();
+    REQUIRE(c.pcb->received == text);
+    REQUIRE(c.pcb->copied == sizeof(text) - 1);
+}
+
+TEST_CASE("ClientContext references no-copy writes until acknowledged", "[wifi][tcp]")
+{
+    Connection c;
+    c.pcb->auto_ack = false;
+    std::string data = pattern(1000);
+    std::string buf = data;
+    int released = 0;
+    REQUIRE(c.ctx->write_nocopy((const uint8_t*) buf.data(), buf.size(), [&]() { ++released; }) == buf.size());
+    REQUIRE(c.pcb->copied == 0);
+    REQUIRE(c.pcb->referenced == buf.size());
+    REQUIRE(released == 0);
+
+    lwip_stub_ack(c.pcb, 999);
+    run_scheduled_functions();
+    REQUIRE(released == 0);
+    lwip_stub_ack(c.pcb, 1);
+    // called from the scheduler, not from the network stack
+    REQUIRE(released == 0);
+    run_scheduled_functions();
+    REQUIRE(released == 1);
+    REQUIRE(c.pcb->received == data);
+}
+
+TEST_CASE("ClientContext sends large no-copy writes", "[wifi][tcp]")
+{
+    Connection c;
+    std::string data = pattern(20000);
+    std::string buf = data;
+    int released = 0;
+    REQUIRE(c.ctx->write_nocopy((const uint8_t*) buf.data(), buf.size(), [&]() { ++released; }) == buf.size());
+    esp_yield();
+    run_scheduled_functions();
+    REQUIRE(released == 1);
+    // reusing the buffer after the release does not change what was sent
+    buf.assign(buf.size(), 'x');
+    REQUIRE(c.pcb->received == data);
+    REQUIRE(c.pcb->copied == 0);
+    REQUIRE(c.pcb->writes == (data.size() + TCP_MSS - 1) / TCP_MSS);
+}
+
+TEST_CASE("ClientContext releases no-copy data in order", "[wifi][tcp]")
+{
+    Connection c;
+    c.pcb->auto_ack = false;
+    std::string first = pattern(300);
+    std::string second = pattern(200);
+    std::string order;
+    c.ctx->write_nocopy((const uint8_t*) first.data(), first.size(), [&]() { order += '1'; });
+    c.ctx->write((const uint8_t*) "copied", 6);
+    c.ctx->write_nocopy((const uint8_t*) second.data(), second.size(), [&]() { order += '2'; });
+    lwip_stub_ack(c.pcb, 305);
+    run_scheduled_functions();
+    REQUIRE(order == "1");
+    lwip_stub_ack(c.pcb, 200);
+    run_scheduled_functions();
+    REQUIRE(order == "1");
+    lwip_stub_ack(c.pcb, 1);
+    run_scheduled_functions();
+    REQUIRE(order == "12");
+    REQUIRE(c.pcb->received == first + "copied" + second);
+}
+
+TEST_CASE("ClientContext waits for no-copy data before closing", "[wifi][tcp]")
+{
+    SECTION("acknowledged") {
+        Connection c;
+        std::string buf = pattern(100);
+        int released = 0;
+        c.pcb->auto_ack = false;
+        c.ctx->write_nocopy((const uint8_t*) buf.data(), buf.size(), [&]() { ++released; });
+        REQUIRE(released == 0);
+        c.pcb->auto_ack = true;
+        c.close();
+        REQUIRE(released == 1);
+        REQUIRE(lwip_stub_closed_pcb == c.pcb);
+        REQUIRE_FALSE(lwip_stub_closed_by_abort);
+    }
+    SECTION("never acknowledged") {
+        Connection c;
+        std::string buf = pattern(100);
+        int released = 0;
+        c.pcb->auto_ack = false;
+        c.ctx->setTimeout(10);
+        c.ctx->write_nocopy((const uint8_t*) buf.data(), buf.size(), [&]() { ++released; });
+        c.close();
+        // the connection is aborted so that lwIP drops its references
+        REQUIRE(released == 1);
+        REQUIRE(lwip_stub_closed_pcb == c.pcb);
+        REQUIRE(lwip_stub_closed_by_abort);
+    }
+}
+
+TEST_CASE("ClientContext survives a release callback dropping its last owner", "[wifi][tcp]")
+{
+    tcp_pcb* pcb = lwip_stub_pcb_new();
+    pcb->auto_ack = false;
+    ClientContext* ctx = new ClientContext(pcb, nullptr, nullptr);
+    ctx->ref();
+    // the callback holds the only reference, as a captured WiFiClient would
+    std::shared_ptr<ClientContext> owner(ctx, [](ClientContext* c) { c->unref(); });
+    std::string data = pattern(100);
+    bool released = false;
+    std::function<void()> callback = [owner, &released]() { released = true; };
+    ctx->write_nocopy((const uint8_t*) data.data(), data.size(), callback);
+    callback = nullptr;
+    owner.reset();
+
+    lwip_stub_ack(pcb, data.size());
+    REQUIRE_FALSE(released);
+    // closing may wait for the peer, so it is not done from the stack
+    REQUIRE(lwip_stub_closed_pcb != pcb);
+    run_scheduled_functions();
+    REQUIRE(released);
+    REQUIRE(lwip_stub_closed_pcb == pcb);
+    lwip_stub_pcb_free(pcb);
+}
+
+TEST_CASE("ClientContext queues async writes without waiting", "[wifi][tcp]")
+{
+    Connection c;
+    c.pcb->auto_ack = false;
+    std::string data = pattern(9000);
+    std::vector<int> done;
+    auto write = [&](size_t from, size_t len, int id) {
+        return c.ctx->write_async((const uint8_t*) data.data() + from, len, [&done, id](bool ok) {
+            REQUIRE(ok);
+            done.push_back(id);
+        });
+    };
+
+    REQUIRE(c.ctx->availableForWriteAsync() == TCP_SND_BUF);
+    REQUIRE(write(0, 2000, 1) == 2000);
+    // lwIP took it all, the queue is empty again
+    REQUIRE(c.ctx->availableForWriteAsync() == TCP_SND_BUF);
+    // while availableForWrite() still tells what lwIP takes
+    REQUIRE(c.ctx->availableForWrite() == TCP_SND_BUF - 2000);
+    REQUIRE(write(2000, 2000, 2) == 2000);
+    REQUIRE(c.ctx->availableForWriteAsync() == TCP_SND_BUF - (4000 - TCP_SND_BUF));
+    // the queue is full: accepted in part, never waiting for the peer
+    size_t room = c.ctx->availableForWriteAsync();
+    REQUIRE(write(4000, 5000, 3) == room);
+    REQUIRE(c.ctx->availableForWriteAsync() == 0);
+    REQUIRE(write(4000 + room, 10, 4) == 0);
+    REQUIRE(done.empty());
+
+    // acknowledgements drain the queue from the sent callback
+    lwip_stub_ack(c.pcb, 2000);
+    run_scheduled_functions();
+    REQUIRE(done == std::vector<int>{1});
+    REQUIRE(c.ctx->availableForWriteAsync() > 0);
+    while (c.pcb->unacked) {
+        lwip_stub_ack(c.pcb, 1000);
+    }
+    run_scheduled_functions();
+    REQUIRE(done == (std::vector<int>{1, 2, 3}));
+    REQUIRE(c.ctx->availableForWriteAsync() == TCP_SND_BUF);
+    REQUIRE(c.pcb->received == data.substr(0, 4000 + room));
+}
+
+TEST_CASE("ClientContext keeps async and blocking writes in order", "[wifi][tcp]")
+{
+    Connection c;
+    std::string data = pattern(6000);
+    REQUIRE(c.ctx->write_async((const uint8_t*) data.data(), 4000) == 4000);
+    REQUIRE(c.ctx->write((const uint8_t*) data.data() + 4000, 2000) == 2000);
+    esp_yield();
+    REQUIRE(c.pcb->received == data);
+}
+
+TEST_CASE("ClientContext fails pending async writes on abort", "[wifi][tcp]")
+{
+    Connection c;
+    c.pcb->auto_ack = false;
+    std::string data = pattern(4000);
+    int failed = 0;
+    REQUIRE(c.ctx->write_async((const uint8_t*) data.data(), data.size(), [&](bool ok) {
+        if (!ok) {
+            ++failed;
+        }
+    }) == data.size());
+    c.ctx->abort();
+    run_scheduled_functions();
+    REQUIRE(failed == 1);
+    REQUIRE(c.ctx->availableForWriteAsync() == 0);
+    REQUIRE(c.ctx->write_async((const uint8_t*) data.data(), 10) == 0);
+}
+
+TEST_CASE("ClientContext sends queued async data before closing", "[wifi][tcp]")
+{
+    Connection c;
+    c.pcb->auto_ack = false;
+    std::string data = pattern(6000);
+    std::vector<bool> done;
+    REQUIRE(c.ctx->write_async((const uint8_t*) data.data(), 3000, [&](bool ok) { done.push_back(ok); }) == 3000);
+    size_t accepted = 3000 + c.ctx->write_async((const uint8_t*) data.data() + 3000, 3000);
+    REQUIRE(accepted > 3000);
+    REQUIRE(c.ctx->availableForWriteAsync() < TCP_SND_BUF);
+    // the peer acknowledges as the close waits
+    c.pcb->auto_ack = true;
+    c.close();
+    REQUIRE(done == std::vector<bool>{true});
+    REQUIRE(c.pcb->received == data.substr(0, accepted));
+    REQUIRE(lwip_stub_closed_pcb == c.pcb);
+    REQUIRE_FALSE(lwip_stub_closed_by_abort);
+}
+
+TEST_CASE("ClientContext tells when what was written is acknowledged", "[wifi][tcp]")
+{
+    Connection c;
+    c.pcb->auto_ack = false;
+    std::vector<bool> done;
+    auto notify = [&]() { c.ctx->notify_acked([&](bool ok) { done.push_back(ok); }); };
+    notify();
+    REQUIRE(done == std::vector<bool>{true});
+    std::string data = pattern(1000);
+    c.ctx->write_nocopy((const uint8_t*) data.data(), data.size());
+    notify();
+    REQUIRE(done.size() == 1);
+    lwip_stub_ack(c.pcb, 600);
+    run_scheduled_functions();
+    REQUIRE(done.size() == 1);
+    lwip_stub_ack(c.pcb, 400);
+    run_scheduled_functions();
+    REQUIRE(done == (std::vector<bool>{true, true}));
+    c.ctx->write_nocopy((const uint8_t*) data.data(), data.size());
+    notify();
+    c.ctx->abort();
+    run_scheduled_functions();
+    REQUIRE(done == (std::vector<bool>{true, true, false}));
+}
+
+TEST_CASE("ClientContext lets completion callbacks stop the client", "[wifi][tcp]")
+{
+    Connection c;
+    c.pcb->auto_ack = false;
+    std::string data = pattern(3000);
+    std::vector<bool> done;
+    // stopping waits for the second write, which cannot be done from the
+    // network stack
+    c.ctx->write_async((const uint8_t*) data.data(), 1000, [&](bool ok) {
+        done.push_back(ok);
+        c.pcb->auto_ack = true;
+        c.ctx->close();
+    });
+    c.ctx->write_async((const uint8_t*) data.data() + 1000, 2000, [&](bool ok) { done.push_back(ok); });
+    lwip_stub_ack(c.pcb, 1000);
+    REQUIRE(done.empty());
+    run_scheduled_functions();
+    REQUIRE(done == (std::vector<bool>{true, true}));
+    REQUIRE(c.pcb->received == data);
+    REQUIRE(lwip_stub_closed_pcb == c.pcb);
+    REQUIRE_FALSE(lwip_stub_closed_by_abort);
+}
+
+// Serves len bytes of 'a'..'z' through Stream, without allocating
+class LetterStream : public Stream {
+public:
+    void reset(size_t len) { _left = len; }
+    int available() override { return _left; }
+    int read() override { return _left ? 'a' + --_left % 26 : -1; }
+    int peek() override { return _left ? 'a' + (_left - 1) % 26 : -1; }
+    void flush() override { }
+    size_t write(uint8_t) override { return 0; }
+
+protected:
+    size_t _left = 0;
+};
+
+TEST_CASE("ClientContext writes without allocating", "[wifi][tcp][benchmark]")
+{
+    if (!mallocCounterEnabled()) {
+        return;
+    }
+    static const char text[] PROGMEM = "HTTP/1.1 200 OK\r\n";
+    const uint8_t line[] = "Content-Length: 5\r\n";
+    LetterStream stream;
+
+    Connection c;
+    // the first copying write sets up the staging buffer of the connection
+    c.ctx->write_P(text, sizeof(text) - 1);
+
+    size_t before = mallocCount();
+    for (int i = 0; i < 100; ++i) {
+        c.ctx->write(line, sizeof(line) - 1);
+        c.ctx->write_P(text, sizeof(text) - 1);
+        stream.reset(1 + i * 37);
+        c.ctx->write(stream);
+        esp_yield();
+    }
+    size_t allocs = mallocCount() - before;
+    INFO(allocs << " allocations for 300 writes");
+    REQUIRE(allocs == 0);
+    REQUIRE(c.pcb->unacked == 0);
+}
+
+TEST_CASE("ClientContext gathers IOVec pieces into shared segments", "[wifi][tcp]")
+{
+    std::string header = "PUBLISH topic/with/a/name ";
+    std::string payload = pattern(2500);
+    std::string trailer = "\r\n";
+    IOVec iov[] = {
+        { header.data(), header.size() },
+        { nullptr, 0 },
+        { payload.data(), payload.size() },
+        { trailer.data(), trailer.size() },
+    };
+    size_t total = header.size() + payload.size() + trailer.size();
+
+    Connection separate;
+    separate.pcb->auto_ack = false;
+    for (auto& piece : iov) {
+        separate.ctx->write((const uint8_t*) piece.base, piece.len);
+    }
+
+    Connection gathered;
+    gathered.pcb->auto_ack = false;
+    REQUIRE(gathered.ctx->write(iov, 4) == total);
+    // no more segments than the bytes need, fewer than one write per piece
+    REQUIRE(gathered.pcb->segments == (total + TCP_MSS - 1) / TCP_MSS);
+    REQUIRE(gathered.pcb->segments < separate.pcb->segments);
+    lwip_stub_ack(gathered.pcb, total);
+    REQUIRE(gathered.pcb->received == header + payload + trailer);
+}
+
+TEST_CASE("ClientContext gathers many small IOVec pieces", "[wifi][tcp]")
+{
+    Connection c;
+    std::string data = pattern(5000);
+    std::vector<IOVec> iov;
+    for (size_t pos = 0; pos < data.size(); pos += 7) {
+        iov.push_back({ data.data() + pos, std::min<size_t>(7, data.size() - pos) });
+    }
+    REQUIRE(c.ctx->write(iov.data(), iov.size()) == data.size());
+    esp_yield();
+    REQUIRE(c.pcb->received == data);
+    REQUIRE(c.pcb->writes == (data.size() + TCP_MSS - 1) / TCP_MSS);
+}
+
+// A received segment, owned by the test
+struct Segment {
+    std::string data;
+    pbuf p;
+
+    Segment(const std::string& s) : data(s)
+    {
+        p.next = nullptr;
+        p.payload = &data[0];
+        p.len = p.tot_len = data.size();
+    }
+};
+
+TEST_CASE("ClientContext delivers received data from the scheduler", "[wifi][tcp]")
+{
+    Connection c;
+    std::string got;
+    size_t calls = 0;
+    c.ctx->on_data([&](const uint8_t* data, size_t len) {
+        ++calls;
+        got.append((const char*) data, len);
+        return len;
+    });
+    Segment first("hello, "), second("world");
+    lwip_stub_receive(c.pcb, &first.p);
+    lwip_stub_receive(c.pcb, &second.p);
+    // nothing runs from the network stack itself
+    REQUIRE(calls == 0);
+    run_scheduled_functions();
+    // one call per piece, both in a single scheduled dispatch
+    REQUIRE(calls == 2);
+    REQUIRE(got == "hello, world");
+    REQUIRE(c.ctx->getSize() == 0);
+    run_scheduled_functions();
+    REQUIRE(calls == 2);
+}
+
+TEST_CASE("ClientContext keeps data the handler does not consume", "[wifi][tcp]")
+{
+    Connection c;
+    std::string got;
+    c.ctx->on_data([&](const uint8_t* data, size_t len) {
+        size_t n = len < 3 ? len : 3;
+        got.append((const char*) data, n);
+        return n;
+    });
+    Segment seg("abcdefgh");
+    lwip_stub_receive(c.pcb, &seg.p);
+    run_scheduled_functions();
+    REQUIRE(got == "abc");
+    REQUIRE(c.ctx->getSize() == 5);
+    char rest[8];
+    REQUIRE(c.ctx->read(rest, sizeof(rest)) == 5);
+    REQUIRE(std::string(rest, 5) == "defgh");
+}
+
+TEST_CASE("ClientContext reports acks and disconnects", "[wifi][tcp]")
+{
+    Connection c;
+    c.pcb->auto_ack = false;
+    size_t acked = 0;
+    std::string got;
+    std::string order;
+    c.ctx->on_ack([&](size_t len) { acked += len; });
+    c.ctx->on_data([&](const uint8_t* data, size_t len) {
+        order += 'd';
+        got.append((const char*) data, len);
+        return len;
+    });
+    c.ctx->on_disconnect([&]() { order += 'x'; });
+
+    std::string data = pattern(1000);
+    REQUIRE(c.ctx->write_async((const uint8_t*) data.data(), data.size()) == data.size());
+    lwip_stub_ack(c.pcb, 400);
+    lwip_stub_ack(c.pcb, 600);
+    REQUIRE(acked == 0);
+    run_scheduled_functions();
+    REQUIRE(acked == 1000);
+
+    // data that arrived before the close is delivered first
+    Segment seg("bye");
+    lwip_stub_receive(c.pcb, &seg.p);
+    lwip_stub_remote_close(c.pcb);
+    run_scheduled_functions();
+    REQUIRE(got == "bye");
+    REQUIRE(order == "dx");
+}
+
+TEST_CASE("ClientContext outlives its owner until events are dispatched", "[wifi][tcp]")
+{
+    Connection c;
+    bool disconnected = false;
+    c.ctx->on_disconnect([&]() { disconnected = true; });
+    lwip_stub_error(c.pcb, ERR_ABRT);
+    c.close();
+    run_scheduled_functions();
+    REQUIRE(disconnected);
+}
+
+TEST_CASE("ClientContext handlers may stop the client", "[wifi][tcp]")
+{
+    Connection c;
+    std::string tag = "captured by the handler";
+    std::string got;
+    size_t calls = 0;
+    c.ctx->on_data([&c, &got, &calls, tag](const uint8_t* data, size_t len) {
+        ++calls;
+        c.ctx->close();
+        // the handler and what it captured outlive the close
+        got = tag + ": " + std::string((const char*) data, len);
+        return len;
+    });
+    bool disconnected = false;
+    c.ctx->on_disconnect([&]() { disconnected = true; });
+    Segment first("one"), second("two");
+    lwip_stub_receive(c.pcb, &first.p);
+    lwip_stub_receive(c.pcb, &second.p);
+    run_scheduled_functions();
+    REQUIRE(got == "captured by the handler: one");
+    // nothing is delivered after the close
+    REQUIRE(calls == 1);
+    REQUIRE_FALSE(disconnected);
+}
+
+TEST_CASE("ClientContext reads across pbufs in one pass", "[wifi][tcp]")
+{
+    Connection c;
+    Segment a("0123456789"), b("abcdefghij"), d("ABCDEFGHIJ");
+    lwip_stub_receive(c.pcb, &a.p);
+    lwip_stub_receive(c.pcb, &b.p);
+    lwip_stub_receive(c.pcb, &d.p);
+    REQUIRE(c.ctx->getSize() == 30);
+    char buf[32];
+    REQUIRE(c.ctx->read(buf, 25) == 25);
+    REQUIRE(std::string(buf, 25) == "0123456789abcdefghijABCDE");
+    // the two emptied pbufs are acknowledged together
+    REQUIRE(c.pcb->recved_calls == 1);
+    REQUIRE(c.pcb->recved == 20);
+    REQUIRE(c.ctx->getSize() == 5);
+    REQUIRE(c.ctx->read(buf, sizeof(buf)) == 5);
+    REQUIRE(std::string(buf, 5) == "FGHIJ");
+    REQUIRE(c.pcb->recved == 30);
+    REQUIRE(c.ctx->getSize() == 0);
+}
+
+TEST_CASE("ClientContext keeps the window within the receive limit", "[wifi][tcp]")
+{
+    Connection c;
+    const size_t limit = TCP_MSS;
+    c.ctx->set_rx_limit(limit);
+    Segment first(std::string(3000, 'a')), second(std::string(2000, 'b'));
+    // segments are never refused, the limit only acts on the window
+    REQUIRE(lwip_stub_receive(c.pcb, &first.p) == ERR_OK);
+    REQUIRE(lwip_stub_receive(c.pcb, &second.p) == ERR_OK);
+    REQUIRE(c.ctx->getSize() == 5000);
+    // the window stays closed for what was read, up to TCP_WND - limit
+    char buf[3000];
+    REQUIRE(c.ctx->read(buf, 3000) == 3000);
+    REQUIRE(c.pcb->recved == 0);
+    REQUIRE(c.ctx->read(buf, 2000) == 2000);
+    REQUIRE(c.pcb->recved == 5000 - (TCP_WND - limit));
+    // from then on, what is read reopens the window
+    Segment third(std::string(limit, 'c'));
+    REQUIRE(lwip_stub_receive(c.pcb, &third.p) == ERR_OK);
+    c.ctx->discard_received();
+    REQUIRE(c.pcb->recved == 5000 + limit - (TCP_WND - limit));
+    // lifting the limit gives the rest back
+    c.ctx->set_rx_limit(0);
+    REQUIRE(c.pcb->recved == 5000 + limit);
+}
@@ -0,0 +1,129 @@
+/*
+ test_scan_table.cpp - WiFi scan result table tests
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <Arduino.h>
+#include <ScanTable.h>
+#include "../common/malloc_counter.h"
+
+static WiFiScanEntry network(const char* ssid, int8_t rssi)
+{
+    WiFiScanEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    strncpy(entry.ssid, ssid, sizeof(entry.ssid) - 1);
+    entry.rssi = rssi;
+    entry.bssid[5] = (uint8_t) rssi;
+    return entry;
+}
+
+// What _scanDone() does with the SDK's list
+static bool scan(ScanTable& table, const std::vector<WiFiScanEntry>& found)
+{
+    size_t count = 0;
+    for (const auto& entry : found) {
+        count += table.accepts(entry.ssid, entry.rssi);
+    }
+    if (!table.begin(count)) {
+        return false;
+    }
+    for (const auto& entry : found) {
+        if (table.accepts(entry.ssid, entry.rssi)) {
+            table.add(entry);
+        }
+    }
+    return true;
+}
+
+static std::vector<std::string> ssids(const ScanTable& table)
+{
+    std::vector<std::string> out;
+    for (size_t i = 0; i < table.size(); ++i) {
+        out.push_back(table.get(i)->ssid);
+    }
+    return out;
+}
+
+TEST_CASE("ScanTable keeps every network without a filter", "[wifi][scan]")
+{
+    ScanTable table;
+    REQUIRE(scan(table, { network("office", -60), network("guest", -85), network("", -70) }));
+    REQUIRE(ssids(table) == std::vector<std::string>({ "office", "guest", "" }));
+    REQUIRE(table.get(1)->rssi == -85);
+    REQUIRE(table.get(3) == nullptr);
+    table.clear();
+    REQUIRE(table.size() == 0);
+}
+
+TEST_CASE("ScanTable filters by signal and SSID", "[wifi][scan]")
+{
+    static const char* const wanted[] = { "office", "lab" };
+    ScanTable table;
+    table.setFilter(-80, wanted, 2, 0);
+    REQUIRE(scan(table, {
+        network("office", -60), network("guest", -50), network("lab", -90),
+        network("lab", -75), network("office", -80),
+    }));
+    REQUIRE(ssids(table) == std::vector<std::string>({ "office", "lab", "office" }));
+}
+
+TEST_CASE("ScanTable keeps the strongest networks", "[wifi][scan]")
+{
+    ScanTable table;
+    table.setFilter(-128, nullptr, 0, 3);
+    std::vector<WiFiScanEntry> found;
+    for (int i = 0; i < 40; ++i) {
+        found.push_back(network("ap", (int8_t) (-90 + (i * 17) % 50)));
+    }
+    REQUIRE(scan(table, found));
+    REQUIRE(table.size() == 3);
+    std::vector<int> rssi;
+    for (size_t i = 0; i < table.size(); ++i) {
+        rssi.push_back(table.get(i)->rssi);
+    }
+    std::sort(rssi.begin(), rssi.end());
+    REQUIRE(rssi == std::vector<int>({ -46, -45, -44 }));
+}
+
+TEST_CASE("ScanTable reuses its memory between scans", "[wifi][scan][benchmark]")
+{
+    if (!mallocCounterEnabled()) {
+        return;
+    }
+    std::vector<WiFiScanEntry> found;
+    for (int i = 0; i < 45; ++i) {
+        found.push_back(network("site", (int8_t) (-40 - i)));
+    }
+    const int scans = 20;
+
+    ScanTable table;
+    table.setFilter(-128, nullptr, 0, 10);
+    REQUIRE(scan(table, found));
+    table.clear();
+    // no REQUIRE in the loop, it allocates
+    int done = 0;
+    size_t before = mallocCount();
+    for (int i = 0; i < scans; ++i) {
+        done += scan(table, found) && table.size() == 10;
+        table.clear();
+    }
+    size_t allocs = mallocCount() - before;
+
+    INFO("ScanTable: " << (double) allocs / scans << " allocations per scan");
+    REQUIRE(done == scans);
+    REQUIRE(allocs == 0);
+    REQUIRE(sizeof(WiFiScanEntry) <= 44);
+}
@@ -0,0 +1,197 @@
+/*
+ test_udp_context.cpp - UDP send path tests against an lwIP stub
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+*/
+
+#include <catch.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include "../common/lwip_stub.h"
+#include "../common/malloc_counter.h"
+#include <IOVec.h>
+#include <UdpContext.h>
+
+struct Udp {
+    UdpContext* ctx;
+    udp_pcb* pcb;
+
+    Udp()
+    {
+        ctx = new UdpContext;
+        ctx->ref();
+        pcb = lwip_stub_udp_pcb;
+        ip_addr_t addr = { 0x0100000a };
+        ctx->connect(addr, 53);
+    }
+
+    ~Udp()
+    {
+        ctx->unref();
+    }
+};
+
+static std::string datagram(size_t len)
+{
+    std::string s(len, 0);
+    for (size_t i = 0; i < len; ++i) {
+        s[i] = (char) ('a' + i % 26);
+    }
+    return s;
+}
+
+TEST_CASE("UdpContext sends a reserved packet without copying it", "[wifi][udp]")
+{
+    Udp u;
+    std::string data = datagram(700);
+    size_t before = mallocCount();
+    bool reserved = u.ctx->reserve(data.size() + 100);
+    size_t appended = u.ctx->append(data.data(), 300);
+    appended += u.ctx->append(data.data() + 300, 400);
+    bool sent = u.ctx->send();
+    size_t allocations = mallocCount() - before;
+    REQUIRE(reserved);
+    REQUIRE(appended == data.size());
+    REQUIRE(sent);
+    if (mallocCounterEnabled()) {
+        // the reserved pbuf is the datagram
+        REQUIRE(allocations == 1);
+    }
+    REQUIRE(u.pcb->datagrams == 1);
+    REQUIRE(u.pcb->chained == 0);
+    // trimmed to what was written
+    REQUIRE(u.pcb->sent == data);
+}
+
+TEST_CASE("UdpContext sends a grown packet in one piece", "[wifi][udp]")
+{
+    Udp u;
+    std::string data = datagram(1000);
+    for (size_t i = 0; i < data.size(); i += 10) {
+        REQUIRE(u.ctx->append(data.data() + i, 10) == 10);
+    }
+    REQUIRE(u.ctx->send());
+    REQUIRE(u.pcb->datagrams == 1);
+    REQUIRE(u.pcb->chained == 0);
+    REQUIRE(u.pcb->sent == data);
+}
+
+TEST_CASE("UdpContext sends small and empty packets", "[wifi][udp]")
+{
+    Udp u;
+    REQUIRE(u.ctx->append("ping", 4) == 4);
+    REQUIRE(u.ctx->send());
+    REQUIRE(u.ctx->send());
+    REQUIRE(u.pcb->datagrams == 2);
+    REQUIRE(u.pcb->sent == "ping");
+}
+
+static void receive(Udp& u, const std::string& data, uint32_t src, uint16_t port)
+{
+    lwip_stub_udp_receive(u.pcb, lwip_stub_udp_datagram(data.data(), data.size(), 0x0a01a8c0), src, port);
+}
+
+static std::string readAll(UdpContext* ctx)
+{
+    std::string s(ctx->getSize(), 0);
+    ctx->read(&s[0], s.size());
+    return s;
+}
+
+TEST_CASE("UdpContext queues received datagrams with their origin", "[wifi][udp]")
+{
+    Udp u;
+    ip_addr_t any = { 0 };
+    REQUIRE(u.ctx->listen(any, 5000));
+    receive(u, "first", 0x0200000a, 1000);
+    receive(u, "second", 0x0300000a, 2000);
+    REQUIRE(u.ctx->getRxQueued() == 2);
+
+    REQUIRE(u.ctx->next());
+    REQUIRE(u.ctx->getRemoteAddress() == 0x0200000a);
+    REQUIRE(u.ctx->getRemotePort() == 1000);
+    REQUIRE(u.ctx->getDestAddress() == 0x0a01a8c0);
+    REQUIRE(readAll(u.ctx) == "first");
+    // arriving while a datagram is read does not disturb it
+    receive(u, "third", 0x0400000a, 3000);
+    REQUIRE(u.ctx->getRemotePort() == 1000);
+
+    REQUIRE(u.ctx->next());
+    REQUIRE(u.ctx->getRemotePort() == 2000);
+    REQUIRE(u.ctx->peek() == 's');
+    REQUIRE(u.ctx->next());
+    REQUIRE(u.ctx->getRemoteAddress() == 0x0400000a);
+    REQUIRE(readAll(u.ctx) == "third");
+    REQUIRE_FALSE(u.ctx->next());
+    REQUIRE(u.ctx->getSize() == 0);
+}
+
+TEST_CASE("UdpContext drops datagrams beyond the queue length", "[wifi][udp]")
+{
+    Udp u;
+    ip_addr_t any = { 0 };
+    REQUIRE(u.ctx->listen(any, 5000));
+    for (int i = 0; i < UDP_RX_QUEUE_LEN + 3; ++i) {
+        receive(u, std::string(1, 'a' + i), 0x0200000a, 1000 + i);
+    }
+    REQUIRE(u.ctx->getRxQueued() == UDP_RX_QUEUE_LEN);
+    REQUIRE(u.ctx->getRxDropped() == 3);
+    // the oldest are kept
+    REQUIRE(u.ctx->next());
+    REQUIRE(readAll(u.ctx) == "a");
+    // a free slot takes the next one again
+    receive(u, "z", 0x0200000a, 999);
+    REQUIRE(u.ctx->getRxDropped() == 3);
+    REQUIRE(u.ctx->getRxQueued() == UDP_RX_QUEUE_LEN);
+}
+
+TEST_CASE("UdpContext drains datagrams in batches", "[wifi][udp]")
+{
+    Udp u;
+    ip_addr_t any = { 0 };
+    REQUIRE(u.ctx->listen(any, 5000));
+    for (int i = 0; i < 5; ++i) {
+        receive(u, std::string(i + 1, '0' + i), 0x0200000a, 1000 + i);
+    }
+    REQUIRE(u.ctx->next());
+
+    std::string got;
+    std::vector<uint16_t> ports;
+    size_t handled = u.ctx->recv_batch([&](const uint8_t* data, size_t len, uint32_t addr, uint16_t port) {
+        REQUIRE(addr == 0x0200000a);
+        got.append((const char*) data, len);
+        ports.push_back(port);
+    }, 3);
+    REQUIRE(handled == 3);
+    REQUIRE(got == "112223333");
+    REQUIRE(ports == std::vector<uint16_t>({ 1001, 1002, 1003 }));
+    REQUIRE(u.ctx->getRxQueued() == 1);
+    // the current datagram is still there
+    REQUIRE(u.ctx->getRemotePort() == 1000);
+    REQUIRE(readAll(u.ctx) == "0");
+}
+
+TEST_CASE("UdpContext keeps chained datagrams in one piece", "[wifi][udp]")
+{
+    Udp u;
+    ip_addr_t any = { 0 };
+    REQUIRE(u.ctx->listen(any, 5000));
+    pbuf* head = lwip_stub_udp_datagram("chained ", 8, 0x0a01a8c0);
+    pbuf* tail = pbuf_alloc(PBUF_RAW, 8, PBUF_RAM);
+    memcpy(tail->payload, "datagram", 8);
+    pbuf_cat(head, tail);
+    lwip_stub_udp_receive(u.pcb, head, 0x0200000a, 1000);
+    REQUIRE(u.ctx->next());
+    REQUIRE(u.ctx->getDestAddress() == 0x0a01a8c0);
+    REQUIRE(readAll(u.ctx) == "chained datagram");
+}
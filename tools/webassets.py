@@ -0,0 +1,184 @@
+#!/usr/bin/env python
+#
+# webassets.py - pack a directory of static web files into a PROGMEM bundle
+# for ESP8266WebServer::serveStatic(uri, bundle).
+#
+# Every file is gzip-compressed at build time (unless that does not make it
+# smaller or it is compressed already), gets a content-derived ETag and a
+# Content-Type, and is appended to a single data image. The generated header
+# also contains an index of all paths sorted in strcmp order, so the server
+# resolves a request with one binary search and streams the body from flash.
+#
+# Usage:
+#   python webassets.py -o assets.h [-n assets] <directory>
+#
+# and in the sketch:
+#   #include "assets.h"
+#   server.serveStatic("/", assets, "max-age=86400");
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+
+from __future__ import print_function
+import argparse
+import gzip
+import hashlib
+import io
+import os
+import sys
+
+# keep in sync with libraries/ESP8266WebServer/src/detail/mimetable.cpp
+MIME_TYPES = [
+    ('.html', 'text/html'),
+    ('.htm', 'text/html'),
+    ('.css', 'text/css'),
+    ('.txt', 'text/plain'),
+    ('.js', 'application/javascript'),
+    ('.json', 'application/json'),
+    ('.png', 'image/png'),
+    ('.gif', 'image/gif'),
+    ('.jpg', 'image/jpeg'),
+    ('.ico', 'image/x-icon'),
+    ('.svg', 'image/svg+xml'),
+    ('.ttf', 'application/x-font-ttf'),
+    ('.otf', 'application/x-font-opentype'),
+    ('.woff', 'application/font-woff'),
+    ('.woff2', 'application/font-woff2'),
+    ('.eot', 'application/vnd.ms-fontobject'),
+    ('.sfnt', 'application/font-sfnt'),
+    ('.xml', 'text/xml'),
+    ('.pdf', 'application/pdf'),
+    ('.zip', 'application/zip'),
+    ('.gz', 'application/x-gzip'),
+    ('.appcache', 'text/cache-manifest'),
+]
+DEFAULT_MIME_TYPE = 'application/octet-stream'
+
+# formats which are compressed already
+INCOMPRESSIBLE = ('.png', '.gif', '.jpg', '.woff', '.woff2', '.zip', '.gz', '.pdf')
+
+INDEX_FILES = ('index.html', 'index.htm')
+
+ASSET_FLAG_GZIP = 0x01
+
+
+def mime_type(name):
+    for ext, mime in MIME_TYPES:
+        if name.endswith(ext):
+            return mime
+    return DEFAULT_MIME_TYPE
+
+
+def compress(data):
+    out = io.BytesIO()
+    # mtime=0 keeps the output, and thus the ETags, reproducible
+    with gzip.GzipFile(fileobj=out, mode='wb', compresslevel=9, mtime=0) as f:
+        f.write(data)
+    return out.getvalue()
+
+
+def c_string(s):
+    return '"' + s.replace('\\', '\\\\').replace('"', '\\"') + '"'
+
+
+def collect(root):
+    assets = []
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames.sort()
+        for name in sorted(filenames):
+            full = os.path.join(dirpath, name)
+            rel = os.path.relpath(full, root).replace(os.sep, '/')
+            path = '/' + rel
+            try:
+                path.encode('ascii')
+            except UnicodeError:
+                raise ValueError('non-ASCII path not supported: ' + path)
+            with open(full, 'rb') as f:
+                assets.append((path, f.read()))
+    return assets
+
+
+def pack(assets, name, out):
+    entries = []
+    image = bytearray()
+    for path, data in assets:
+        flags = 0
+        body = data
+        if not path.endswith(INCOMPRESSIBLE):
+            packed = compress(data)
+            if len(packed) < len(data):
+                body = packed
+                flags |= ASSET_FLAG_GZIP
+        # entity tag covers the bytes actually sent
+        etag = '"' + hashlib.md5(body).hexdigest()[:16] + '"'
+        # keep every body 4-byte aligned in flash
+        while len(image) % 4:
+            image.append(0)
+        entries.append({'path': path, 'mime': mime_type(path), 'etag': etag,
+                        'offset': len(image), 'length': len(body), 'flags': flags})
+        image.extend(body)
+        # serve directory index files for the directory path as well
+        base = path.rsplit('/', 1)
+        if base[1] in INDEX_FILES:
+            alias = base[0] + '/'
+            if not any(e['path'] == alias for e in entries):
+                entry = dict(entries[-1])
+                entry['path'] = alias
+                entries.append(entry)
+
+    entries.sort(key=lambda e: e['path'].encode('ascii'))
+
+    strings = []
+    def string_var(value):
+        if value not in strings:
+            strings.append(value)
+        return '%s_str%d' % (name, strings.index(value))
+
+    for e in entries:
+        e['path_var'] = string_var(e['path'])
+        e['mime_var'] = string_var(e['mime'])
+        e['etag_var'] = string_var(e['etag'])
+
+    w = out.write
+    w('// Generated by tools/webassets.py, do not edit.\n\n')
+    w('#pragma once\n\n')
+    w('#include <ESP8266WebServer.h>\n\n')
+    w('static const uint8_t %s_data[] PROGMEM __attribute__((aligned(4))) = {\n' % name)
+    for i in range(0, len(image), 16):
+        w('  ' + ', '.join('0x%02x' % b for b in image[i:i + 16]) + ',\n')
+    w('};\n\n')
+    for i, value in enumerate(strings):
+        w('static const char %s_str%d[] PROGMEM = %s;\n' % (name, i, c_string(value)))
+    w('\nstatic const AssetEntry %s_entries[] PROGMEM = {\n' % name)
+    for e in entries:
+        w('  { %s, %s, %s, %d, %d, 0x%02x }, // %s\n' % (
+            e['path_var'], e['mime_var'], e['etag_var'],
+            e['offset'], e['length'], e['flags'], e['path']))
+    w('};\n\n')
+    w('static const AssetBundle %s = { %s_data, %s_entries, %d };\n' % (
+        name, name, name, len(entries)))
+    return len(image)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Pack static web assets into a PROGMEM bundle.')
+    parser.add_argument('directory', help='directory containing the files to serve')
+    parser.add_argument('-o', '--output', required=True, help='header file to generate')
+    parser.add_argument('-n', '--name', default='assets', help='name of the generated AssetBundle')
+    args = parser.parse_args()
+
+    try:
+        assets = collect(args.directory)
+    except ValueError as e:
+        print('error: ' + str(e), file=sys.stderr)
+        return 1
+    with open(args.output, 'w') as out:
+        size = pack(assets, args.name, out)
+    print('%d files, %d bytes packed into %s' % (len(assets), size, args.output))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())